@@ -0,0 +1,94 @@
+#pragma once
+
+#include "config.hpp"
+#include "assert.hpp"
+
+#include <cstdint>
+
+namespace bklib {
+
+//==============================================================================
+//! Walker / Vose alias table over N outcomes with fixed point thresholds.
+//!
+//! A sample costs one lookup: the low bits of the input choose a column and
+//! the remaining bits are compared against that column's threshold. Only the
+//! low SAMPLE_BITS bits of the input are used, so callers may pack as many
+//! samples into one random draw as it has whole SAMPLE_BITS fields, shifting
+//! each one down in turn.
+//==============================================================================
+template <unsigned N>
+class alias_table {
+    static_assert(N > 0 && (N & (N - 1)) == 0, "N must be a power of two.");
+public:
+    static unsigned const SAMPLE_BITS = 15;
+    static unsigned const SAMPLE_MASK = (1u << SAMPLE_BITS) - 1;
+    static unsigned const THRESHOLD_MAX = (1u << SAMPLE_BITS) / N;
+
+    //--------------------------------------------------------------------------
+    //! @param weight callable such that weight(i) is the relative weight of
+    //! outcome i in [0, N). At least one weight must be non zero.
+    //--------------------------------------------------------------------------
+    template <typename F>
+    explicit alias_table(F weight) {
+        uint64_t scaled[N];
+        uint64_t total = 0;
+
+        for (unsigned i = 0; i < N; ++i) {
+            scaled[i] = static_cast<uint64_t>(weight(i)) * N;
+            total    += scaled[i] / N;
+        }
+
+        BK_ASSERT(total > 0);
+
+        unsigned small[N], large[N];
+        unsigned small_n = 0, large_n = 0;
+
+        for (unsigned i = 0; i < N; ++i) {
+            if (scaled[i] < total) small[small_n++] = i;
+            else                   large[large_n++] = i;
+        }
+
+        while (small_n && large_n) {
+            auto const l = small[--small_n];
+            auto const g = large[--large_n];
+
+            threshold_[l] = static_cast<uint16_t>(
+                (scaled[l] * THRESHOLD_MAX + total / 2) / total
+            );
+            alias_[l] = static_cast<uint8_t>(g);
+
+            scaled[g] = (scaled[g] + scaled[l]) - total;
+
+            if (scaled[g] < total) small[small_n++] = g;
+            else                   large[large_n++] = g;
+        }
+
+        //whatever is left over is (up to rounding) exactly full.
+        while (large_n) {
+            auto const g = large[--large_n];
+            threshold_[g] = THRESHOLD_MAX;
+            alias_[g]     = static_cast<uint8_t>(g);
+        }
+
+        while (small_n) {
+            auto const l = small[--small_n];
+            threshold_[l] = THRESHOLD_MAX;
+            alias_[l]     = static_cast<uint8_t>(l);
+        }
+    }
+
+    //--------------------------------------------------------------------------
+    //! Map the low SAMPLE_BITS bits of @p bits to an outcome in [0, N).
+    //--------------------------------------------------------------------------
+    unsigned operator()(unsigned const bits) const {
+        auto const column = bits % N;
+        auto const u      = (bits & SAMPLE_MASK) / N;
+
+        return (u < threshold_[column]) ? column : alias_[column];
+    }
+private:
+    uint16_t threshold_[N];
+    uint8_t  alias_[N];
+};
+
+} //namespace bklib
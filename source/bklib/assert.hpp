@@ -11,7 +11,7 @@
 
 #   define BK_TEST_DEBUG_BREAK \
     [&] { \
-        if (BK_TEST_BREAK_ON_ASSERT) __debugbreak(); \
+        if (BK_TEST_BREAK_ON_ASSERT) BK_DEBUG_BREAK; \
     }()
 
 #   define BK_ASSERT_IMPL BOOST_THROW_EXCEPTION(assertion_failure())
@@ -42,4 +42,4 @@
         BK_TEST_BREAK_ON_ASSERT = true; \
     });
 
-#define BK_TODO __debugbreak()
+#define BK_TODO BK_DEBUG_BREAK
@@ -55,7 +55,16 @@
 #       define BK_UNREACHABLE __debugbreak(); __assume(0);
 #   endif
 #else
-#   error "BK_UNREACHABLE unimplemented"
+#   define BK_UNREACHABLE __builtin_unreachable();
+#endif
+
+//------------------------------------------------------------------------------
+// Compiler specific defines for breaking into the debugger.
+//------------------------------------------------------------------------------
+#if defined(BK_COMPILER_MSVC)
+#   define BK_DEBUG_BREAK __debugbreak()
+#else
+#   define BK_DEBUG_BREAK __builtin_trap()
 #endif
 
 
@@ -0,0 +1,165 @@
+#pragma once
+
+#include "config.hpp"
+#include "random.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+namespace bklib {
+
+//==============================================================================
+//! A 128 bit digest.
+//==============================================================================
+struct hash128 {
+    uint64_t low;
+    uint64_t high;
+
+    bool operator==(hash128 const& rhs) const {
+        return low == rhs.low && high == rhs.high;
+    }
+
+    bool operator!=(hash128 const& rhs) const {
+        return !(*this == rhs);
+    }
+};
+
+//==============================================================================
+//! A streaming, non cryptographic hash of bytes with 64 and 128 bit digests.
+//!
+//! Input is taken 32 bytes at a time into four independent 64 bit lanes, so
+//! the multiplies for consecutive words do not wait on each other and the
+//! loop pipelines, or vectorises where the compiler can; the lanes are only
+//! combined in the digest. Feeding the same bytes in any pieces gives the
+//! same digest.
+//!
+//! Words are read in the byte order of the machine, so digests are only
+//! comparable between machines of the same byte order.
+//==============================================================================
+class stream_hash {
+public:
+    explicit stream_hash(uint64_t const seed = 0)
+        : seed_(seed)
+        , length_(0)
+        , buffered_(0)
+    {
+        lanes_[0] = seed + P1 + P2;
+        lanes_[1] = seed + P2;
+        lanes_[2] = seed;
+        lanes_[3] = seed - P1;
+    }
+
+    void update(void const* const data, size_t size) {
+        auto p = static_cast<unsigned char const*>(data);
+        length_ += size;
+
+        //top up a partial stripe first.
+        if (buffered_ > 0) {
+            auto const n = std::min(size, STRIPE - buffered_);
+            std::memcpy(buffer_ + buffered_, p, n);
+
+            buffered_ += n;
+            p         += n;
+            size      -= n;
+
+            if (buffered_ < STRIPE) return;
+
+            stripe_(buffer_);
+            buffered_ = 0;
+        }
+
+        for (; size >= STRIPE; p += STRIPE, size -= STRIPE) {
+            stripe_(p);
+        }
+
+        std::memcpy(buffer_, p, size);
+        buffered_ = size;
+    }
+
+    //! Hash the bytes of @p value, which must have no padding.
+    template <typename T>
+    void update_value(T const& value) {
+        update(&value, sizeof(value));
+    }
+
+    uint64_t digest64() const {
+        return finish_(0);
+    }
+
+    //! The low half is digest64(); the high half is a second finish of the
+    //! same state.
+    hash128 digest128() const {
+        hash128 const result = {finish_(0), finish_(P3)};
+        return result;
+    }
+private:
+    static uint64_t const P1 = 0x9E3779B185EBCA87ull;
+    static uint64_t const P2 = 0xC2B2AE3D27D4EB4Full;
+    static uint64_t const P3 = 0x165667B19E3779F9ull;
+    static uint64_t const P4 = 0x85EBCA77C2B2AE63ull;
+    static uint64_t const P5 = 0x27D4EB2F165667C5ull;
+
+    static size_t const STRIPE = 32;
+
+    static uint64_t read_(unsigned char const* const p) {
+        uint64_t result;
+        std::memcpy(&result, p, sizeof(result));
+        return result;
+    }
+
+    static uint64_t round_(uint64_t acc, uint64_t const input) {
+        acc += input * P2;
+        acc  = detail::rotl(acc, 31);
+        return acc * P1;
+    }
+
+    void stripe_(unsigned char const* const p) {
+        lanes_[0] = round_(lanes_[0], read_(p));
+        lanes_[1] = round_(lanes_[1], read_(p + 8));
+        lanes_[2] = round_(lanes_[2], read_(p + 16));
+        lanes_[3] = round_(lanes_[3], read_(p + 24));
+    }
+
+    uint64_t finish_(uint64_t const salt) const {
+        uint64_t h = seed_ + P5 + salt;
+
+        if (length_ >= STRIPE) {
+            h = detail::rotl(lanes_[0] ^ salt, 1)
+              + detail::rotl(lanes_[1],        7)
+              + detail::rotl(lanes_[2],       12)
+              + detail::rotl(lanes_[3],       18);
+
+            for (auto const lane : lanes_) {
+                h = (h ^ round_(0, lane)) * P1 + P4;
+            }
+        }
+
+        h += length_;
+
+        //the tail: whole words, then the bytes left zero padded.
+        size_t i = 0;
+        for (; i + 8 <= buffered_; i += 8) {
+            h ^= round_(0, read_(buffer_ + i));
+            h  = detail::rotl(h, 27) * P1 + P4;
+        }
+
+        if (i < buffered_) {
+            uint64_t word = 0;
+            std::memcpy(&word, buffer_ + i, buffered_ - i);
+
+            h ^= round_(0, word);
+            h  = detail::rotl(h, 23) * P2 + P3;
+        }
+
+        return mix64(h);
+    }
+
+    uint64_t      seed_;
+    uint64_t      length_;   //!< Bytes fed in total.
+    uint64_t      lanes_[4];
+    size_t        buffered_; //!< Bytes in buffer_.
+    unsigned char buffer_[STRIPE];
+};
+
+} //namespace bklib
@@ -0,0 +1,188 @@
+#include "pch.hpp"
+#include "mapped_file.hpp"
+#include "scope_exit.hpp"
+
+#if !defined(BK_PLATFORM_WINDOWS)
+#   include <sys/mman.h>
+#   include <sys/stat.h>
+#   include <fcntl.h>
+#   include <unistd.h>
+#   include <cerrno>
+#endif
+
+using bklib::mapped_file;
+
+namespace {
+
+void fail(std::string const& filename, int const error) {
+    BOOST_THROW_EXCEPTION(
+        bklib::mapped_file_error()
+            << boost::errinfo_file_name(filename)
+            << boost::errinfo_errno(error)
+    );
+}
+
+} //namespace
+
+#if defined(BK_PLATFORM_WINDOWS)
+
+mapped_file::mapped_file(std::string const& filename)
+    : data_(nullptr)
+    , size_(0)
+    , file_(INVALID_HANDLE_VALUE)
+    , mapping_(nullptr)
+{
+    BK_ON_SCOPE_EXIT({
+        if (!data_) close_();
+    });
+
+    file_ = ::CreateFileA(
+        filename.c_str(),
+        GENERIC_READ,
+        FILE_SHARE_READ,
+        nullptr,
+        OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL,
+        nullptr
+    );
+
+    if (file_ == INVALID_HANDLE_VALUE) {
+        fail(filename, static_cast<int>(::GetLastError()));
+    }
+
+    LARGE_INTEGER size;
+    if (!::GetFileSizeEx(file_, &size)) {
+        fail(filename, static_cast<int>(::GetLastError()));
+    }
+
+    //an empty file cannot be mapped; there is nothing to see anyway.
+    if (size.QuadPart == 0) {
+        close_();
+        return;
+    }
+
+    size_ = static_cast<size_t>(size.QuadPart);
+
+    mapping_ = ::CreateFileMappingA(
+        file_, nullptr, PAGE_READONLY, 0, 0, nullptr
+    );
+
+    if (!mapping_) {
+        fail(filename, static_cast<int>(::GetLastError()));
+    }
+
+    data_ = ::MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0);
+
+    if (!data_) {
+        fail(filename, static_cast<int>(::GetLastError()));
+    }
+}
+
+void mapped_file::close_() {
+    if (data_) {
+        ::UnmapViewOfFile(data_);
+    }
+
+    if (mapping_) {
+        ::CloseHandle(mapping_);
+    }
+
+    if (file_ != INVALID_HANDLE_VALUE) {
+        ::CloseHandle(file_);
+    }
+
+    data_    = nullptr;
+    size_    = 0;
+    mapping_ = nullptr;
+    file_    = INVALID_HANDLE_VALUE;
+}
+
+mapped_file::mapped_file(mapped_file&& other)
+    : data_(other.data_)
+    , size_(other.size_)
+    , file_(other.file_)
+    , mapping_(other.mapping_)
+{
+    other.data_    = nullptr;
+    other.size_    = 0;
+    other.file_    = INVALID_HANDLE_VALUE;
+    other.mapping_ = nullptr;
+}
+
+void mapped_file::swap(mapped_file& other) {
+    using std::swap;
+    swap(data_,    other.data_);
+    swap(size_,    other.size_);
+    swap(file_,    other.file_);
+    swap(mapping_, other.mapping_);
+}
+
+#else
+
+mapped_file::mapped_file(std::string const& filename)
+    : data_(nullptr)
+    , size_(0)
+{
+    auto const fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0) {
+        fail(filename, errno);
+    }
+
+    //the mapping keeps the file open by itself.
+    BK_ON_SCOPE_EXIT({
+        ::close(fd);
+    });
+
+    struct stat info;
+    if (::fstat(fd, &info) != 0) {
+        fail(filename, errno);
+    }
+
+    if (info.st_size == 0) {
+        return;
+    }
+
+    auto const size = static_cast<size_t>(info.st_size);
+    auto const data = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+    if (data == MAP_FAILED) {
+        fail(filename, errno);
+    }
+
+    data_ = data;
+    size_ = size;
+}
+
+void mapped_file::close_() {
+    if (data_) {
+        ::munmap(const_cast<void*>(data_), size_);
+    }
+
+    data_ = nullptr;
+    size_ = 0;
+}
+
+mapped_file::mapped_file(mapped_file&& other)
+    : data_(other.data_)
+    , size_(other.size_)
+{
+    other.data_ = nullptr;
+    other.size_ = 0;
+}
+
+void mapped_file::swap(mapped_file& other) {
+    using std::swap;
+    swap(data_, other.data_);
+    swap(size_, other.size_);
+}
+
+#endif
+
+mapped_file& mapped_file::operator=(mapped_file&& rhs) {
+    swap(rhs);
+    return *this;
+}
+
+mapped_file::~mapped_file() {
+    close_();
+}
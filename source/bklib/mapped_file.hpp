@@ -0,0 +1,59 @@
+#pragma once
+
+#include "config.hpp"
+
+#include <boost/exception/all.hpp>
+
+#include <string>
+#include <cstddef>
+
+namespace bklib {
+
+//==============================================================================
+//! Thrown when a file cannot be opened or mapped.
+//==============================================================================
+struct mapped_file_error : virtual boost::exception, virtual std::exception {};
+
+//==============================================================================
+//! A whole file mapped read only into memory; pages are read in as they are
+//! touched.
+//!
+//! @remark Move-only type.
+//==============================================================================
+class mapped_file {
+public:
+    //--------------------------------------------------------------------------
+    //! @throws mapped_file_error
+    //--------------------------------------------------------------------------
+    explicit mapped_file(std::string const& filename);
+
+    mapped_file(mapped_file&& other);
+    mapped_file& operator=(mapped_file&& rhs);
+
+    ~mapped_file();
+
+    void swap(mapped_file& other);
+
+    //! Page aligned; nullptr for an empty file.
+    void const* data() const { return data_; }
+    size_t      size() const { return size_; }
+private:
+    mapped_file(mapped_file const&)            BK_DELETE;
+    mapped_file& operator=(mapped_file const&) BK_DELETE;
+
+    void close_();
+
+    void const* data_;
+    size_t      size_;
+
+#if defined(BK_PLATFORM_WINDOWS)
+    void* file_;    //!< HANDLE
+    void* mapping_; //!< HANDLE
+#endif
+};
+
+inline void swap(mapped_file& a, mapped_file& b) {
+    a.swap(b);
+}
+
+} //namespace bklib
@@ -0,0 +1,158 @@
+#pragma once
+
+#include "config.hpp"
+#include "assert.hpp"
+
+#include <memory>
+#include <atomic>
+#include <thread>
+#include <type_traits>
+
+namespace bklib {
+
+//==============================================================================
+//! A bounded, lock-free queue of the values for the indices [0, count).
+//!
+//! Any number of producers claim indices and push their values in any order;
+//! a single consumer takes them in index order. A producer may run at most
+//! capacity indices ahead of the consumer; waits are spins that yield.
+//!
+//! Each slot carries a sequence number: n while it is free for index n, and
+//! n + 1 once the value for index n is in it.
+//==============================================================================
+template <typename T>
+class ordered_queue {
+public:
+    //--------------------------------------------------------------------------
+    //! @param capacity rounded up to a power of two, at least 2.
+    //--------------------------------------------------------------------------
+    ordered_queue(size_t const count, size_t const capacity)
+        : count_(count)
+        , capacity_(round_up_(capacity))
+        , slots_(new slot[capacity_])
+        , next_claim_(0)
+        , next_pop_(0)
+        , closed_(false)
+    {
+        for (size_t i = 0; i < capacity_; ++i) {
+            slots_[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    ~ordered_queue() {
+        for (size_t i = 0; i < capacity_; ++i) {
+            auto const seq = slots_[i].sequence.load(std::memory_order_acquire);
+            if (((seq - i) & (capacity_ - 1)) == 1) {
+                slots_[i].value()->~T();
+            }
+        }
+    }
+
+    size_t count()    const { return count_; }
+    size_t capacity() const { return capacity_; }
+
+    //--------------------------------------------------------------------------
+    //! Claim the next index to produce.
+    //! @returns @c false once every index is claimed, or the queue is closed.
+    //--------------------------------------------------------------------------
+    bool claim(size_t& index) {
+        if (closed()) return false;
+
+        index = next_claim_.fetch_add(1, std::memory_order_relaxed);
+        return index < count_;
+    }
+
+    //--------------------------------------------------------------------------
+    //! Store the value for @p index, waiting until the consumer has taken the
+    //! value capacity() indices before it.
+    //! @returns @c false, dropping @p value, if the queue was closed.
+    //--------------------------------------------------------------------------
+    bool push(size_t const index, T value) {
+        BK_ASSERT(index < count_);
+        if (closed()) return false;
+
+        auto& s = slots_[index & (capacity_ - 1)];
+        if (!wait_for_(s, index)) return false;
+
+        ::new (s.value()) T(std::move(value));
+        s.sequence.store(index + 1, std::memory_order_release);
+
+        return true;
+    }
+
+    //--------------------------------------------------------------------------
+    //! Wait for the value of the next index and pass it to @p f.
+    //! @returns @c false once every value is taken, or the queue is closed.
+    //--------------------------------------------------------------------------
+    template <typename F>
+    bool pop(F&& f) {
+        auto const index = next_pop_;
+        if (index >= count_ || closed()) return false;
+
+        auto& s = slots_[index & (capacity_ - 1)];
+        if (!wait_for_(s, index + 1)) return false;
+
+        {
+            T value(std::move(*s.value()));
+            s.value()->~T();
+
+            next_pop_++;
+            s.sequence.store(index + capacity_, std::memory_order_release);
+
+            f(std::move(value));
+        }
+
+        return true;
+    }
+
+    //--------------------------------------------------------------------------
+    //! Make every waiting and later call return @c false; for when either side
+    //! gives up.
+    //--------------------------------------------------------------------------
+    void close() {
+        closed_.store(true, std::memory_order_release);
+    }
+
+    bool closed() const {
+        return closed_.load(std::memory_order_acquire);
+    }
+private:
+    ordered_queue(ordered_queue const&)            BK_DELETE;
+    ordered_queue& operator=(ordered_queue const&) BK_DELETE;
+
+    struct slot {
+        T* value() { return reinterpret_cast<T*>(&storage); }
+
+        std::atomic<size_t> sequence;
+
+        typename std::aligned_storage<
+            sizeof(T), std::alignment_of<T>::value
+        >::type storage;
+    };
+
+    static size_t round_up_(size_t const n) {
+        size_t result = 2;
+        while (result < n) result <<= 1;
+        return result;
+    }
+
+    bool wait_for_(slot const& s, size_t const sequence) const {
+        while (s.sequence.load(std::memory_order_acquire) != sequence) {
+            if (closed()) return false;
+            std::this_thread::yield();
+        }
+
+        return true;
+    }
+
+    size_t const count_;
+    size_t const capacity_;
+
+    std::unique_ptr<slot[]> slots_;
+
+    std::atomic<size_t> next_claim_; //!< Shared by the producers.
+    size_t              next_pop_;   //!< The consumer's alone.
+    std::atomic<bool>   closed_;
+};
+
+} //namespace bklib
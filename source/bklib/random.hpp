@@ -0,0 +1,383 @@
+#pragma once
+
+#include "config.hpp"
+#include "assert.hpp"
+
+#include <cstdint>
+#include <limits>
+
+namespace bklib {
+
+//==============================================================================
+//! SplitMix64 finalizer; a bijective 64 bit mix.
+//==============================================================================
+inline uint64_t mix64(uint64_t z) {
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+namespace detail {
+    inline uint64_t rotl(uint64_t const x, unsigned const k) {
+        return (x << k) | (x >> (64 - k));
+    }
+} //namespace detail
+
+//==============================================================================
+//! xoshiro256** engine; held by value, copies are independent.
+//!
+//! Satisfies the standard uniform random number generator requirements, so it
+//! can also drive the <random> distributions.
+//==============================================================================
+class xoshiro256ss {
+public:
+    typedef uint64_t result_type;
+
+    static result_type min() { return 0; }
+    static result_type max() { return std::numeric_limits<result_type>::max(); }
+
+    explicit xoshiro256ss(uint64_t const seed_value = 0) {
+        seed(seed_value);
+    }
+
+    //--------------------------------------------------------------------------
+    //! Expand @p seed_value to the full state with SplitMix64.
+    //--------------------------------------------------------------------------
+    void seed(uint64_t const seed_value) {
+        static uint64_t const GAMMA = 0x9E3779B97F4A7C15ull;
+
+        uint64_t z = seed_value;
+        for (auto& s : s_) {
+            s = mix64(z += GAMMA);
+        }
+    }
+
+    result_type operator()() {
+        auto const result = detail::rotl(s_[1] * 5, 7) * 9;
+        auto const t      = s_[1] << 17;
+
+        s_[2] ^= s_[0];
+        s_[3] ^= s_[1];
+        s_[1] ^= s_[2];
+        s_[0] ^= s_[3];
+        s_[2] ^= t;
+        s_[3]  = detail::rotl(s_[3], 45);
+
+        return result;
+    }
+
+    //--------------------------------------------------------------------------
+    //! Advance by 2^128 draws.
+    //--------------------------------------------------------------------------
+    void jump() {
+        static uint64_t const JUMP[] = {
+            0x180EC6D33CFD0ABAull, 0xD5A61266F0C9392Cull,
+            0xA9582618E03FC9AAull, 0x39ABDC4529B1661Cull
+        };
+
+        uint64_t t[4] = {0, 0, 0, 0};
+
+        for (auto const j : JUMP) {
+            for (unsigned b = 0; b < 64; ++b) {
+                if (j & (uint64_t(1) << b)) {
+                    t[0] ^= s_[0]; t[1] ^= s_[1]; t[2] ^= s_[2]; t[3] ^= s_[3];
+                }
+                (*this)();
+            }
+        }
+
+        s_[0] = t[0]; s_[1] = t[1]; s_[2] = t[2]; s_[3] = t[3];
+    }
+
+    //--------------------------------------------------------------------------
+    //! Return an engine for the next 2^128 draws of this stream and jump past
+    //! them; engines split from one another never overlap in practice.
+    //--------------------------------------------------------------------------
+    xoshiro256ss split() {
+        auto const result = *this;
+        jump();
+        return result;
+    }
+
+    bool operator==(xoshiro256ss const& rhs) const {
+        return s_[0] == rhs.s_[0] && s_[1] == rhs.s_[1] &&
+               s_[2] == rhs.s_[2] && s_[3] == rhs.s_[3];
+    }
+
+    bool operator!=(xoshiro256ss const& rhs) const {
+        return !(*this == rhs);
+    }
+private:
+    uint64_t s_[4];
+};
+
+//==============================================================================
+//! PCG32 (XSH RR) engine; 64 bits of state plus a stream selector.
+//==============================================================================
+class pcg32 {
+public:
+    typedef uint32_t result_type;
+
+    static result_type min() { return 0; }
+    static result_type max() { return std::numeric_limits<result_type>::max(); }
+
+    explicit pcg32(uint64_t const seed_value = 0, uint64_t const stream = 0) {
+        seed(seed_value, stream);
+    }
+
+    void seed(uint64_t const seed_value, uint64_t const stream = 0) {
+        state_ = 0;
+        inc_   = (stream << 1) | 1;
+        step_();
+        state_ += seed_value;
+        step_();
+    }
+
+    result_type operator()() {
+        auto const old = state_;
+        step_();
+
+        auto const xorshifted = static_cast<uint32_t>(((old >> 18) ^ old) >> 27);
+        auto const rot        = static_cast<uint32_t>(old >> 59);
+
+        return (xorshifted >> rot) | (xorshifted << ((0u - rot) & 31));
+    }
+
+    //--------------------------------------------------------------------------
+    //! Advance by @p delta draws in O(log delta).
+    //--------------------------------------------------------------------------
+    void advance(uint64_t delta) {
+        uint64_t mul = MULTIPLIER, add = inc_;
+        uint64_t acc_mul = 1, acc_add = 0;
+
+        for (; delta; delta >>= 1) {
+            if (delta & 1) {
+                acc_mul *= mul;
+                acc_add  = acc_add * mul + add;
+            }
+
+            add  = (mul + 1) * add;
+            mul *= mul;
+        }
+
+        state_ = acc_mul * state_ + acc_add;
+    }
+
+    //--------------------------------------------------------------------------
+    //! Return an engine on a new stream chosen by this one.
+    //--------------------------------------------------------------------------
+    pcg32 split() {
+        auto const hi = static_cast<uint64_t>((*this)());
+        auto const lo = static_cast<uint64_t>((*this)());
+        auto const s  = static_cast<uint64_t>((*this)());
+
+        return pcg32((hi << 32) | lo, mix64(s ^ inc_));
+    }
+
+    bool operator==(pcg32 const& rhs) const {
+        return state_ == rhs.state_ && inc_ == rhs.inc_;
+    }
+
+    bool operator!=(pcg32 const& rhs) const {
+        return !(*this == rhs);
+    }
+private:
+    static uint64_t const MULTIPLIER = 6364136223846793005ull;
+
+    void step_() {
+        state_ = state_ * MULTIPLIER + inc_;
+    }
+
+    uint64_t state_;
+    uint64_t inc_;
+};
+
+//==============================================================================
+//! The engine used by default.
+//==============================================================================
+typedef xoshiro256ss random_engine;
+
+//==============================================================================
+//! Counter based randomness; a pure function of a seed, a position and a
+//! @p purpose that tells apart different decisions made at one position.
+//==============================================================================
+inline uint64_t random_at(
+    uint64_t const seed,
+    signed   const x,
+    signed   const y,
+    uint32_t const purpose
+) {
+    static uint64_t const GAMMA = 0x9E3779B97F4A7C15ull;
+
+    auto const xy = (static_cast<uint64_t>(static_cast<uint32_t>(y)) << 32) |
+                     static_cast<uint64_t>(static_cast<uint32_t>(x));
+
+    return mix64(mix64(seed + GAMMA * (purpose + 1)) ^ xy);
+}
+
+//==============================================================================
+//! Stateless random source for decisions that must not depend on the order in
+//! which they are made; every value can be computed on any thread, at any time.
+//==============================================================================
+class hash_random {
+public:
+    explicit hash_random(uint64_t const seed = 0) : seed_(seed) {}
+
+    uint64_t seed() const { return seed_; }
+
+    uint64_t operator()(
+        signed const x, signed const y, uint32_t const purpose
+    ) const {
+        return random_at(seed_, x, y, purpose);
+    }
+
+    //--------------------------------------------------------------------------
+    //! Uniform integer in [0, @p n); rejected values are remixed, so the result
+    //! is still a function of the arguments only.
+    //--------------------------------------------------------------------------
+    uint32_t bounded(
+        signed const x, signed const y, uint32_t const purpose, uint32_t const n
+    ) const {
+        BK_ASSERT(n > 0);
+
+        auto bits = (*this)(x, y, purpose);
+        auto m    = (bits >> 32) * n;
+        auto low  = static_cast<uint32_t>(m);
+
+        if (low < n) {
+            auto const threshold = (0u - n) % n;
+            while (low < threshold) {
+                bits = mix64(bits);
+                m    = (bits >> 32) * n;
+                low  = static_cast<uint32_t>(m);
+            }
+        }
+
+        return static_cast<uint32_t>(m >> 32);
+    }
+
+    //--------------------------------------------------------------------------
+    //! True with probability @p numerator / @p denominator.
+    //--------------------------------------------------------------------------
+    bool chance(
+        signed const x, signed const y, uint32_t const purpose,
+        uint32_t const numerator, uint32_t const denominator
+    ) const {
+        return bounded(x, y, purpose, denominator) < numerator;
+    }
+
+    //--------------------------------------------------------------------------
+    //! A sequential engine for a run of decisions keyed by one position.
+    //--------------------------------------------------------------------------
+    random_engine engine_at(
+        signed const x, signed const y, uint32_t const purpose
+    ) const {
+        return random_engine((*this)(x, y, purpose));
+    }
+private:
+    uint64_t seed_;
+};
+
+//==============================================================================
+//! The high 32 bits of a draw from @p engine.
+//==============================================================================
+template <typename Engine>
+inline uint32_t random_u32(Engine& engine) {
+    typedef typename Engine::result_type result_t;
+    static_assert(
+        std::numeric_limits<result_t>::digits >= 32, "engine is too narrow."
+    );
+
+    return static_cast<uint32_t>(
+        engine() >> (std::numeric_limits<result_t>::digits - 32)
+    );
+}
+
+//==============================================================================
+//! Uniform integer in [0, @p n) by multiply and shift (Lemire). The modulus is
+//! only computed on the rare path where rejection is possible.
+//==============================================================================
+template <typename Engine>
+inline uint32_t random_bounded(Engine& engine, uint32_t const n) {
+    BK_ASSERT(n > 0);
+
+    auto m   = static_cast<uint64_t>(random_u32(engine)) * n;
+    auto low = static_cast<uint32_t>(m);
+
+    if (low < n) {
+        auto const threshold = (0u - n) % n;
+        while (low < threshold) {
+            m   = static_cast<uint64_t>(random_u32(engine)) * n;
+            low = static_cast<uint32_t>(m);
+        }
+    }
+
+    return static_cast<uint32_t>(m >> 32);
+}
+
+//==============================================================================
+//! Fill [first, last) with uniform 32 bit values.
+//==============================================================================
+template <typename Engine>
+inline void fill_uniform(Engine& engine, uint32_t* first, uint32_t* const last) {
+    typedef typename Engine::result_type result_t;
+
+    if (std::numeric_limits<result_t>::digits >= 64) {
+        for (; last - first >= 2; first += 2) {
+            auto const x = static_cast<uint64_t>(engine());
+            first[0] = static_cast<uint32_t>(x >> 32);
+            first[1] = static_cast<uint32_t>(x);
+        }
+    }
+
+    for (; first != last; ++first) {
+        *first = random_u32(engine);
+    }
+}
+
+//==============================================================================
+//! Fill [first, last) with uniform values in [0, @p n).
+//==============================================================================
+template <typename Engine>
+inline void fill_uniform(
+    Engine&         engine,
+    uint32_t*       first,
+    uint32_t* const last,
+    uint32_t  const n
+) {
+    for (; first != last; ++first) {
+        *first = random_bounded(engine, n);
+    }
+}
+
+//==============================================================================
+//! Drop in for std::uniform_int_distribution over a closed range [a, b] whose
+//! width fits in 32 bits; the result does not depend on the library.
+//==============================================================================
+template <typename T = int>
+class uniform_int {
+public:
+    typedef T result_type;
+
+    uniform_int(T const a, T const b)
+        : a_(a)
+        , range_(static_cast<uint64_t>(b) - static_cast<uint64_t>(a))
+    {
+        BK_ASSERT(a <= b);
+        BK_ASSERT(range_ <= std::numeric_limits<uint32_t>::max());
+    }
+
+    template <typename Engine>
+    result_type operator()(Engine& engine) const {
+        auto const offset = (range_ == std::numeric_limits<uint32_t>::max()) ?
+            random_u32(engine) :
+            random_bounded(engine, static_cast<uint32_t>(range_ + 1));
+
+        return static_cast<T>(static_cast<uint64_t>(a_) + offset);
+    }
+private:
+    T        a_;
+    uint64_t range_;
+};
+
+} //namespace bklib
@@ -47,11 +47,11 @@ struct image_spec {
 };
 
 struct header {
-    uint8_t        id_length;
-    color_map_type color_map_type;
-    image_type     image_type;
-    color_map_spec color_map_spec;
-    image_spec     image_spec;
+    uint8_t          id_length;
+    ::color_map_type color_map_type;
+    ::image_type     image_type;
+    ::color_map_spec color_map_spec;
+    ::image_spec     image_spec;
 };
 
 struct footer {
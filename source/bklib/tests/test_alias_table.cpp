@@ -0,0 +1,66 @@
+#include "pch.hpp"
+#include "bklib/alias_table.hpp"
+
+#include <gtest/gtest.h>
+
+namespace {
+    template <unsigned N>
+    void check_exact(unsigned const (&weights)[N]) {
+        typedef bklib::alias_table<N> table_t;
+
+        table_t const table([&](unsigned const i) { return weights[i]; });
+
+        unsigned total = 0;
+        for (auto const w : weights) total += w;
+
+        unsigned counts[N] = {0};
+        for (unsigned bits = 0; bits <= table_t::SAMPLE_MASK; ++bits) {
+            auto const i = table(bits);
+            ASSERT_LT(i, N);
+            counts[i]++;
+        }
+
+        //every input is equally likely, so the counts are the probabilities
+        //up to the rounding of one threshold per column.
+        for (unsigned i = 0; i < N; ++i) {
+            double const expected =
+                double(weights[i]) * (table_t::SAMPLE_MASK + 1) / total;
+
+            EXPECT_NEAR(expected, double(counts[i]), N);
+
+            if (weights[i] == 0) {
+                EXPECT_EQ(0U, counts[i]);
+            }
+        }
+    }
+} //namespace
+
+TEST(AliasTable, PathProbabilities) {
+    unsigned const north[] = {800, 10, 20, 20};
+    unsigned const west[]  = {20, 20, 10, 800};
+
+    check_exact(north);
+    check_exact(west);
+}
+
+TEST(AliasTable, Degenerate) {
+    unsigned const one[]     = {0, 0, 7, 0};
+    unsigned const uniform[] = {5, 5, 5, 5, 5, 5, 5, 5};
+    unsigned const single[]  = {3};
+
+    check_exact(one);
+    check_exact(uniform);
+    check_exact(single);
+}
+
+TEST(AliasTable, UsesOnlySampleBits) {
+    unsigned const weights[] = {1, 2, 3, 4};
+    bklib::alias_table<4> const table([&](unsigned i) { return weights[i]; });
+
+    typedef bklib::alias_table<4> table_t;
+
+    for (unsigned bits = 0; bits <= table_t::SAMPLE_MASK; bits += 97) {
+        EXPECT_EQ(table(bits), table(bits | (1u << table_t::SAMPLE_BITS)));
+        EXPECT_EQ(table(bits), table(bits | 0xFFFF8000u));
+    }
+}
@@ -0,0 +1,72 @@
+#include "pch.hpp"
+#include "bklib/hash.hpp"
+
+#include <gtest/gtest.h>
+
+#include <vector>
+#include <set>
+
+namespace {
+
+std::vector<unsigned char> bytes(size_t const n) {
+    std::vector<unsigned char> result(n);
+    for (size_t i = 0; i < n; ++i) {
+        result[i] = static_cast<unsigned char>(i * 131 + 7);
+    }
+    return result;
+}
+
+uint64_t hash(std::vector<unsigned char> const& data, uint64_t seed = 0) {
+    bklib::stream_hash h(seed);
+    h.update(data.data(), data.size());
+    return h.digest64();
+}
+
+} //namespace
+
+TEST(Hash, Pieces) {
+    auto const data = bytes(1000);
+    auto const expected = hash(data);
+
+    //any split gives the same digest, across stripes and tails alike.
+    for (size_t piece = 1; piece < 70; ++piece) {
+        bklib::stream_hash h;
+
+        for (size_t i = 0; i < data.size(); i += piece) {
+            h.update(data.data() + i, std::min(piece, data.size() - i));
+        }
+
+        ASSERT_EQ(expected, h.digest64());
+    }
+}
+
+TEST(Hash, Distinct) {
+    std::set<uint64_t> seen;
+
+    //every length, including the empty input and partial stripes.
+    for (size_t n = 0; n <= 100; ++n) {
+        EXPECT_TRUE(seen.insert(hash(bytes(n))).second);
+    }
+
+    //every single bit flip.
+    auto data = bytes(64);
+    for (size_t i = 0; i < data.size() * 8; ++i) {
+        data[i / 8] ^= static_cast<unsigned char>(1u << (i % 8));
+        EXPECT_TRUE(seen.insert(hash(data)).second);
+        data[i / 8] ^= static_cast<unsigned char>(1u << (i % 8));
+    }
+
+    EXPECT_NE(hash(data, 0), hash(data, 1));
+}
+
+TEST(Hash, Digest128) {
+    for (size_t n = 0; n <= 100; n += 10) {
+        bklib::stream_hash h;
+        auto const data = bytes(n);
+        h.update(data.data(), data.size());
+
+        auto const d = h.digest128();
+        EXPECT_EQ(h.digest64(), d.low);
+        EXPECT_NE(d.low, d.high);
+    }
+}
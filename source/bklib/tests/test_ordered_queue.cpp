@@ -0,0 +1,53 @@
+#include "pch.hpp"
+#include "bklib/ordered_queue.hpp"
+#include "bklib/thread_pool.hpp"
+
+#include <gtest/gtest.h>
+
+#include <memory>
+
+TEST(OrderedQueue, Capacity) {
+    EXPECT_EQ(2u,  bklib::ordered_queue<int>(10, 0).capacity());
+    EXPECT_EQ(8u,  bklib::ordered_queue<int>(10, 5).capacity());
+    EXPECT_EQ(16u, bklib::ordered_queue<int>(10, 16).capacity());
+}
+
+TEST(OrderedQueue, InOrder) {
+    static size_t const COUNT = 5000;
+
+    //move only, and leaks if a value is dropped without being destroyed.
+    typedef std::unique_ptr<size_t> value_t;
+
+    bklib::ordered_queue<value_t> queue(COUNT, 8);
+    bklib::thread_pool            pool(4);
+
+    std::thread feeder([&] {
+        pool.parallel_for(pool.size(), [&](size_t) {
+            for (size_t i = 0; queue.claim(i);) {
+                queue.push(i, value_t(new size_t(i)));
+            }
+        });
+    });
+
+    size_t next = 0;
+    while (queue.pop([&](value_t v) { EXPECT_EQ(next++, *v); })) {
+    }
+
+    feeder.join();
+    EXPECT_EQ(COUNT, next);
+}
+
+TEST(OrderedQueue, Close) {
+    bklib::ordered_queue<int> queue(10, 2);
+
+    size_t i = 0;
+    EXPECT_TRUE(queue.claim(i));
+    EXPECT_TRUE(queue.push(i, 1));
+
+    queue.close();
+
+    //a value left in the queue is destroyed with it.
+    EXPECT_FALSE(queue.claim(i));
+    EXPECT_FALSE(queue.push(1, 2));
+    EXPECT_FALSE(queue.pop([](int) { FAIL(); }));
+}
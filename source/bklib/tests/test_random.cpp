@@ -0,0 +1,170 @@
+#include "pch.hpp"
+#include "bklib/random.hpp"
+
+#include <gtest/gtest.h>
+
+TEST(Random, Pcg32Reference) {
+    //values from the reference pcg32-demo.
+    bklib::pcg32 random(42, 54);
+
+    uint32_t const expected[] = {
+        0xA15C02B7, 0x7B47F409, 0xBA1D3330, 0x83D2F293, 0xBFA4784B, 0xCBED606E
+    };
+
+    for (auto const e : expected) {
+        EXPECT_EQ(e, random());
+    }
+}
+
+TEST(Random, ByValue) {
+    bklib::random_engine a(1984);
+    auto b = a;
+
+    EXPECT_EQ(a, b);
+
+    for (int i = 0; i < 10; ++i) a();
+    EXPECT_NE(a, b);
+
+    for (int i = 0; i < 10; ++i) b();
+    EXPECT_EQ(a, b);
+}
+
+TEST(Random, Split) {
+    bklib::random_engine a(1984);
+    auto const before = a;
+
+    auto b = a.split();
+    auto c = a.split();
+
+    EXPECT_EQ(before, b);
+    EXPECT_NE(b, c);
+    EXPECT_NE(a, c);
+
+    auto d = before;
+    d.jump();
+    EXPECT_EQ(c, d);
+
+    bklib::pcg32 p(1984);
+    auto q = p.split();
+    EXPECT_NE(p, q);
+}
+
+TEST(Random, Pcg32Advance) {
+    bklib::pcg32 a(7, 3);
+    auto b = a;
+
+    for (int i = 0; i < 1000; ++i) a();
+    b.advance(1000);
+
+    EXPECT_EQ(a, b);
+    EXPECT_EQ(a(), b());
+}
+
+TEST(Random, Bounded) {
+    static uint32_t const N     = 6;
+    static unsigned const COUNT = 60000;
+
+    bklib::random_engine random(1984);
+    unsigned counts[N] = {0};
+
+    for (unsigned i = 0; i < COUNT; ++i) {
+        auto const x = bklib::random_bounded(random, N);
+        ASSERT_LT(x, N);
+        counts[x]++;
+    }
+
+    for (auto const c : counts) {
+        EXPECT_NEAR(COUNT / N, c, COUNT / N / 20);
+    }
+
+    EXPECT_EQ(0U, bklib::random_bounded(random, 1));
+}
+
+TEST(Random, UniformInt) {
+    bklib::random_engine random(1984);
+
+    auto const dist = bklib::uniform_int<int>(-3, 3);
+    bool seen[7] = {false};
+
+    for (int i = 0; i < 1000; ++i) {
+        auto const x = dist(random);
+        ASSERT_GE(x, -3);
+        ASSERT_LE(x, 3);
+        seen[x + 3] = true;
+    }
+
+    for (auto const s : seen) {
+        EXPECT_TRUE(s);
+    }
+
+    auto const full = bklib::uniform_int<uint32_t>(
+        0, std::numeric_limits<uint32_t>::max()
+    );
+    full(random);
+}
+
+TEST(Random, FillUniform) {
+    bklib::random_engine a(1984);
+    auto b = a;
+
+    uint32_t values[5];
+    bklib::fill_uniform(a, values, values + 5);
+
+    auto const x = b();
+    auto const y = b();
+    auto const z = b();
+
+    EXPECT_EQ(static_cast<uint32_t>(x >> 32), values[0]);
+    EXPECT_EQ(static_cast<uint32_t>(x),       values[1]);
+    EXPECT_EQ(static_cast<uint32_t>(y >> 32), values[2]);
+    EXPECT_EQ(static_cast<uint32_t>(y),       values[3]);
+    EXPECT_EQ(static_cast<uint32_t>(z >> 32), values[4]);
+
+    uint32_t bounded[100];
+    bklib::fill_uniform(a, bounded, bounded + 100, 10);
+
+    for (auto const v : bounded) {
+        EXPECT_LT(v, 10U);
+    }
+}
+
+TEST(Random, HashRandomIsStateless) {
+    bklib::hash_random const random(1984);
+
+    //same inputs, same outputs, in any order.
+    std::vector<uint64_t> forward, backward;
+    for (int x = 0; x < 16; ++x)  forward.push_back(random(x, 3, 1));
+    for (int x = 15; x >= 0; --x) backward.push_back(random(x, 3, 1));
+    std::reverse(backward.begin(), backward.end());
+
+    EXPECT_EQ(forward, backward);
+
+    //every argument matters.
+    EXPECT_NE(random(1, 2, 1), random(2, 1, 1));
+    EXPECT_NE(random(1, 2, 1), random(1, 2, 2));
+    EXPECT_NE(random(1, 2, 1), bklib::hash_random(1985)(1, 2, 1));
+    EXPECT_NE(random(-1, 0, 1), random(0, -1, 1));
+}
+
+TEST(Random, HashRandomBounded) {
+    static uint32_t const N = 5;
+    bklib::hash_random const random(7);
+
+    unsigned counts[N] = {0};
+    for (int y = 0; y < 100; ++y) {
+        for (int x = 0; x < 100; ++x) {
+            auto const v = random.bounded(x, y, 0, N);
+            ASSERT_LT(v, N);
+            EXPECT_EQ(v, random.bounded(x, y, 0, N));
+            counts[v]++;
+        }
+    }
+
+    for (auto const c : counts) {
+        EXPECT_NEAR(10000 / N, c, 10000 / N / 10);
+    }
+
+    auto a = random.engine_at(4, 5, 6);
+    auto b = random.engine_at(4, 5, 6);
+    EXPECT_EQ(a(), b());
+}
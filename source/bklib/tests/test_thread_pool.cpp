@@ -0,0 +1,53 @@
+#include "pch.hpp"
+#include "bklib/thread_pool.hpp"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+
+TEST(ThreadPool, VisitsEachIndexOnce) {
+    static size_t const COUNT = 1000;
+
+    bklib::thread_pool pool(4);
+    EXPECT_EQ(4U, pool.size());
+
+    std::vector<std::atomic<unsigned>> visits(COUNT);
+    for (auto& v : visits) v = 0;
+
+    pool.parallel_for(COUNT, [&](size_t const i) {
+        ++visits[i];
+    });
+
+    for (auto const& v : visits) {
+        EXPECT_EQ(1U, v.load());
+    }
+
+    //reusable
+    pool.parallel_for(COUNT, [&](size_t const i) {
+        ++visits[i];
+    });
+
+    for (auto const& v : visits) {
+        EXPECT_EQ(2U, v.load());
+    }
+}
+
+TEST(ThreadPool, Empty) {
+    bklib::thread_pool pool(2);
+
+    bool called = false;
+    pool.parallel_for(0, [&](size_t) { called = true; });
+
+    EXPECT_FALSE(called);
+}
+
+TEST(ThreadPool, Exception) {
+    bklib::thread_pool pool(3);
+
+    EXPECT_THROW(
+        pool.parallel_for(10, [](size_t const i) {
+            if (i == 7) throw std::runtime_error("job failed");
+        }),
+        std::runtime_error
+    );
+}
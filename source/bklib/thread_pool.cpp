@@ -0,0 +1,126 @@
+#include "pch.hpp"
+#include "thread_pool.hpp"
+
+using bklib::thread_pool;
+
+thread_pool::thread_pool(unsigned threads)
+    : job_(nullptr)
+    , generation_(0)
+    , busy_(0)
+    , stop_(false)
+{
+    if (threads == 0) {
+        threads = std::thread::hardware_concurrency();
+    }
+
+    if (threads == 0) {
+        threads = 1;
+    }
+
+    slices_.reset(new slice[threads]);
+
+    workers_.reserve(threads);
+    for (unsigned i = 0; i < threads; ++i) {
+        workers_.emplace_back([this, i] { worker_main_(i); });
+    }
+}
+
+thread_pool::~thread_pool() {
+    {
+        std::lock_guard<std::mutex> lock(lock_);
+        stop_ = true;
+    }
+
+    wake_.notify_all();
+
+    for (auto& worker : workers_) {
+        worker.join();
+    }
+}
+
+void thread_pool::parallel_for(size_t const count, job_t const& job) {
+    if (count == 0) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(lock_);
+
+        size_t const n = workers_.size();
+        for (size_t i = 0; i < n; ++i) {
+            slices_[i].first = count * i / n;
+            slices_[i].last  = count * (i + 1) / n;
+        }
+
+        job_   = &job;
+        busy_  = size();
+        error_ = nullptr;
+        ++generation_;
+    }
+
+    wake_.notify_all();
+
+    std::unique_lock<std::mutex> lock(lock_);
+    done_.wait(lock, [&] { return busy_ == 0; });
+
+    job_ = nullptr;
+
+    if (error_) {
+        std::rethrow_exception(error_);
+    }
+}
+
+void thread_pool::worker_main_(unsigned const index) {
+    unsigned seen = 0;
+
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(lock_);
+            wake_.wait(lock, [&] { return stop_ || generation_ != seen; });
+
+            if (stop_) return;
+            seen = generation_;
+        }
+
+        for (size_t i = 0; next_index_(index, i);) {
+            try {
+                (*job_)(i);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(lock_);
+                if (!error_) error_ = std::current_exception();
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(lock_);
+        if (--busy_ == 0) {
+            done_.notify_all();
+        }
+    }
+}
+
+bool thread_pool::next_index_(unsigned const index, size_t& out) {
+    //take from the front of our own slice
+    {
+        auto& own = slices_[index];
+        std::lock_guard<std::mutex> lock(own.lock);
+
+        if (own.first < own.last) {
+            out = own.first++;
+            return true;
+        }
+    }
+
+    //steal from the back of another
+    auto const n = size();
+    for (unsigned i = 1; i < n; ++i) {
+        auto& other = slices_[(index + i) % n];
+        std::lock_guard<std::mutex> lock(other.lock);
+
+        if (other.first < other.last) {
+            out = --other.last;
+            return true;
+        }
+    }
+
+    return false;
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include "config.hpp"
+
+#include <vector>
+#include <memory>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+
+namespace bklib {
+
+//==============================================================================
+//! A fixed set of worker threads for data parallel loops.
+//!
+//! Each call to parallel_for gives every worker a contiguous slice of the
+//! index range; a worker that runs out of work steals single indices from the
+//! back of the other slices.
+//!
+//! @remark parallel_for must not be called concurrently or from a job.
+//==============================================================================
+class thread_pool {
+public:
+    typedef std::function<void (size_t i)> job_t;
+
+    //--------------------------------------------------------------------------
+    //! @param threads the number of workers; 0 for one per hardware thread.
+    //--------------------------------------------------------------------------
+    explicit thread_pool(unsigned threads = 0);
+    ~thread_pool();
+
+    unsigned size() const {
+        return static_cast<unsigned>(workers_.size());
+    }
+
+    //--------------------------------------------------------------------------
+    //! Call @p job for each index in [0, count) and wait for all of them to
+    //! finish. The first exception thrown by a job is rethrown here.
+    //--------------------------------------------------------------------------
+    void parallel_for(size_t count, job_t const& job);
+private:
+    thread_pool(thread_pool const&)            BK_DELETE;
+    thread_pool& operator=(thread_pool const&) BK_DELETE;
+
+    struct slice {
+        std::mutex lock;
+        size_t     first;
+        size_t     last;
+    };
+
+    void worker_main_(unsigned index);
+    bool next_index_(unsigned index, size_t& out);
+
+    std::vector<std::thread> workers_;
+    std::unique_ptr<slice[]> slices_; //!< One per worker.
+
+    std::mutex              lock_;
+    std::condition_variable wake_;
+    std::condition_variable done_;
+
+    job_t const*       job_;        //!< The current job.
+    unsigned           generation_; //!< Incremented for each parallel_for.
+    unsigned           busy_;       //!< Workers yet to finish the current job.
+    bool               stop_;
+    std::exception_ptr error_;
+};
+
+} //namespace bklib
@@ -18,10 +18,9 @@ struct make_distance_type {
 };
 
 template <typename T>
-struct make_distance_type<T, false> {
-    typedef typename std::enable_if<
-        std::is_floating_point<T>::value, T
-    >::type type;
+struct make_distance_type<T, false>
+    : std::enable_if<std::is_floating_point<T>::value, T>
+{
 };
 
 //==============================================================================
@@ -107,50 +106,6 @@ struct min_max {
     T min, max;
 };
 
-//==============================================================================
-//! Wraps a random number generator to abstract away the differences.
-//! @tparam T a numeric type.
-//==============================================================================
-template <typename T = unsigned>
-class random_wrapper {
-public:
-    typedef T result_type;
-
-    //!TODO cleanup this condition
-    template <typename U>
-    random_wrapper(U&& gen,
-        typename std::enable_if<
-            std::is_convertible<
-                typename std::result_of<U()>::type,
-                result_type
-            >::value &&
-            !std::is_same<
-                typename std::remove_reference<U>::type,
-                random_wrapper
-            >::value
-        >::type* = nullptr
-    )
-        : gen_([&] { return gen(); })
-    {
-    }
-
-    result_type operator()() {
-        return gen_();
-    }
-
-    static result_type min() { return std::numeric_limits<T>::min(); }
-    static result_type max() { return std::numeric_limits<T>::max(); }
-private:
-    std::function<result_type ()> gen_;
-};
-
-template <typename T>
-inline auto make_random_wrapper(T& random)
-    -> random_wrapper<typename std::result_of<T()>::type>
-{
-    return random_wrapper<typename T::result_type>(random);
-}
-
 template <typename T, typename U>
 class discriminated_union {
 public:
@@ -207,17 +162,14 @@ public:
     }
 
     template <typename V>
-    bool is_type() const;
-
-    template <>
-    bool is_type<a_type>() const { return is_a_type_; }
-
-    template <>
-    bool is_type<b_type>() const { return !is_a_type_; }
+    bool is_type() const { return is_type_(static_cast<V*>(nullptr)); }
 
     explicit operator a_type&() { return get_a_(); }
     explicit operator b_type&() { return get_b_(); }
 private:
+    bool is_type_(a_type*) const { return is_a_type_; }
+    bool is_type_(b_type*) const { return !is_a_type_; }
+
     template <typename... Types>
     discriminated_union(a_type*, Types&&... params)
         : is_a_type_(true)
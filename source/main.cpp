@@ -1,8 +1,9 @@
 #include "pch.hpp"
 #include "platform/window.hpp"
 #include "platform/d2d_renderer.hpp"
-#include "tez/map_layout.hpp"
-#include "tez/room_generator.hpp"
+#include "tez/map_pipeline.hpp"
+#include "tez/tile_properties.hpp"
+#include "tez/generation_params.hpp"
 
 //#include "targa.hpp"
 //#include "quad_tree.hpp"
@@ -53,6 +54,30 @@
 //
 //////////////////////////////////////////////////////////////////////////////////
 
+namespace {
+
+char const GENERATION_DEF[] = "data/generation.def";
+char const TILE_TYPES_DEF[] = "data/tile_types.def";
+
+//==============================================================================
+//! (Re)load the data files. A file that fails to load leaves the values it
+//! would have replaced as they were.
+//==============================================================================
+void load_data_files() {
+    try {
+        tez::reload_generation_params(GENERATION_DEF);
+    } catch (tez::bad_generation_params const& e) {
+        std::cerr << boost::diagnostic_information(e) << std::endl;
+    }
+
+    try {
+        tez::load_tile_types(TILE_TYPES_DEF);
+    } catch (tez::bad_tile_types const& e) {
+        std::cerr << boost::diagnostic_information(e) << std::endl;
+    }
+}
+
+} //namespace
 
 int main() {
     using bklib::window;
@@ -76,25 +101,14 @@ int main() {
 
     //world the_world;
 
-    std::default_random_engine engine(::GetTickCount());
-    auto random = bklib::make_random_wrapper(engine);
+    load_data_files();
 
-    auto gen_simple   = tez::simple_room_generator(random);
-    auto gen_compound = tez::compound_room_generator(random);
+    tez::map_pipeline pipeline;
+    uint64_t          seed = ::GetTickCount();
 
-    auto const make_map = [&] {
-        tez::map_layout layout(random);
-
-        for (int i = 0; i < 20; ++i) {
-            if (i % 4 == 0) {
-                layout.add_room(gen_compound.generate());
-            } else {
-                layout.add_room(gen_simple.generate());
-            }
-        }
-    
-        layout.normalize();
-        return layout.make_map();
+    auto const make_map = [&]() -> tez::map {
+        auto m = pipeline.run(seed++);
+        return std::move(m.result);
     };
 
     auto test_map = make_map();
@@ -111,6 +125,11 @@ int main() {
         case VK_SPACE :
             test_map = make_map();
             break;
+        case VK_F5 :
+            //the rooms of the new map are made with the reloaded values.
+            load_data_files();
+            test_map = make_map();
+            break;
         case VK_ADD :
             renderer.zoom_in();
             break;
@@ -145,16 +164,8 @@ int main() {
         
         for (unsigned y = 0; y < test_map.height(); ++y) {
             for (unsigned x = 0; x < test_map.width(); ++x) {
-                unsigned index = 0;
-                
-                switch (test_map.at(x, y).type) {
-                case tez::tile_category::empty :    index = 0; break;
-                case tez::tile_category::wall :     index = 2; break;
-                case tez::tile_category::ceiling :  index = 24; break;
-                case tez::tile_category::floor :    index = 1; break;
-                case tez::tile_category::door :     index = 32; break;
-                case tez::tile_category::corridor : index = 20; break;
-                }
+                auto const index =
+                    tez::tile_atlas_index(test_map.at(x, y).type);
                 
                 renderer.draw_bitmap(index, bklib::make_point(x, y));
             }
@@ -1,11 +1,17 @@
 #pragma once
 
-#pragma warning(push, 3)
+#include "bklib/config.hpp"
 
-#include <Windows.h>
+#if defined(BK_COMPILER_MSVC)
+#   pragma warning(push, 3)
+#endif
 
-#include <d2d1.h>
-#include <wincodec.h>
+#if defined(BK_PLATFORM_WINDOWS)
+#   include <Windows.h>
+
+#   include <d2d1.h>
+#   include <wincodec.h>
+#endif
 
 #include <memory>
 #include <functional>
@@ -33,6 +39,8 @@ inline T clone(T const value) {
     return value;
 }
 
+//library support for these came with C++14.
+#if __cplusplus < 201402L
 namespace std {
 
 template <typename T>
@@ -61,5 +69,8 @@ auto inline cend(T const& container) -> decltype(container.cend())
 
 
 } // std
+#endif
 
-#pragma warning(pop)
+#if defined(BK_COMPILER_MSVC)
+#   pragma warning(pop)
+#endif
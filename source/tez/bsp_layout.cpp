@@ -0,0 +1,226 @@
+#include "pch.hpp"
+#include "bsp_layout.hpp"
+
+#include "map.hpp"
+#include "map_layout.hpp"
+#include "room_generator.hpp"
+#include "bklib/thread_pool.hpp"
+
+namespace {
+
+//! Levels split in order before the subtrees are handed out; up to 64.
+static unsigned const SERIAL_DEPTH = 6;
+static unsigned const NO_LIMIT     = ~0u;
+
+//! The smallest region a simple room fits in with its gap.
+static unsigned const MIN_SIZE = 5;
+
+} //namespace
+
+tez::bsp_layout::bsp_layout(random_t random, bsp_params const params)
+    : hash_(random())
+    , params_(params)
+    , leaf_count_(0)
+{
+    BK_ASSERT(params_.min_size >= MIN_SIZE);
+    BK_ASSERT(params_.width  >= params_.min_size);
+    BK_ASSERT(params_.height >= params_.min_size);
+}
+
+size_t tez::bsp_layout::capacity_(unsigned const w, unsigned const h) const {
+    //every leaf is at least min_size on a side.
+    auto const side   = static_cast<size_t>(params_.min_size);
+    auto const leaves = (static_cast<size_t>(w) * h) / (side * side);
+
+    return 2 * leaves - 1;
+}
+
+void tez::bsp_layout::split_(
+    uint32_t const               i,
+    unsigned const               depth,
+    unsigned const               depth_limit,
+    uint32_t&                    next,
+    std::vector<uint32_t>* const frontier
+) {
+    if (depth == depth_limit) {
+        if (frontier) frontier->push_back(i);
+        return;
+    }
+
+    auto const node = nodes_[i];
+    auto const min_size = params_.min_size;
+
+    bool const can_x = node.w >= 2*min_size;
+    bool const can_y = node.h >= 2*min_size;
+
+    if ((!can_x && !can_y) || depth >= params_.max_depth) {
+        return;
+    }
+
+    auto random = hash_.engine_at(
+        node.x, node.y, tez::random_purpose::bsp + (depth << 8)
+    );
+
+    if (bklib::random_bounded(random, 100u) < depth * params_.stop_percent) {
+        return;
+    }
+
+    //across the longer side, within the middle half.
+    bool const split_x = can_x && (!can_y || node.w >= node.h);
+
+    auto const dim = split_x ? node.w : node.h;
+    auto const lo  = bklib::max(min_size, dim / 4);
+    auto const hi  = bklib::min(dim - min_size, dim - dim / 4);
+    auto const at  = lo + bklib::random_bounded(random, hi - lo + 1);
+
+    auto const first  = next++;
+    auto const second = next++;
+
+    auto& a = nodes_[first];
+    auto& b = nodes_[second];
+
+    a = node;
+    b = node;
+    a.first = a.second = b.first = b.second = bsp_node::NONE;
+
+    if (split_x) {
+        a.w  = at;
+        b.x += at;
+        b.w -= at;
+    } else {
+        a.h  = at;
+        b.y += at;
+        b.h -= at;
+    }
+
+    nodes_[i].first  = first;
+    nodes_[i].second = second;
+
+    split_(first,  depth + 1, depth_limit, next, frontier);
+    split_(second, depth + 1, depth_limit, next, frontier);
+}
+
+void tez::bsp_layout::generate(bklib::thread_pool* const pool) {
+    auto const total = capacity_(params_.width, params_.height);
+    auto const head  = bklib::min(total, (size_t(2) << SERIAL_DEPTH) - 1);
+
+    //the subtrees below need at most total + 1 between them.
+    nodes_.clear();
+    nodes_.reserve(head + total + 1);
+    frontier_.clear();
+
+    //--------------------------------------------------------------------------
+    // The top levels, in order.
+    //--------------------------------------------------------------------------
+    nodes_.resize(head);
+
+    bsp_node const root = {0, 0, params_.width, params_.height, 0, 0};
+    nodes_[0] = root;
+
+    uint32_t head_used = 1;
+    split_(0, 0, SERIAL_DEPTH, head_used, &frontier_);
+
+    //--------------------------------------------------------------------------
+    // Each subtree gets its own segment of the arena to fill.
+    //--------------------------------------------------------------------------
+    auto const count = frontier_.size();
+    segments_.resize(count);
+
+    size_t end = head;
+    for (size_t k = 0; k < count; ++k) {
+        auto const& node = nodes_[frontier_[k]];
+        auto const  at   = static_cast<uint32_t>(end);
+
+        segments_[k] = std::make_pair(at, at);
+        end += capacity_(node.w, node.h) - 1; //less the subtree root.
+    }
+
+    BK_ASSERT(end <= nodes_.capacity());
+    nodes_.resize(end);
+
+    auto const split_subtree = [&](size_t const k) {
+        auto& segment = segments_[k];
+        split_(frontier_[k], SERIAL_DEPTH, NO_LIMIT, segment.second, nullptr);
+    };
+
+    if (pool) {
+        pool->parallel_for(count, split_subtree);
+    } else {
+        for (size_t k = 0; k < count; ++k) split_subtree(k);
+    }
+
+    //--------------------------------------------------------------------------
+    // Close the gaps between the segments.
+    //--------------------------------------------------------------------------
+    auto write = head_used;
+
+    for (size_t k = 0; k < count; ++k) {
+        auto const begin = segments_[k].first;
+        auto const last  = segments_[k].second;
+        auto const delta = begin - write;
+
+        auto const move_children = [delta](bsp_node& node) {
+            if (node.is_leaf()) return;
+            node.first  -= delta;
+            node.second -= delta;
+        };
+
+        if (delta) {
+            move_children(nodes_[frontier_[k]]);
+            for (auto j = begin; j < last; ++j) move_children(nodes_[j]);
+
+            std::copy(
+                nodes_.begin() + begin, nodes_.begin() + last,
+                nodes_.begin() + write
+            );
+        }
+
+        write += last - begin;
+    }
+
+    nodes_.resize(write);
+
+    leaf_count_ = static_cast<unsigned>(std::count_if(
+        nodes_.begin(), nodes_.end(), [](bsp_node const& n) {
+            return n.is_leaf();
+        }
+    ));
+}
+
+tez::room tez::bsp_layout::make_room_(bsp_node const& leaf) {
+    auto result = simple_room_generator::make(prefabs_, leaf.w - 1, leaf.h - 1);
+    result.translate_to(leaf.x, leaf.y);
+
+    return result;
+}
+
+std::vector<tez::room> tez::bsp_layout::make_rooms() {
+    std::vector<room> result;
+    result.reserve(leaf_count_);
+
+    for_each_leaf([&](bsp_node const& leaf) {
+        result.emplace_back(make_room_(leaf));
+    });
+
+    return result;
+}
+
+unsigned tez::bsp_layout::add_to(map_layout& layout) {
+    unsigned placed = 0;
+
+    for_each_leaf([&](bsp_node const& leaf) {
+        if (layout.place_room(make_room_(leaf))) placed++;
+    });
+
+    return placed;
+}
+
+tez::map tez::bsp_layout::make_map() {
+    auto result = map(params_.width, params_.height);
+
+    for_each_leaf([&](bsp_node const& leaf) {
+        result.add_room(make_room_(leaf));
+    });
+
+    return result;
+}
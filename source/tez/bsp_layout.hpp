@@ -0,0 +1,159 @@
+#pragma once
+
+#include "bklib/util.hpp"
+#include "bklib/random.hpp"
+#include "bklib/geometry.hpp"
+
+#include "room.hpp"
+#include "room_prefab.hpp"
+
+#include <vector>
+#include <cstdint>
+#include <utility>
+
+namespace bklib { class thread_pool; }
+
+namespace tez {
+
+class map;
+class map_layout;
+
+//==============================================================================
+//! Parameters for bsp_layout.
+//==============================================================================
+struct bsp_params {
+    bsp_params()
+        : width(80)
+        , height(60)
+        , min_size(5)
+        , max_depth(16)
+        , stop_percent(5)
+    {
+    }
+
+    unsigned width;        //!< Of the area to split; at least min_size.
+    unsigned height;       //!< Of the area to split; at least min_size.
+    unsigned min_size;     //!< Smallest side of a region; at least 5.
+    unsigned max_depth;    //!< Regions this deep are never split.
+    unsigned stop_percent; //!< Per level, the chance a region stops splitting.
+};
+
+//==============================================================================
+//! A region of a bsp_layout; the children are indices into the same arena, or
+//! both NONE for a leaf.
+//==============================================================================
+struct bsp_node {
+    static uint32_t const NONE = 0; //!< The root is never a child.
+
+    bool is_leaf() const { return first == NONE; }
+
+    unsigned x;
+    unsigned y;
+    unsigned w;
+    unsigned h;
+    uint32_t first;  //!< West or north part.
+    uint32_t second; //!< East or south part.
+};
+
+//==============================================================================
+//! Binary space partition of a rectangle into rooms.
+//!
+//! A region is split across its longer side, near the middle, until it is too
+//! small to split, too deep, or stops by chance. Every leaf holds a simple
+//! room filling it but for a one tile gap to the east and south.
+//!
+//! Each split is a function of the seed and the position and depth of the
+//! region only, so subtrees are split independently, in parallel if asked,
+//! and the result is the same for any number of threads. Nodes live in one
+//! arena sized from the area up front; regenerating reuses it.
+//==============================================================================
+class bsp_layout {
+public:
+    typedef bklib::random_engine  random_t;
+    typedef std::vector<bsp_node> node_list;
+    typedef room::rect_t          rect_t;
+
+    bsp_layout(random_t random, bsp_params params = bsp_params());
+
+    //--------------------------------------------------------------------------
+    //! Split the area; the top levels in order, then the subtrees below them
+    //! on @p pool if given.
+    //--------------------------------------------------------------------------
+    void generate(bklib::thread_pool* pool = nullptr);
+
+    //--------------------------------------------------------------------------
+    //! The nodes in the order they were made; the root is first.
+    //--------------------------------------------------------------------------
+    node_list const& nodes() const { return nodes_; }
+
+    unsigned leaf_count() const { return leaf_count_; }
+
+    //--------------------------------------------------------------------------
+    //! Call f(node) for each leaf, west and north parts first.
+    //--------------------------------------------------------------------------
+    template <typename F>
+    void for_each_leaf(F&& f) const {
+        if (nodes_.empty()) return;
+        for_each_leaf_(0, f);
+    }
+
+    //--------------------------------------------------------------------------
+    //! The room for each leaf, in for_each_leaf order, placed where it lies.
+    //--------------------------------------------------------------------------
+    std::vector<room> make_rooms();
+
+    //--------------------------------------------------------------------------
+    //! Place every room in @p layout, which then connects them in make_map.
+    //! @returns the number of rooms placed.
+    //--------------------------------------------------------------------------
+    unsigned add_to(map_layout& layout);
+
+    //--------------------------------------------------------------------------
+    //! A map of the whole area with every room and no corridors.
+    //--------------------------------------------------------------------------
+    map make_map();
+
+    bsp_params const& params() const { return params_; }
+    prefab_cache const& prefabs() const { return prefabs_; }
+private:
+    template <typename F>
+    void for_each_leaf_(uint32_t const i, F& f) const {
+        auto const& node = nodes_[i];
+
+        if (node.is_leaf()) {
+            f(node);
+        } else {
+            for_each_leaf_(node.first, f);
+            for_each_leaf_(node.second, f);
+        }
+    }
+
+    //! Upper bound on the nodes in a tree over a w x h region.
+    size_t capacity_(unsigned w, unsigned h) const;
+
+    //! Split node @p i and its children into the arena from @p next; stops
+    //! at @p depth_limit, adding those nodes to @p frontier if given.
+    void split_(
+        uint32_t               i,
+        unsigned               depth,
+        unsigned               depth_limit,
+        uint32_t&              next,
+        std::vector<uint32_t>* frontier
+    );
+
+    room make_room_(bsp_node const& leaf);
+
+    bklib::hash_random hash_;
+    bsp_params         params_;
+    prefab_cache       prefabs_;
+
+    node_list nodes_;    //!< The arena.
+    unsigned leaf_count_;
+
+    typedef std::pair<uint32_t, uint32_t> segment_t;
+
+    std::vector<uint32_t>  frontier_; //!< Roots of the parallel subtrees.
+    std::vector<segment_t> segments_; //!< Arena range of each subtree.
+};
+
+} //namespace tez
@@ -1,5 +1,7 @@
 #pragma once
 
+#include "bklib/random.hpp"
+
 #include <type_traits>
 
 namespace tez {
@@ -69,7 +71,7 @@ inline direction prev_cardinal_direction(direction const d) {
 template <typename T>
 inline direction random_cardinal_direction(T& random) {
     return static_cast<direction>(
-        std::uniform_int_distribution<>(0, 3)(random)
+        bklib::random_bounded(random, NUM_CARDINAL_DIR)
     );
 }
 
@@ -0,0 +1,199 @@
+#include "pch.hpp"
+#include "generation_params.hpp"
+
+#include <boost/property_tree/ptree.hpp>
+#include <boost/property_tree/json_parser.hpp>
+
+#include <fstream>
+#include <limits>
+
+namespace {
+
+namespace pt = boost::property_tree;
+
+typedef tez::generation_source source_t;
+typedef tez::generation_params params_t;
+
+void fail(std::string const& name) {
+    BOOST_THROW_EXCEPTION(
+        tez::bad_generation_params() << tez::param_name_info(name)
+    );
+}
+
+unsigned read_unsigned(pt::ptree const& tree, std::string const& name) {
+    auto const value = tree.get_value_optional<int64_t>();
+
+    if (!value || *value < 0 ||
+        *value > std::numeric_limits<unsigned>::max()
+    ) {
+        fail(name);
+    }
+
+    return static_cast<unsigned>(*value);
+}
+
+//==============================================================================
+//! "name": {"uniform": [min, max]}
+//==============================================================================
+void read_range(
+    pt::ptree const&   tree,
+    std::string const& name,
+    source_t::range&   out
+) {
+    auto const node = tree.get_child_optional(name);
+    if (!node) return;
+
+    auto const uniform = node->get_child_optional("uniform");
+    if (!uniform || uniform->size() != 2) fail(name);
+
+    auto it = uniform->begin();
+    out.min = read_unsigned((it++)->second, name);
+    out.max = read_unsigned((it++)->second, name);
+}
+
+void read_weight(
+    pt::ptree const&   tree,
+    std::string const& name,
+    unsigned&          out
+) {
+    auto const node = tree.get_child_optional(name);
+    if (node) out = read_unsigned(*node, name);
+}
+
+params_t::distribution_t make_distribution(
+    source_t::range const range,
+    unsigned const        lowest,
+    char const* const     name
+) {
+    if (range.min < lowest || range.min > range.max) fail(name);
+    return params_t::distribution_t(range.min, range.max);
+}
+
+//==============================================================================
+//! Onward steps are weighted primary, sideways secondary and back tertiary.
+//==============================================================================
+params_t::path_table_t make_path_table(
+    source_t::corridor_weights const weights,
+    tez::direction const             dir
+) {
+    auto const back = tez::opposite_direction(dir);
+
+    return params_t::path_table_t([&](unsigned const i) {
+        auto const to = static_cast<tez::direction>(i);
+
+        return (to == dir)  ? weights.primary  :
+               (to == back) ? weights.tertiary : weights.secondary;
+    });
+}
+
+source_t::corridor_weights const& checked(
+    source_t::corridor_weights const& weights
+) {
+    //the weights are scaled by the number of directions when tabulated.
+    static uint64_t const MAX_TOTAL = std::numeric_limits<uint32_t>::max();
+
+    auto const total = uint64_t(weights.primary) + weights.tertiary
+                     + uint64_t(weights.secondary) * 2;
+
+    if (total == 0 || total > MAX_TOTAL) fail("regular_corridor");
+    return weights;
+}
+
+//! The block new generators are made with.
+tez::shared_generation_params current_params =
+    std::make_shared<tez::generation_params const>();
+
+} //namespace
+
+tez::generation_source::generation_source() {
+    range const simple_width_default  = {3, 10};
+    range const simple_height_default = {4, 10};
+    range const cell_size_default     = {4, 6};
+    range const cell_count_default    = {10, 20};
+
+    corridor_weights const corridor_default = {800, 20, 10};
+
+    simple_width     = simple_width_default;
+    simple_height    = simple_height_default;
+    cell_size        = cell_size_default;
+    cell_count       = cell_count_default;
+    regular_corridor = corridor_default;
+}
+
+tez::generation_source tez::parse_generation_source(std::istream& in) {
+    pt::ptree tree;
+
+    try {
+        pt::read_json(in, tree);
+    } catch (pt::json_parser_error const& e) {
+        BOOST_THROW_EXCEPTION(
+            bad_generation_params()
+                << param_name_info(e.message())
+                << boost::errinfo_at_line(static_cast<int>(e.line()))
+        );
+    }
+
+    generation_source result;
+
+    read_range(tree, "simple_room.width",        result.simple_width);
+    read_range(tree, "simple_room.height",       result.simple_height);
+    read_range(tree, "compound_room.cell_size",  result.cell_size);
+    read_range(tree, "compound_room.cell_count", result.cell_count);
+
+    auto& corridor = result.regular_corridor;
+    read_weight(tree, "regular_corridor.primary",   corridor.primary);
+    read_weight(tree, "regular_corridor.secondary", corridor.secondary);
+    read_weight(tree, "regular_corridor.tertiary",  corridor.tertiary);
+
+    return result;
+}
+
+tez::generation_params::generation_params(generation_source const& source)
+    : simple_width_(make_distribution(
+        source.simple_width, 3, "simple_room.width"))
+    , simple_height_(make_distribution(
+        source.simple_height, 4, "simple_room.height"))
+    , cell_size_(make_distribution(
+        source.cell_size, 1, "compound_room.cell_size"))
+    , cell_count_(make_distribution(
+        source.cell_count, 1, "compound_room.cell_count"))
+    , path_north_(make_path_table(
+        checked(source.regular_corridor), direction::north))
+    , path_south_(make_path_table(source.regular_corridor, direction::south))
+    , path_east_(make_path_table(source.regular_corridor, direction::east))
+    , path_west_(make_path_table(source.regular_corridor, direction::west))
+{
+}
+
+tez::shared_generation_params
+tez::load_generation_params(std::string const& filename) {
+    std::ifstream in(filename);
+
+    if (!in) {
+        BOOST_THROW_EXCEPTION(
+            bad_generation_params() << boost::errinfo_file_name(filename)
+        );
+    }
+
+    try {
+        return std::make_shared<generation_params const>(
+            parse_generation_source(in)
+        );
+    } catch (bad_generation_params& e) {
+        e << boost::errinfo_file_name(filename);
+        throw;
+    }
+}
+
+tez::shared_generation_params tez::current_generation_params() {
+    return std::atomic_load(&current_params);
+}
+
+void tez::set_generation_params(shared_generation_params params) {
+    BK_ASSERT(params);
+    std::atomic_store(&current_params, std::move(params));
+}
+
+void tez::reload_generation_params(std::string const& filename) {
+    set_generation_params(load_generation_params(filename));
+}
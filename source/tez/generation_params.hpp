@@ -0,0 +1,137 @@
+#pragma once
+
+#include "bklib/util.hpp"
+#include "bklib/random.hpp"
+#include "bklib/alias_table.hpp"
+
+#include "direction.hpp"
+
+#include <boost/exception/all.hpp>
+
+#include <memory>
+#include <string>
+#include <iosfwd>
+
+namespace tez {
+
+//==============================================================================
+//! Thrown when generation.def cannot be read or holds unusable values.
+//==============================================================================
+struct bad_generation_params
+    : virtual boost::exception, virtual std::exception {};
+
+//! The path of the offending value, e.g. "simple_room.width".
+typedef boost::error_info<struct tag_param_name, std::string> param_name_info;
+
+//==============================================================================
+//! The values of generation.def as written; the defaults are the built in
+//! values.
+//==============================================================================
+struct generation_source {
+    struct range {
+        unsigned min;
+        unsigned max;
+    };
+
+    //! Relative weights of the step a corridor takes.
+    struct corridor_weights {
+        unsigned primary;   //!< Onward.
+        unsigned secondary; //!< To either side.
+        unsigned tertiary;  //!< Back.
+    };
+
+    generation_source();
+
+    range simple_width;
+    range simple_height;
+    range cell_size;  //!< Of a compound room cell.
+    range cell_count; //!< Cells in a compound room.
+
+    corridor_weights regular_corridor;
+};
+
+//==============================================================================
+//! Parse the JSON of generation.def; missing values keep their defaults.
+//!
+//! @throws bad_generation_params if a value is not of the right form.
+//==============================================================================
+generation_source parse_generation_source(std::istream& in);
+
+//==============================================================================
+//! A generation_source compiled to the distributions and tables the
+//! generators sample from, so that nothing is looked up while generating.
+//!
+//! Immutable; generators hold the block they were made with, so a reload
+//! only affects generators made after it.
+//==============================================================================
+class generation_params {
+public:
+    typedef bklib::uniform_int<unsigned>         distribution_t;
+    typedef bklib::alias_table<NUM_CARDINAL_DIR> path_table_t;
+
+    //--------------------------------------------------------------------------
+    //! @throws bad_generation_params if @p source is out of range.
+    //--------------------------------------------------------------------------
+    explicit generation_params(
+        generation_source const& source = generation_source()
+    );
+
+    distribution_t const& simple_width()  const { return simple_width_; }
+    distribution_t const& simple_height() const { return simple_height_; }
+    distribution_t const& cell_size()     const { return cell_size_; }
+    distribution_t const& cell_count()    const { return cell_count_; }
+
+    //--------------------------------------------------------------------------
+    //! The step directions of a corridor heading toward @p dir.
+    //--------------------------------------------------------------------------
+    path_table_t const& path_table(direction const dir) const {
+        switch (dir) {
+        case direction::north : return path_north_;
+        case direction::south : return path_south_;
+        case direction::east  : return path_east_;
+        default               : return path_west_;
+        }
+    }
+private:
+    generation_params(generation_params const&)            BK_DELETE;
+    generation_params& operator=(generation_params const&) BK_DELETE;
+
+    distribution_t simple_width_;
+    distribution_t simple_height_;
+    distribution_t cell_size_;
+    distribution_t cell_count_;
+
+    path_table_t path_north_;
+    path_table_t path_south_;
+    path_table_t path_east_;
+    path_table_t path_west_;
+};
+
+typedef std::shared_ptr<generation_params const> shared_generation_params;
+
+//==============================================================================
+//! Read and compile generation.def from @p filename.
+//!
+//! @throws bad_generation_params if it cannot be read or used.
+//==============================================================================
+shared_generation_params load_generation_params(std::string const& filename);
+
+//==============================================================================
+//! The block new generators are made with; the built in values until set.
+//==============================================================================
+shared_generation_params current_generation_params();
+
+//==============================================================================
+//! Atomically replace the current block; generators already made keep theirs.
+//==============================================================================
+void set_generation_params(shared_generation_params params);
+
+//==============================================================================
+//! Load @p filename and make it current. On failure the current block is
+//! left as it was.
+//!
+//! @throws bad_generation_params as load_generation_params.
+//==============================================================================
+void reload_generation_params(std::string const& filename);
+
+} //namespace tez
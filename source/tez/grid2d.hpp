@@ -3,6 +3,7 @@
 #include "bklib/config.hpp"
 #include "bklib/assert.hpp"
 #include "bklib/util.hpp"
+#include "bklib/random.hpp"
 
 #include <memory>
 #include <utility>
@@ -31,13 +32,13 @@ class grid2d {
 public:
     //--------------------------------------------------------------------------
     typedef std::vector<T>                    storage;
-    typedef typename T                        value_type;
+    typedef T                                 value_type;
     typedef typename storage::reference       reference;
     typedef typename storage::const_reference const_reference;
     typedef typename storage::pointer         pointer;
     typedef typename storage::const_pointer   const_pointer;
-    typedef typename grid_iterator<T>         iterator;
-    typedef typename grid_iterator<T const>   const_iterator;
+    typedef grid_iterator<T>                  iterator;
+    typedef grid_iterator<T const>            const_iterator;
     
     typedef std::pair<unsigned, unsigned>     position;
     typedef size_t                            index;
@@ -116,15 +117,15 @@ public:
         out << "grid2d [" << g.width() << ", " << g.height() << "]";
 
         unsigned count = 0;
-        std::for_each(std::cbegin(g), std::cend(g) [](const_reference value) {
-            if (value++ % g.width() == 0) {
+        for (auto const& value : g.data_) {
+            if (count++ % g.width() == 0) {
                 out << '\n';
             }
-            
+
             out << value;
-        });
+        }
 
-        return std::cout << std::endl;
+        return out << std::endl;
     }
 
     void swap(grid2d& other) {
@@ -294,6 +295,33 @@ static void grid_copy_transform(
     }
 }
 
+//==============================================================================
+//! Call function(value, bits) for every value of @p grid, where bits depends
+//! only on @p random, @p purpose and the position offset by (@p origin_x,
+//! @p origin_y); the result does not depend on the order of the visits.
+//==============================================================================
+template <typename T, typename F>
+static void grid_fill_random(
+    grid2d<T>&                grid,
+    bklib::hash_random const& random,
+    uint32_t           const  purpose,
+    F                         function,
+    signed             const  origin_x = 0,
+    signed             const  origin_y = 0
+) {
+    auto const w = grid.width();
+    auto const h = grid.height();
+
+    for (unsigned y = 0; y < h; ++y) {
+        for (unsigned x = 0; x < w; ++x) {
+            auto const gx = origin_x + static_cast<signed>(x);
+            auto const gy = origin_y + static_cast<signed>(y);
+
+            function(grid.at(x, y), random(gx, gy, purpose));
+        }
+    }
+}
+
 template <typename T>
 inline void swap(grid2d<T>& a, grid2d<T>& b) {
     a.swap(b);
@@ -303,6 +331,63 @@ template <typename T>
 inline grid2d<T> clone(grid2d<T> const& grid) {
     return grid.clone();
 }
+
+//==============================================================================
+//! A read only view of width x height values stored a row at a time, such as
+//! those of a grid2d or a mapped file; does not own them.
+//==============================================================================
+template <typename T>
+class grid_view {
+public:
+    typedef T        value_type;
+    typedef T const& const_reference;
+    typedef T const* const_pointer;
+    typedef T const* const_iterator;
+
+    grid_view()
+        : data_(nullptr)
+        , width_(0)
+        , height_(0)
+    {
+    }
+
+    grid_view(T const* const data, unsigned const w, unsigned const h)
+        : data_(data)
+        , width_(w)
+        , height_(h)
+    {
+        BK_ASSERT(data || (w * h == 0));
+    }
+
+    grid_view(grid2d<T> const& grid)
+        : data_(grid.data())
+        , width_(grid.width())
+        , height_(grid.height())
+    {
+    }
+
+    unsigned width()  const { return width_; }
+    unsigned height() const { return height_; }
+    size_t   size()   const { return static_cast<size_t>(width_) * height_; }
+
+    const_pointer data() const { return data_; }
+
+    const_iterator begin() const { return data_; }
+    const_iterator end()   const { return data_ + size(); }
+
+    bool is_valid_position(unsigned const x, unsigned const y) const {
+        return x < width_ && y < height_;
+    }
+
+    const_reference at(unsigned const x, unsigned const y) const {
+        BK_ASSERT(is_valid_position(x, y));
+        return data_[static_cast<size_t>(y) * width_ + x];
+    }
+private:
+    T const* data_;
+    unsigned width_;
+    unsigned height_;
+};
 //==============================================================================
 
 //==============================================================================
@@ -361,7 +446,7 @@ public:
 
     template <typename U, bool C>
     bool operator==(grid_block<U, C> const& rhs) const {
-        return (grid_ == rhs.grid_) && (x_ == rhs.x_) && (y_ == rhs.y_);
+        return (grid_ == rhs.grid_) && (x == rhs.x) && (y == rhs.y);
     }
 
     pointer here()       { return grid_ ? &grid_->at(x, y) : nullptr; }
@@ -435,6 +520,16 @@ class grid_iterator
       >
 {
 public:
+    typedef boost::iterator_facade<
+        grid_iterator<T>,
+        grid_position<T>,
+        boost::random_access_traversal_tag
+    > facade_t;
+
+    typedef typename facade_t::difference_type difference_type;
+    typedef typename facade_t::reference       reference;
+    typedef typename facade_t::value_type      value_type;
+
     typedef typename std::conditional<
         std::is_const<T>::value,
         grid2d<
@@ -538,12 +633,24 @@ class block_iterator
     , public detail::block_iterator_base<T, Const>
 {
 public:
+    typedef boost::iterator_facade<
+        block_iterator<T, Const>,
+        grid_block<T, Const>,
+        boost::random_access_traversal_tag
+    > facade_t;
+
+    typedef detail::block_iterator_base<T, Const> base_t;
+
+    typedef typename facade_t::difference_type difference_type;
+    typedef typename facade_t::reference       reference;
+    typedef typename base_t::grid_type         grid_type;
+
     block_iterator()
     {
     }
 
     block_iterator(grid_type* data, difference_type offset)
-        : block_iterator_base(BK_CHECK_PTR(data), offset)
+        : base_t(BK_CHECK_PTR(data), offset)
     {
     }
 
@@ -553,13 +660,17 @@ public:
             std::is_convertible<U*, T*>::value
         >::type* = nullptr
     )
-        : block_iterator_base(other.data_, other.offset_)
+        : base_t(other.data_, other.offset_)
     {
     }
 private:
     friend class boost::iterator_core_access;
     template <typename, bool> friend class block_iterator;
 
+    using base_t::data_;
+    using base_t::offset_;
+    using base_t::block_;
+
     template <typename U, bool C>
     bool equal(block_iterator<U, C> const& other) const {
         return (data_ == other.data_) && (offset_ == other.offset_);
@@ -1,5 +1,8 @@
 #include "pch.hpp"
 #include "map.hpp"
+#include "world_map.hpp"
+#include "tile_properties.hpp"
+
 
 namespace {
     static tez::tile_data default_tile = {
@@ -11,12 +14,30 @@ namespace {
 
 } //namespace
 
+tez::map::room_id const tez::map::NO_ROOM;
+
 tez::map::map(unsigned width, unsigned height)
     : data_(width, height, default_tile)
+    , room_ids_(width, height, NO_ROOM)
+    , room_count_(0)
+{
+}
+
+tez::map::map(grid_t tiles, room_id_grid_t room_ids, unsigned room_count)
+    : data_(std::move(tiles))
+    , room_ids_(std::move(room_ids))
+    , room_count_(room_count)
 {
+    BK_ASSERT(data_.width()  == room_ids_.width());
+    BK_ASSERT(data_.height() == room_ids_.height());
+    BK_ASSERT(room_count_ <= std::numeric_limits<room_id>::max());
 }
 
-void tez::map::add_room(room const& r, signed dx, signed dy) {
+tez::map::room_id tez::map::add_room(room const& r, signed dx, signed dy) {
+    BK_ASSERT(room_count_ < std::numeric_limits<room_id>::max());
+
+    auto const id = static_cast<room_id>(++room_count_);
+
     grid_copy_transform(
         r,
         0, 0,
@@ -27,6 +48,19 @@ void tez::map::add_room(room const& r, signed dx, signed dy) {
             dest_data.type = src_cat;
         }
     );
+
+    grid_copy_transform(
+        r,
+        0, 0,
+        r.width(), r.height(),
+        room_ids_,
+        r.left() + dx, r.top() + dy,
+        [id](tile_category const& src_cat, room_id& dest_id) {
+            if (src_cat != tile_category::empty) dest_id = id;
+        }
+    );
+
+    return id;
 }
 
 std::ostream& tez::operator<<(std::ostream& out, tez::map const& m) {
@@ -36,7 +70,7 @@ std::ostream& tez::operator<<(std::ostream& out, tez::map const& m) {
     auto const w = m.width();
 
     for (unsigned y = 0; y < h; ++y) {
-        std::cout << std::endl;
+        out << std::endl;
 
         for (unsigned x = 0; x < w; ++x) {
             auto const& tile = m.data_.at(x, y);
@@ -48,69 +82,118 @@ std::ostream& tez::operator<<(std::ostream& out, tez::map const& m) {
                 out_char = tile.get_data<door_data>().state == door_data::door_state::open ? 'O' : 'C';
             }
 
-            std::cout << out_char;
+            out << out_char;
         }
     }
     
-    std::cout << std::endl;
+    out << std::endl;
 
     return out;
 }
 
 namespace {
 
-using tez::NUM_CARDINAL_DIR;
+//==============================================================================
+//! Whether a path may pass through a tile of type @p type.
+//==============================================================================
+bool is_pathable(tez::tile_category const type) {
+    return tez::has_tile_flag(type, tez::tile_flag::pathable);
+}
 
-unsigned get_probabilities(unsigned dir, unsigned index) {
-    struct probability_list {
-        unsigned values[NUM_CARDINAL_DIR];
+//==============================================================================
+//! Whether a path may end (with a door) at the centre of @p block.
+//!
+//! @tparam Block map::const_block or world_block.
+//==============================================================================
+template <typename Block>
+bool is_connectable(Block const& block) {
+    using tez::tile_category;
+
+    auto const get = [](tez::tile_data const* tile) {
+        return tile ? tile->type : tile_category::empty;
     };
 
-    static probability_list const path_probabilities[] = {
-        {800, 10, 20, 20}, //north
-        {10, 800, 20, 20}, //south
-        {20, 20, 800, 10}, //east
-        {20, 20, 10, 800}, //west
+    //the edge of a room; ceiling unless tile_types.def says otherwise.
+    auto const is_edge = [](tile_category const type) {
+        return tez::has_tile_flag(type, tez::tile_flag::connectable);
     };
 
-    BK_ASSERT(dir   < NUM_CARDINAL_DIR);
-    BK_ASSERT(index < NUM_CARDINAL_DIR);
+    static auto const FLOOR = tile_category::floor;
+    static auto const WALL  = tile_category::wall;
 
-    return path_probabilities[dir].values[index];
-};
+    if (!is_edge(get(block.here()))) {
+        return false;
+    }
 
-static auto get_prob_n = std::bind(get_probabilities, 0, std::placeholders::_1);
-static auto get_prob_s = std::bind(get_probabilities, 1, std::placeholders::_1);
-static auto get_prob_e = std::bind(get_probabilities, 2, std::placeholders::_1);
-static auto get_prob_w = std::bind(get_probabilities, 3, std::placeholders::_1);
+    auto const n = get(block.north());
+    auto const s = get(block.south());
+    auto const e = get(block.east());
+    auto const w = get(block.west());
 
-typedef std::discrete_distribution<unsigned> prob_dist_t;
+    return (is_edge(n) && is_edge(s) && (e == FLOOR || w == FLOOR)) ||
+           (is_edge(e) && is_edge(w) && (n == FLOOR || s == WALL));
+}
 
-static auto const path_prob_n = prob_dist_t(NUM_CARDINAL_DIR, 0, NUM_CARDINAL_DIR, get_prob_n);
-static auto const path_prob_s = prob_dist_t(NUM_CARDINAL_DIR, 0, NUM_CARDINAL_DIR, get_prob_s);
-static auto const path_prob_e = prob_dist_t(NUM_CARDINAL_DIR, 0, NUM_CARDINAL_DIR, get_prob_e);
-static auto const path_prob_w = prob_dist_t(NUM_CARDINAL_DIR, 0, NUM_CARDINAL_DIR, get_prob_w);
+//==============================================================================
+//! Whether a path may start at the centre of @p block; it must be a ceiling
+//! tile with no door adjacent to it.
+//==============================================================================
+template <typename Block>
+bool is_startable(Block const& block) {
+    using namespace tez::tile_flag;
+
+    auto const check = [](tez::tile_data const* tile) {
+        return !tile || !tez::has_tile_flag(tile->type, opening);
+    };
+
+    return tez::has_tile_flag(block.here()->type, connectable) &&
+           check(block.north()) && check(block.south()) &&
+           check(block.east())  && check(block.west());
+}
 
 } //namespace
 
-tez::path_generator::path_generator(bklib::random_wrapper<> random)
-    : path_dist_n_(4, 0, 4, get_prob_n)
-    , path_dist_s_(4, 0, 4, get_prob_s)
-    , path_dist_e_(4, 0, 4, get_prob_e)
-    , path_dist_w_(4, 0, 4, get_prob_w)
-    , random_(random)
+tez::path_generator::path_generator(
+    random_t                 random,
+    unsigned const           max_length,
+    shared_generation_params tables
+)
+    : random_(random)
+    , max_length_(max_length)
+    , tables_(std::move(tables))
 {
+    BK_ASSERT(tables_);
+    BK_ASSERT(max_length_ >= 2);
+}
+
+bklib::rect<unsigned> tez::path_generator::footprint() const {
+    if (footprint_x_.min > footprint_x_.max) {
+        return bklib::rect<unsigned>(0, 0, 0, 0);
+    }
+
+    //tiles are read along with their neighbours.
+    return bklib::rect<unsigned>(
+        static_cast<unsigned>(bklib::max(footprint_x_.min - 1, 0)),
+        static_cast<unsigned>(bklib::max(footprint_y_.min - 1, 0)),
+        static_cast<unsigned>(footprint_x_.max + 2),
+        static_cast<unsigned>(footprint_y_.max + 2)
+    );
 }
 
+template <typename Map>
 bool tez::path_generator::generate(
     tez::room const& origin,
-    tez::map  const& map,
+    Map       const& map,
     direction const  dir
 ) {
     typedef room::connection_point point_t;
 
     static unsigned const MAX_PATH_FAILURES       = 5;
     static unsigned const MAX_FIND_START_FAILURES = 5;
+
+    if (!origin.has_connection_point(dir)) {
+        return false;
+    }
     
     auto const temp = origin.bounds();
     BK_ASSERT(temp.left >= 0);
@@ -118,39 +201,30 @@ bool tez::path_generator::generate(
     auto const bounds = static_cast<bklib::rect<unsigned>>(temp);
 
     BK_DECLARE_DIRECTION_ARRAYS(dir_x, dir_y);
+
+    typedef generation_params::path_table_t path_table_t;
+    auto const& table = tables_->path_table(dir);
+
+    //each draw gives four samples.
+    static unsigned const SAMPLES_PER_DRAW = 4;
+
+    random_t::result_type step_bits      = 0;
+    unsigned              step_bits_left = 0;
     //--------------------------------------------------------------------------
     // Get a random unit vector
     //--------------------------------------------------------------------------    
-    auto const get_random_vector = [&](distribution_t const& dist) {
-        auto const i = dist(random_);
-        return bklib::make_point(dir_x[i], dir_y[i]);
-    };
-    //--------------------------------------------------------------------------
-    auto const is_pathable = [](tile_category const type) {
-        return (type == tile_category::corridor) ||
-               (type == tile_category::empty);
-    };
-    //--------------------------------------------------------------------------
-    auto const is_connectable = [&](map::const_block const block) -> bool {
-        auto const get = [](tile_data const* tile) {
-            return tile ? tile->type : tile_category::empty;
-        };
-
-        static auto const CEIL  = tile_category::ceiling;
-        static auto const FLOOR = tile_category::floor;
-        static auto const WALL  = tile_category::wall;
-
-        if (get(block.here()) != CEIL) {
-            return false;
+    auto const get_random_vector = [&] {
+        if (step_bits_left == 0) {
+            step_bits      = random_();
+            step_bits_left = SAMPLES_PER_DRAW;
         }
 
-        auto const n = get(block.north());
-        auto const s = get(block.south());
-        auto const e = get(block.east());
-        auto const w = get(block.west());
+        auto const i = table(static_cast<unsigned>(step_bits));
+
+        step_bits >>= path_table_t::SAMPLE_BITS;
+        step_bits_left--;
 
-        return (n == CEIL && s == CEIL && (e == FLOOR || w == FLOOR)) ||
-               (e == CEIL && w == CEIL && (n == FLOOR || s == WALL));
+        return bklib::make_point(dir_x[i], dir_y[i]);
     };
     //--------------------------------------------------------------------------
     auto const is_on_path = [&](point_t const p) {
@@ -164,20 +238,19 @@ bool tez::path_generator::generate(
         return bklib::intersects(bounds, p);
     };
     //--------------------------------------------------------------------------
+    // Record a read of p and its neighbours.
+    //--------------------------------------------------------------------------
+    auto const touch = [&](point_t const p) {
+        footprint_x_(static_cast<signed>(p.x));
+        footprint_y_(static_cast<signed>(p.y));
+    };
+    //--------------------------------------------------------------------------
     auto const find_path_start = [&]() -> std::pair<bool, point_t> {
-        auto const check = [](tile_data const* tile) {
-            return tile ? tile->type != tile_category::door : true;
-        };
-
         for (unsigned i = 0; i < MAX_FIND_START_FAILURES; ++i) {
-            auto const  p     = origin.find_connection_point(dir, random_);           
-            auto const  type  = map.at(p).type;
-            auto const& block = map.block_at(p);
+            auto const p = origin.find_connection_point(dir, random_);           
+            touch(p);
                  
-            if ((type == tile_category::ceiling) &&
-                check(block.north()) && check(block.south()) &&
-                check(block.east())  && check(block.west())
-            ) {
+            if (is_startable(map.block_at(p))) {
                 return std::make_pair(true, p);
             }
         }
@@ -192,23 +265,24 @@ bool tez::path_generator::generate(
     
     auto pos = path_start.second;
 
-    distribution_t const& dist =
-        (dir == direction::north ) ? path_prob_n :
-        (dir == direction::south ) ? path_prob_s :
-        (dir == direction::east )  ? path_prob_e :
-        (dir == direction::west )  ? path_prob_w : path_prob_w;
-
     path_.clear();
     path_.push_back(pos);
 
     bool found_path = false;
 
-    for (unsigned i = 1; !found_path && i < MAX_FIND_START_FAILURES; ++i) {
-        auto const p = bklib::translate_by(pos, get_random_vector(dist));
+    for (unsigned i = 1;
+        !found_path && i < MAX_FIND_START_FAILURES && path_.size() < max_length_;
+        ++i
+    ) {
+        auto const p = bklib::translate_by(pos, get_random_vector());
 
         if (!map.is_valid_position(p)) {
             continue;
-        } else if (!is_pathable(map.at(p).type)) {
+        }
+
+        touch(p);
+
+        if (!is_pathable(map.at(p).type)) {
             if (is_in_origin(p)) {
                 continue;
             } else if (!is_connectable(map.block_at(p))) {
@@ -227,7 +301,92 @@ bool tez::path_generator::generate(
     return found_path && path_.size() >= 2;
 }
 
-void tez::path_generator::write_path(map& out) {
+template <typename Map>
+bool tez::path_generator::route(
+    tez::room const& origin,
+    Map       const& map,
+    target_f  const& is_target
+) {
+    static size_t const NONE = static_cast<size_t>(-1);
+
+    auto const temp = origin.bounds();
+    BK_ASSERT(temp.left >= 0);
+    BK_ASSERT(temp.top >= 0);
+    auto const bounds = static_cast<bklib::rect<unsigned>>(temp);
+
+    BK_DECLARE_DIRECTION_ARRAYS(dir_x, dir_y);
+
+    auto const w = map.width();
+
+    //parent[i] == i for the start tiles; NONE for unvisited tiles.
+    std::vector<size_t> parent(map.width() * map.height(), NONE);
+    std::queue<size_t>  open;
+
+    path_.clear();
+
+    //--------------------------------------------------------------------------
+    // Every usable connection point of the origin is a start tile.
+    //--------------------------------------------------------------------------
+    for (unsigned y = bounds.top; y < bounds.bottom; ++y) {
+        for (unsigned x = bounds.left; x < bounds.right; ++x) {
+            auto const block = map.block_at(x, y);
+            if (!is_startable(block) || !is_connectable(block)) continue;
+
+            auto const i = x + y*w;
+            parent[i] = i;
+            open.push(i);
+        }
+    }
+    //--------------------------------------------------------------------------
+    while (!open.empty()) {
+        auto const i = open.front();
+        open.pop();
+
+        for (unsigned d = 0; d < NUM_CARDINAL_DIR; ++d) {
+            auto const p = point_t(
+                static_cast<unsigned>(i % w) + dir_x[d], // allow overflow
+                static_cast<unsigned>(i / w) + dir_y[d]  // allow overflow
+            );
+
+            if (!map.is_valid_position(p)) continue;
+
+            size_t j = p.x + p.y*w;
+            if (parent[j] != NONE) continue;
+
+            if (is_pathable(map.at(p).type)) {
+                parent[j] = i;
+                open.push(j);
+                continue;
+            }
+
+            if (bklib::intersects(bounds, p))       continue;
+            if (!is_connectable(map.block_at(p)))   continue;
+            if (!is_target(p))                      continue;
+
+            //found; walk back to the start tile
+            auto const to_point = [w](size_t const k) {
+                return point_t(
+                    static_cast<unsigned>(k % w),
+                    static_cast<unsigned>(k / w)
+                );
+            };
+
+            for (parent[j] = i; parent[j] != j; j = parent[j]) {
+                path_.push_back(to_point(j));
+            }
+            path_.push_back(to_point(j));
+
+            std::reverse(path_.begin(), path_.end());
+
+            return true;
+        }
+    }
+
+    return false;
+}
+
+template <typename Map>
+void tez::path_generator::write_path(Map& out) {
     BK_ASSERT(path_.size() >= 2);
  
     for (size_t i = 1; i < path_.size() - 1; ++i) {
@@ -235,12 +394,30 @@ void tez::path_generator::write_path(map& out) {
         tile.type = tile_category::corridor;
     }
 
-    auto& first = out.at(path_.front().x, path_.front().y);
-    auto& last  = out.at(path_.back().x, path_.back().y);
+    //one tile at a time; a world_map tile is only good until the next one.
+    auto const write_door = [&](point_t const p, door_data::door_state state) {
+        tile_data& tile = out.at(p.x, p.y);
+        tile.type = tile_category::door;
+        tile.get_data<door_data>().state = state;
+    };
 
-    first.type = last.type = tile_category::door;
-    first.get_data<door_data>().state = door_data::door_state::open;
-    last.get_data<door_data>().state  = door_data::door_state::closed;
+    write_door(path_.front(), door_data::door_state::open);
+    write_door(path_.back(),  door_data::door_state::closed);
 
     path_.clear();
 }
+
+//------------------------------------------------------------------------------
+// The maps a path_generator works on.
+//------------------------------------------------------------------------------
+template bool tez::path_generator::generate(
+    tez::room const&, tez::map const&, direction);
+template bool tez::path_generator::route(
+    tez::room const&, tez::map const&, target_f const&);
+template void tez::path_generator::write_path(tez::map&);
+
+template bool tez::path_generator::generate(
+    tez::room const&, tez::world_map const&, direction);
+template bool tez::path_generator::route(
+    tez::room const&, tez::world_map const&, target_f const&);
+template void tez::path_generator::write_path(tez::world_map&);
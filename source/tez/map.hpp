@@ -3,9 +3,12 @@
 #include "grid2d.hpp"
 #include "tile.hpp"
 #include "room.hpp"
+#include "generation_params.hpp"
 
 namespace tez {
 
+class map_delta;
+
 //==============================================================================
 // A 2D grid of tiles.
 //==============================================================================
@@ -16,11 +19,25 @@ public:
     typedef grid_t::block       block;
     typedef grid_t::const_block const_block;
 
+    typedef uint16_t            room_id;
+    typedef grid2d<room_id>     room_id_grid_t;
+
+    static room_id const NO_ROOM = 0;
+
     map(unsigned width, unsigned height);
 
+    //--------------------------------------------------------------------------
+    //! A map of @p tiles, each owned by the room of the same position in
+    //! @p room_ids; the ids are at most @p room_count.
+    //--------------------------------------------------------------------------
+    map(grid_t tiles, room_id_grid_t room_ids, unsigned room_count);
+
     map(map&& other)
         : data_(std::move(other.data_))
+        , room_ids_(std::move(other.room_ids_))
+        , room_count_(other.room_count_)
     {
+        other.room_count_ = 0;
     }
 
     map& operator=(map&& rhs) {
@@ -30,7 +47,9 @@ public:
     //--------------------------------------------------------------------------
     void swap(map& other) {
         using std::swap;
-        swap(data_, other.data_);
+        swap(data_,       other.data_);
+        swap(room_ids_,   other.room_ids_);
+        swap(room_count_, other.room_count_);
     }
     //--------------------------------------------------------------------------
     unsigned width()  const { return data_.width();  }
@@ -60,7 +79,31 @@ public:
         return data_.block_at(p.x, p.y);
     }
     //--------------------------------------------------------------------------
-    void add_room(room const& r, signed dx = 0, signed dy = 0);
+    //! Copy the tiles of @p r into the map and mark the non-empty ones as
+    //! owned by it.
+    //!
+    //! @returns the id of the room; ids are assigned 1, 2, ... in the order
+    //! rooms are added.
+    //--------------------------------------------------------------------------
+    room_id add_room(room const& r, signed dx = 0, signed dy = 0);
+
+    //--------------------------------------------------------------------------
+    //! The id of the room owning the tile at (x, y), or NO_ROOM.
+    //--------------------------------------------------------------------------
+    room_id room_at(unsigned x, unsigned y) const {
+        return room_ids_.at(x, y);
+    }
+
+    room_id room_at(position p) const {
+        return room_ids_.at(p.x, p.y);
+    }
+
+    unsigned room_count() const {
+        return room_count_;
+    }
+    //--------------------------------------------------------------------------
+    grid_t const&         tiles()    const { return data_; }
+    room_id_grid_t const& room_ids() const { return room_ids_; }
     //--------------------------------------------------------------------------
     
     bool is_valid_position(unsigned x, unsigned y) const {
@@ -72,28 +115,59 @@ public:
     }
 
     friend std::ostream& operator<<(std::ostream& out, map const& m);
+    friend void patch(map& m, map_delta const& delta);
 private:
     map(map const&)           BK_DELETE;
     map operator=(map const&) BK_DELETE;
 
-    grid_t data_;
+    grid_t         data_;       //!< Tile data.
+    room_id_grid_t room_ids_;   //!< Owning room of each tile.
+    unsigned       room_count_; //!< Number of rooms added.
 };
 
 inline void swap(map& a, map& b) {
     a.swap(b);
 }
 
+//==============================================================================
+//! Corridors between rooms. The map may be a map or a world_map; both are
+//! read and written through the same at, block_at and is_valid_position.
+//==============================================================================
 class path_generator {
 public:
-    typedef bklib::random_wrapper<unsigned> random_t;
+    typedef bklib::random_engine     random_t;
     typedef bklib::point2d<unsigned> point_t;
-    typedef std::discrete_distribution<unsigned> distribution_t;
+    typedef std::function<bool (point_t p)> target_f;
 
-    explicit path_generator(random_t random);
+    //--------------------------------------------------------------------------
+    //! @param tables the step directions are drawn from.
+    //--------------------------------------------------------------------------
+    explicit path_generator(
+        random_t                 random,
+        unsigned                 max_length = 1024,
+        shared_generation_params tables     = current_generation_params()
+    );
 
-    bool generate(room const& origin, map const& m, direction dir);
+    //--------------------------------------------------------------------------
+    //! Random walk from a connection point on side @p dir of @p origin.
+    //!
+    //! @tparam Map map or world_map.
+    //--------------------------------------------------------------------------
+    template <typename Map>
+    bool generate(room const& origin, Map const& m, direction dir);
 
-    void write_path(map& out);
+    //--------------------------------------------------------------------------
+    //! Breadth first search from any connectable tile of @p origin to the
+    //! nearest connectable tile outside @p origin for which @p is_target holds.
+    //!
+    //! @returns @c false only if no such path exists.
+    //! @remark Keeps a word for every tile of @p m while searching.
+    //--------------------------------------------------------------------------
+    template <typename Map>
+    bool route(room const& origin, Map const& m, target_f const& is_target);
+
+    template <typename Map>
+    void write_path(Map& out);
 
     point_t start_point() const {
         BK_ASSERT(path_.size() >= 2);
@@ -104,14 +178,34 @@ public:
         BK_ASSERT(path_.size() >= 2);
         return path_.back();
     }
-private:   
-    distribution_t path_dist_n_;
-    distribution_t path_dist_s_;
-    distribution_t path_dist_e_;
-    distribution_t path_dist_w_;
 
+    std::vector<point_t> const& path() const {
+        return path_;
+    }
+
+    random_t& random() {
+        return random_;
+    }
+
+    //--------------------------------------------------------------------------
+    //! The half open bounds of every tile read by generate since the last call
+    //! to reset_footprint; empty if there were none.
+    //--------------------------------------------------------------------------
+    bklib::rect<unsigned> footprint() const;
+
+    void reset_footprint() {
+        footprint_x_ = bklib::min_max<>();
+        footprint_y_ = bklib::min_max<>();
+    }
+private:   
     std::vector<point_t> path_;
     random_t random_;
+    unsigned max_length_;
+
+    shared_generation_params tables_;
+
+    bklib::min_max<> footprint_x_; //!< x range of the tiles read.
+    bklib::min_max<> footprint_y_; //!< y range of the tiles read.
 };
 
 } //namespace tez
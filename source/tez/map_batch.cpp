@@ -0,0 +1,40 @@
+#include "pch.hpp"
+#include "map_batch.hpp"
+
+#include "map_pipeline.hpp"
+#include "bklib/thread_pool.hpp"
+
+uint64_t tez::map_seed(uint64_t const batch_seed, uint64_t const index) {
+    static uint64_t const GAMMA = 0x9E3779B97F4A7C15ull;
+    return bklib::mix64(bklib::mix64(batch_seed) + GAMMA * (index + 1));
+}
+
+tez::generated_map
+tez::generate_map(uint64_t const seed, map_params const& params) {
+    return map_pipeline(params).run(seed);
+}
+
+std::vector<tez::generated_map> tez::generate_maps(
+    uint64_t   const  seed,
+    unsigned   const  count,
+    map_params const& params,
+    unsigned   const  threads
+) {
+    std::vector<std::unique_ptr<generated_map>> slots(count);
+
+    bklib::thread_pool pool(threads);
+    pool.parallel_for(count, [&](size_t const i) {
+        slots[i].reset(new generated_map(
+            generate_map(map_seed(seed, i), params)
+        ));
+    });
+
+    std::vector<generated_map> result;
+    result.reserve(count);
+
+    for (auto& slot : slots) {
+        result.emplace_back(std::move(*slot));
+    }
+
+    return result;
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include "map.hpp"
+#include "map_layout.hpp"
+
+#include <vector>
+#include <cstdint>
+
+namespace tez {
+
+//==============================================================================
+//! Parameters for generating a single map.
+//==============================================================================
+struct map_params {
+    map_params()
+        : room_count(20)
+        , compound_interval(4)
+        , cave_interval(0)
+        , budget()
+    {
+    }
+
+    unsigned          room_count;        //!< Rooms to generate; at least 1.
+    unsigned          compound_interval; //!< Every nth room is compound; 0 for none.
+    unsigned          cave_interval;     //!< Every nth other room is a cave; 0 for none.
+    generation_budget budget;
+};
+
+//==============================================================================
+//! A generated map along with the seed that reproduces it.
+//==============================================================================
+struct generated_map {
+    generated_map(uint64_t seed, map m, generation_status status)
+        : seed(seed)
+        , result(std::move(m))
+        , status(status)
+    {
+    }
+
+    generated_map(generated_map&& other)
+        : seed(other.seed)
+        , result(std::move(other.result))
+        , status(other.status)
+    {
+    }
+
+    generated_map& operator=(generated_map&& rhs) {
+        seed = rhs.seed;
+        result.swap(rhs.result);
+        status = rhs.status;
+        return *this;
+    }
+
+    uint64_t          seed;
+    map               result;
+    generation_status status;
+};
+
+//==============================================================================
+//! The seed of the map at @p index in the batch seeded with @p batch_seed.
+//!
+//! Seeds are well mixed, so neighbouring indices give unrelated maps.
+//==============================================================================
+uint64_t map_seed(uint64_t batch_seed, uint64_t index);
+
+//==============================================================================
+//! Generate a single map; the result depends only on @p seed and @p params.
+//==============================================================================
+generated_map generate_map(uint64_t seed, map_params const& params);
+
+//==============================================================================
+//! Generate @p count maps, the ith with seed <tt>map_seed(seed, i)</tt>,
+//! spread over @p threads threads (0 for one per hardware thread).
+//!
+//! The result is identical for any number of threads.
+//==============================================================================
+std::vector<generated_map> generate_maps(
+    uint64_t          seed,
+    unsigned          count,
+    map_params const& params,
+    unsigned          threads = 0
+);
+
+} //namespace tez
@@ -0,0 +1,208 @@
+#include "pch.hpp"
+#include "map_delta.hpp"
+#include "map_file.hpp"
+
+#include <istream>
+#include <ostream>
+#include <cstring>
+
+using tez::map_span;
+using tez::map_delta;
+
+namespace {
+
+char const MAGIC[8] = {'T', 'E', 'Z', 'D', 'E', 'L', 'T', 'A'};
+
+uint32_t const VERSION = 1;
+
+struct delta_header {
+    char     magic[8];   //!< "TEZDELTA"
+    uint32_t version;
+    uint32_t byte_order; //!< MAP_FILE_BYTE_ORDER as written.
+    uint32_t tile_size;  //!< sizeof(tile_data)
+    uint32_t width;
+    uint32_t height;
+    uint32_t room_count;
+    uint32_t span_count;
+    uint32_t tile_count; //!< The sum of the span lengths.
+};
+
+static_assert(sizeof(delta_header) == 40, "header layout changed");
+static_assert(sizeof(map_span) == 12, "span layout changed");
+
+//tiles are compared and written as bytes, so there must be no padding.
+static_assert(sizeof(tez::tile_data) == 16, "tile_data has padding");
+
+void fail(char const* const field) {
+    BOOST_THROW_EXCEPTION(
+        tez::bad_map_delta() << tez::map_delta_field_info(field)
+    );
+}
+
+void check(bool const ok, char const* const field) {
+    if (!ok) fail(field);
+}
+
+template <typename T>
+void write_all(std::ostream& out, std::vector<T> const& values) {
+    out.write(
+        reinterpret_cast<char const*>(values.data()),
+        static_cast<std::streamsize>(values.size() * sizeof(T))
+    );
+}
+
+template <typename T>
+void read_all(std::istream& in, std::vector<T>& values, size_t const n) {
+    values.resize(n);
+    in.read(
+        reinterpret_cast<char*>(values.data()),
+        static_cast<std::streamsize>(n * sizeof(T))
+    );
+    check(!!in, "size");
+}
+
+} //namespace
+
+map_delta tez::diff(map const& from, map const& to) {
+    BK_ASSERT(from.width()  == to.width());
+    BK_ASSERT(from.height() == to.height());
+
+    map_delta result;
+    result.width_      = to.width();
+    result.height_     = to.height();
+    result.room_count_ = to.room_count();
+
+    auto const w = to.width();
+
+    for (unsigned y = 0; y < to.height(); ++y) {
+        auto const offset = static_cast<size_t>(y) * w;
+
+        auto const a     = from.tiles().data()    + offset;
+        auto const b     = to.tiles().data()      + offset;
+        auto const a_ids = from.room_ids().data() + offset;
+        auto const b_ids = to.room_ids().data()   + offset;
+
+        //most rows of an edited map are untouched.
+        if (std::memcmp(a, b, w * sizeof(tile_data)) == 0 &&
+            std::memcmp(a_ids, b_ids, w * sizeof(map::room_id)) == 0
+        ) {
+            continue;
+        }
+
+        auto const same = [&](unsigned const x) {
+            return a_ids[x] == b_ids[x]
+                && std::memcmp(a + x, b + x, sizeof(tile_data)) == 0;
+        };
+
+        for (unsigned x = 0; x < w; ++x) {
+            if (same(x)) continue;
+
+            auto const first = x;
+            while (x < w && !same(x)) ++x;
+
+            map_span const span = {first, y, x - first};
+            result.spans_.push_back(span);
+
+            result.tiles_.insert(result.tiles_.end(), b + first, b + x);
+            result.room_ids_.insert(
+                result.room_ids_.end(), b_ids + first, b_ids + x
+            );
+        }
+    }
+
+    return result;
+}
+
+void tez::patch(map& m, map_delta const& delta) {
+    check(m.width()  == delta.width(),  "width");
+    check(m.height() == delta.height(), "height");
+
+    auto tile = delta.tiles().data();
+    auto id   = delta.room_ids().data();
+
+    for (auto const& s : delta.spans()) {
+        BK_ASSERT(m.is_valid_position(s.x + s.length - 1, s.y));
+
+        std::copy(tile, tile + s.length, &m.data_.at(s.x, s.y));
+        std::copy(id,   id   + s.length, &m.room_ids_.at(s.x, s.y));
+
+        tile += s.length;
+        id   += s.length;
+    }
+
+    m.room_count_ = delta.room_count();
+}
+
+void tez::write_map_delta(std::ostream& out, map_delta const& delta) {
+    delta_header header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+
+    header.version    = VERSION;
+    header.byte_order = MAP_FILE_BYTE_ORDER;
+    header.tile_size  = sizeof(tile_data);
+    header.width      = delta.width();
+    header.height     = delta.height();
+    header.room_count = delta.room_count();
+    header.span_count = static_cast<uint32_t>(delta.spans().size());
+    header.tile_count = static_cast<uint32_t>(delta.tiles().size());
+
+    out.write(reinterpret_cast<char const*>(&header), sizeof(header));
+    write_all(out, delta.spans());
+    write_all(out, delta.tiles());
+    write_all(out, delta.room_ids());
+
+    if (!out) fail("write");
+}
+
+map_delta tez::read_map_delta(std::istream& in) {
+    delta_header header;
+    in.read(reinterpret_cast<char*>(&header), sizeof(header));
+    check(!!in, "size");
+
+    check(std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) == 0, "magic");
+    check(header.version    == VERSION,             "version");
+    check(header.byte_order == MAP_FILE_BYTE_ORDER, "byte_order");
+    check(header.tile_size  == sizeof(tile_data),   "tile_size");
+
+    check(header.room_count <= std::numeric_limits<map::room_id>::max(),
+        "room_count");
+
+    //bound the counts before trusting them with an allocation.
+    auto const n = static_cast<uint64_t>(header.width) * header.height;
+    check(header.span_count <= n, "span_count");
+    check(header.tile_count <= n, "tile_count");
+
+    map_delta result;
+    result.width_      = header.width;
+    result.height_     = header.height;
+    result.room_count_ = header.room_count;
+
+    read_all(in, result.spans_, header.span_count);
+
+    //in order, within the map, and not overlapping.
+    uint64_t end   = 0; //!< One past the last tile of the previous span.
+    uint64_t total = 0;
+
+    for (auto const& s : result.spans_) {
+        check(s.y < header.height && s.x < header.width, "span");
+        check(s.length > 0 && s.length <= header.width - s.x, "span");
+
+        auto const begin = static_cast<uint64_t>(s.y) * header.width + s.x;
+        check(begin >= end, "span");
+
+        end    = begin + s.length;
+        total += s.length;
+    }
+
+    check(total == header.tile_count, "tile_count");
+
+    read_all(in, result.tiles_,    header.tile_count);
+    read_all(in, result.room_ids_, header.tile_count);
+
+    for (auto const id : result.room_ids_) {
+        check(id <= header.room_count, "room_ids");
+    }
+
+    return result;
+}
@@ -0,0 +1,129 @@
+#pragma once
+
+#include "map.hpp"
+
+#include <boost/exception/all.hpp>
+
+#include <string>
+#include <vector>
+#include <iosfwd>
+#include <cstdint>
+
+namespace tez {
+
+//==============================================================================
+//! A run of tiles changed in a row of a map.
+//==============================================================================
+struct map_span {
+    uint32_t x;
+    uint32_t y;
+    uint32_t length;
+};
+
+//==============================================================================
+//! The changes taking one map to another of the same size: for each run of
+//! changed tiles in a row, the new tiles and the new owning rooms.
+//!
+//! A tile counts as changed if any of its bytes did, its data included, so
+//! a door opened through door_data::state is a change like any other.
+//==============================================================================
+class map_delta {
+public:
+    typedef map::room_id room_id;
+
+    map_delta()
+        : width_(0)
+        , height_(0)
+        , room_count_(0)
+    {
+    }
+
+    map_delta(map_delta&& other)
+        : width_(other.width_)
+        , height_(other.height_)
+        , room_count_(other.room_count_)
+        , spans_(std::move(other.spans_))
+        , tiles_(std::move(other.tiles_))
+        , room_ids_(std::move(other.room_ids_))
+    {
+    }
+
+    map_delta& operator=(map_delta&& rhs) {
+        width_      = rhs.width_;
+        height_     = rhs.height_;
+        room_count_ = rhs.room_count_;
+        spans_      = std::move(rhs.spans_);
+        tiles_      = std::move(rhs.tiles_);
+        room_ids_   = std::move(rhs.room_ids_);
+        return *this;
+    }
+
+    //! The size of the maps it applies to.
+    unsigned width()  const { return width_;  }
+    unsigned height() const { return height_; }
+
+    //! The room count of the map after the change.
+    unsigned room_count() const { return room_count_; }
+
+    bool empty() const { return spans_.empty(); }
+
+    //! In row order, then left to right; never adjacent or overlapping.
+    std::vector<map_span>  const& spans()    const { return spans_; }
+
+    //! The new values of the changed tiles, span after span.
+    std::vector<tile_data> const& tiles()    const { return tiles_; }
+    std::vector<room_id>   const& room_ids() const { return room_ids_; }
+
+    friend map_delta diff(map const& from, map const& to);
+    friend map_delta read_map_delta(std::istream& in);
+private:
+    map_delta(map_delta const&)            BK_DELETE;
+    map_delta& operator=(map_delta const&) BK_DELETE;
+
+    unsigned               width_;
+    unsigned               height_;
+    unsigned               room_count_;
+    std::vector<map_span>  spans_;
+    std::vector<tile_data> tiles_;
+    std::vector<room_id>   room_ids_;
+};
+
+//==============================================================================
+//! Thrown for a delta that does not apply to a map, or cannot be read.
+//==============================================================================
+struct bad_map_delta : virtual boost::exception, virtual std::exception {};
+
+//! What is wrong, e.g. "size".
+typedef boost::error_info<struct tag_map_delta_field, std::string>
+    map_delta_field_info;
+
+//==============================================================================
+//! The changes taking @p from to @p to.
+//!
+//! @pre @p from and @p to are the same size.
+//==============================================================================
+map_delta diff(map const& from, map const& to);
+
+//==============================================================================
+//! Apply @p delta to @p m in place; only the changed tiles are touched.
+//!
+//! Applied to the map it was taken from, the result equals the map it was
+//! taken to; applied to any other map of the same size, the spans still
+//! overwrite, and nothing else changes.
+//!
+//! @throws bad_map_delta if @p m is not the size of the delta; @p m is left
+//! unchanged.
+//==============================================================================
+void patch(map& m, map_delta const& delta);
+
+//==============================================================================
+//! The delta as bytes: a header, the spans, the tiles, then the room ids;
+//! like the map file, in the byte order of the writer.
+//!
+//! @throws bad_map_delta if the delta cannot be written or read back, or is
+//! not a well formed delta.
+//==============================================================================
+void      write_map_delta(std::ostream& out, map_delta const& delta);
+map_delta read_map_delta(std::istream& in);
+
+} //namespace tez
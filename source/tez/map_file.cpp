@@ -0,0 +1,244 @@
+#include "pch.hpp"
+#include "map_file.hpp"
+
+#include <fstream>
+#include <cstring>
+
+using tez::map_file_header;
+using tez::map_file_room;
+using tez::MAP_FILE_ALIGN;
+
+namespace {
+
+char const MAGIC[8] = {'T', 'E', 'Z', 'M', 'A', 'P', '\0', '\0'};
+
+static_assert(sizeof(map_file_header) == 64, "header layout changed");
+static_assert(sizeof(map_file_room) == 20, "room layout changed");
+
+//the tiles are written straight from memory, so there must be no padding.
+static_assert(sizeof(tez::tile_data) == 16, "tile_data has padding");
+
+void fail(char const* const field) {
+    BOOST_THROW_EXCEPTION(
+        tez::bad_map_file() << tez::map_file_field_info(field)
+    );
+}
+
+void check(bool const ok, char const* const field) {
+    if (!ok) fail(field);
+}
+
+uint64_t align(uint64_t const offset) {
+    return (offset + MAP_FILE_ALIGN - 1) / MAP_FILE_ALIGN * MAP_FILE_ALIGN;
+}
+
+//==============================================================================
+//! The bounds of each room in @p m, by id.
+//==============================================================================
+std::vector<map_file_room> find_rooms(tez::map const& m) {
+    map_file_room const none = {0xFFFFFFFF, 0xFFFFFFFF, 0, 0, 0};
+    std::vector<map_file_room> result(m.room_count(), none);
+
+    auto const& ids = m.room_ids();
+
+    for (unsigned y = 0; y < ids.height(); ++y) {
+        for (unsigned x = 0; x < ids.width(); ++x) {
+            auto const id = ids.at(x, y);
+            if (id == tez::map::NO_ROOM) continue;
+
+            BK_ASSERT(id <= result.size());
+            auto& r = result[id - 1];
+
+            r.left   = std::min(r.left,   x);
+            r.top    = std::min(r.top,    y);
+            r.right  = std::max(r.right,  x + 1);
+            r.bottom = std::max(r.bottom, y + 1);
+            r.tiles++;
+        }
+    }
+
+    map_file_room const empty = {0, 0, 0, 0, 0};
+    for (auto& r : result) {
+        if (r.tiles == 0) r = empty;
+    }
+
+    return result;
+}
+
+//==============================================================================
+//! Writes sections at their offsets, padding with zeros up to each.
+//==============================================================================
+class section_writer {
+public:
+    explicit section_writer(std::ostream& out)
+        : out_(out)
+        , pos_(0)
+    {
+    }
+
+    void write(uint64_t const offset, void const* data, size_t const size) {
+        static char const zeros[MAP_FILE_ALIGN] = {0};
+
+        BK_ASSERT(offset >= pos_ && offset - pos_ <= MAP_FILE_ALIGN);
+        out_.write(zeros, static_cast<std::streamsize>(offset - pos_));
+        out_.write(
+            static_cast<char const*>(data),
+            static_cast<std::streamsize>(size)
+        );
+
+        pos_ = offset + size;
+    }
+private:
+    section_writer(section_writer const&)            BK_DELETE;
+    section_writer& operator=(section_writer const&) BK_DELETE;
+
+    std::ostream& out_;
+    uint64_t      pos_;
+};
+
+//! Whether [offset, offset + size) lies within [begin, end).
+bool in_range(
+    uint64_t const offset,
+    uint64_t const size,
+    uint64_t const begin,
+    uint64_t const end
+) {
+    return offset >= begin && offset <= end && size <= end - offset;
+}
+
+} //namespace
+
+void tez::write_map_file(std::ostream& out, map const& m) {
+    auto const rooms = find_rooms(m);
+
+    auto const tiles      = m.tiles().size();
+    auto const tiles_size = tiles * sizeof(tile_data);
+    auto const ids_size   = tiles * sizeof(map::room_id);
+    auto const rooms_size = rooms.size() * sizeof(map_file_room);
+
+    map_file_header header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+
+    header.version     = MAP_FILE_VERSION;
+    header.byte_order  = MAP_FILE_BYTE_ORDER;
+    header.header_size = sizeof(map_file_header);
+    header.tile_size   = sizeof(tile_data);
+    header.width       = m.width();
+    header.height      = m.height();
+    header.room_count  = m.room_count();
+
+    header.tiles_offset    = align(sizeof(header));
+    header.room_ids_offset = align(header.tiles_offset + tiles_size);
+    header.rooms_offset    = align(header.room_ids_offset + ids_size);
+
+    section_writer writer(out);
+    writer.write(0, &header, sizeof(header));
+    writer.write(header.tiles_offset, m.tiles().data(), tiles_size);
+    writer.write(header.room_ids_offset, m.room_ids().data(), ids_size);
+    writer.write(header.rooms_offset, rooms.data(), rooms_size);
+
+    if (!out) fail("write");
+}
+
+void tez::write_map_file(std::string const& filename, map const& m) {
+    try {
+        std::ofstream out(filename, std::ios::binary | std::ios::trunc);
+        if (!out) fail("open");
+
+        write_map_file(out, m);
+    } catch (bad_map_file& e) {
+        e << boost::errinfo_file_name(filename);
+        throw;
+    }
+}
+
+tez::map_view::map_view()
+    : rooms_(nullptr)
+    , room_count_(0)
+{
+}
+
+tez::map_view::map_view(void const* const data, size_t const size)
+    : rooms_(nullptr)
+    , room_count_(0)
+{
+    check(data && size >= sizeof(map_file_header), "size");
+    check(reinterpret_cast<uintptr_t>(data) % 8 == 0, "alignment");
+
+    auto const  bytes  = static_cast<char const*>(data);
+    auto const& header = *reinterpret_cast<map_file_header const*>(bytes);
+
+    check(std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) == 0, "magic");
+    check(header.version     == MAP_FILE_VERSION,        "version");
+    check(header.byte_order  == MAP_FILE_BYTE_ORDER,     "byte_order");
+    check(header.header_size == sizeof(map_file_header), "header_size");
+    check(header.tile_size   == sizeof(tile_data),       "tile_size");
+    check(header.width > 0 && header.height > 0,         "size");
+
+    check(header.room_count <= std::numeric_limits<room_id>::max(), "rooms");
+
+    auto const n = static_cast<uint64_t>(header.width) * header.height;
+    check(n <= size / sizeof(tile_data), "size");
+
+    auto const tiles_size = n * sizeof(tile_data);
+    auto const ids_size   = n * sizeof(room_id);
+    auto const rooms_size = header.room_count * sizeof(map_file_room);
+
+    check(header.tiles_offset    % MAP_FILE_ALIGN == 0, "tiles_offset");
+    check(header.room_ids_offset % MAP_FILE_ALIGN == 0, "room_ids_offset");
+    check(header.rooms_offset    % MAP_FILE_ALIGN == 0, "rooms_offset");
+
+    //in order, without overlapping.
+    auto const tiles_begin = header.header_size;
+    auto const ids_begin   = header.tiles_offset + tiles_size;
+    auto const rooms_begin = header.room_ids_offset + ids_size;
+
+    check(in_range(header.tiles_offset, tiles_size, tiles_begin, size),
+        "tiles_offset");
+    check(in_range(header.room_ids_offset, ids_size, ids_begin, size),
+        "room_ids_offset");
+    check(in_range(header.rooms_offset, rooms_size, rooms_begin, size),
+        "rooms_offset");
+
+    tiles_ = grid_view<tile_data>(
+        reinterpret_cast<tile_data const*>(bytes + header.tiles_offset),
+        header.width, header.height
+    );
+
+    room_ids_ = grid_view<room_id>(
+        reinterpret_cast<room_id const*>(bytes + header.room_ids_offset),
+        header.width, header.height
+    );
+
+    rooms_ = reinterpret_cast<map_file_room const*>(
+        bytes + header.rooms_offset
+    );
+    room_count_ = header.room_count;
+}
+
+map_file_room const& tez::map_view::room(room_id const id) const {
+    BK_ASSERT(id > 0 && id <= room_count_);
+    return rooms_[id - 1];
+}
+
+tez::map tez::load_map(map_view const& view) {
+    map::grid_t         tiles(view.width(), view.height());
+    map::room_id_grid_t ids(view.width(), view.height());
+
+    std::copy(view.tiles().begin(), view.tiles().end(), tiles.data());
+    std::copy(view.room_ids().begin(), view.room_ids().end(), ids.data());
+
+    return map(std::move(tiles), std::move(ids), view.room_count());
+}
+
+tez::map_file::map_file(std::string const& filename)
+    : file_(filename)
+{
+    try {
+        view_ = map_view(file_.data(), file_.size());
+    } catch (bad_map_file& e) {
+        e << boost::errinfo_file_name(filename);
+        throw;
+    }
+}
@@ -0,0 +1,162 @@
+#pragma once
+
+#include "bklib/mapped_file.hpp"
+
+#include "map.hpp"
+#include "grid2d.hpp"
+
+#include <boost/exception/all.hpp>
+
+#include <string>
+#include <iosfwd>
+#include <cstdint>
+
+namespace tez {
+
+//==============================================================================
+//! The binary map format, laid out to be mapped and used in place.
+//!
+//! A map_file_header, then, each at a multiple of MAP_FILE_ALIGN:
+//! - the tiles: width * height tile_data, a row at a time;
+//! - the room ids: width * height map::room_id, a row at a time;
+//! - the rooms: room_count map_file_room, for ids 1, 2, ...
+//!
+//! Everything is in the byte order and layout of the writer; a reader with
+//! a different one rejects the file instead of converting it.
+//==============================================================================
+static uint32_t const MAP_FILE_VERSION    = 1;
+static uint32_t const MAP_FILE_BYTE_ORDER = 0x01020304;
+static uint32_t const MAP_FILE_ALIGN      = 64;
+
+struct map_file_header {
+    char     magic[8];        //!< "TEZMAP\0\0"
+    uint32_t version;         //!< MAP_FILE_VERSION
+    uint32_t byte_order;      //!< MAP_FILE_BYTE_ORDER as written.
+    uint32_t header_size;     //!< sizeof(map_file_header)
+    uint32_t tile_size;       //!< sizeof(tile_data)
+    uint32_t width;
+    uint32_t height;
+    uint32_t room_count;
+    uint32_t reserved;
+    uint64_t tiles_offset;    //!< From the start of the file.
+    uint64_t room_ids_offset;
+    uint64_t rooms_offset;
+};
+
+//==============================================================================
+//! The tiles a room owns in a map; right and bottom are exclusive.
+//==============================================================================
+struct map_file_room {
+    uint32_t left;
+    uint32_t top;
+    uint32_t right;
+    uint32_t bottom;
+    uint32_t tiles; //!< The number owned; 0 for none, with an empty rect.
+};
+
+//==============================================================================
+//! Thrown for a file that is not a map file this build can read.
+//==============================================================================
+struct bad_map_file : virtual boost::exception, virtual std::exception {};
+
+//! What is wrong, e.g. "version".
+typedef boost::error_info<struct tag_map_file_field, std::string>
+    map_file_field_info;
+
+//==============================================================================
+//! Write @p m in the binary map format.
+//!
+//! @throws bad_map_file if the file cannot be written.
+//==============================================================================
+void write_map_file(std::ostream& out, map const& m);
+void write_map_file(std::string const& filename, map const& m);
+
+//==============================================================================
+//! A read only map over the bytes of a map file; nothing is parsed or
+//! copied beyond the header.
+//!
+//! The bytes must outlive the view and be aligned to 8 bytes at least.
+//==============================================================================
+class map_view {
+public:
+    typedef map::room_id   room_id;
+    typedef map::position  position;
+
+    map_view();
+
+    //--------------------------------------------------------------------------
+    //! @throws bad_map_file if the header or the sizes do not check out.
+    //--------------------------------------------------------------------------
+    map_view(void const* data, size_t size);
+
+    unsigned width()  const { return tiles_.width();  }
+    unsigned height() const { return tiles_.height(); }
+
+    bool is_valid_position(unsigned const x, unsigned const y) const {
+        return tiles_.is_valid_position(x, y);
+    }
+
+    tile_data const& at(unsigned const x, unsigned const y) const {
+        return tiles_.at(x, y);
+    }
+
+    tile_data const& at(position const p) const {
+        return tiles_.at(p.x, p.y);
+    }
+
+    room_id room_at(unsigned const x, unsigned const y) const {
+        return room_ids_.at(x, y);
+    }
+
+    room_id room_at(position const p) const {
+        return room_ids_.at(p.x, p.y);
+    }
+
+    unsigned room_count() const { return room_count_; }
+
+    //! @pre 0 < id <= room_count()
+    map_file_room const& room(room_id id) const;
+
+    grid_view<tile_data> const& tiles()    const { return tiles_; }
+    grid_view<room_id>   const& room_ids() const { return room_ids_; }
+private:
+    grid_view<tile_data> tiles_;
+    grid_view<room_id>   room_ids_;
+    map_file_room const* rooms_;
+    unsigned             room_count_;
+};
+
+//==============================================================================
+//! A mutable copy of @p view.
+//==============================================================================
+map load_map(map_view const& view);
+
+//==============================================================================
+//! A map file mapped into memory, with a map_view over it.
+//!
+//! @remark Move-only type.
+//==============================================================================
+class map_file {
+public:
+    //--------------------------------------------------------------------------
+    //! @throws bklib::mapped_file_error, bad_map_file
+    //--------------------------------------------------------------------------
+    explicit map_file(std::string const& filename);
+
+    map_file(map_file&& other)
+        : file_(std::move(other.file_))
+        , view_(other.view_)
+    {
+        other.view_ = map_view();
+    }
+
+    map_view const& view() const { return view_; }
+private:
+    map_file(map_file const&)            BK_DELETE;
+    map_file& operator=(map_file const&) BK_DELETE;
+
+    bklib::mapped_file file_;
+    map_view           view_;
+};
+
+} //namespace tez
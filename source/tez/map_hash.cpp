@@ -0,0 +1,90 @@
+#include "pch.hpp"
+#include "map_hash.hpp"
+
+#include <cstring>
+
+using bklib::stream_hash;
+using bklib::mix64;
+
+//tiles are hashed and keyed as bytes, so there must be no padding.
+static_assert(sizeof(tez::tile_data) == 16, "tile_data has padding");
+
+void tez::hash_append(stream_hash& h, map const& m) {
+    hash_append(h, m.tiles());
+    hash_append(h, m.room_ids());
+    h.update_value(static_cast<uint32_t>(m.room_count()));
+}
+
+void tez::hash_append(stream_hash& h, room const& r) {
+    int32_t const bounds[4] = {r.left(), r.top(), r.right(), r.bottom()};
+    h.update(bounds, sizeof(bounds));
+    hash_append(h, *r.shape());
+}
+
+uint64_t tez::hash(map const& m) {
+    stream_hash h;
+    hash_append(h, m);
+    return h.digest64();
+}
+
+bklib::hash128 tez::hash128(map const& m) {
+    stream_hash h;
+    hash_append(h, m);
+    return h.digest128();
+}
+
+uint64_t tez::hash(room const& r) {
+    stream_hash h;
+    hash_append(h, r);
+    return h.digest64();
+}
+
+bklib::hash128 tez::hash128(room const& r) {
+    stream_hash h;
+    hash_append(h, r);
+    return h.digest128();
+}
+
+tez::zobrist_hash::zobrist_hash(map const& m) {
+    auto const w = m.width();
+    auto const h = m.height();
+
+    value_ = mix64((static_cast<uint64_t>(w) << 32) | h);
+
+    auto tile = m.tiles().data();
+    auto id   = m.room_ids().data();
+
+    for (unsigned y = 0; y < h; ++y) {
+        for (unsigned x = 0; x < w; ++x) {
+            value_ ^= key(x, y, *tile++, *id++);
+        }
+    }
+}
+
+void tez::zobrist_hash::set(
+    map&             m,
+    unsigned const   x,
+    unsigned const   y,
+    tile_data const& value
+) {
+    auto&      tile = m.at(x, y);
+    auto const id   = m.room_at(x, y);
+
+    update(x, y, tile, id, value, id);
+    tile = value;
+}
+
+uint64_t tez::zobrist_hash::key(
+    unsigned const   x,
+    unsigned const   y,
+    tile_data const& tile,
+    room_id const    id
+) {
+    uint64_t words[2];
+    std::memcpy(words, &tile, sizeof(words));
+
+    auto const xy = (static_cast<uint64_t>(y) << 32) | x;
+
+    auto const k = mix64(mix64(xy) ^ id);
+    return mix64(mix64(k ^ words[0]) ^ words[1]);
+}
@@ -0,0 +1,121 @@
+#pragma once
+
+#include "bklib/hash.hpp"
+
+#include "map.hpp"
+#include "grid2d.hpp"
+
+#include <type_traits>
+
+namespace tez {
+
+//==============================================================================
+//! Content hashes, for deduplicating maps and keying caches by them without
+//! serialising first; they read the grid storage in place.
+//!
+//! Equal content gives equal hashes, in any process on machines of the same
+//! byte order; the size of a grid is part of its content.
+//==============================================================================
+
+//! Feed the size and values of @p grid to @p h.
+template <typename T>
+void hash_append(bklib::stream_hash& h, grid_view<T> const& grid) {
+    static_assert(std::is_pod<T>::value, "values are hashed as bytes");
+
+    uint32_t const size[2] = {grid.width(), grid.height()};
+    h.update(size, sizeof(size));
+    h.update(grid.data(), grid.size() * sizeof(T));
+}
+
+template <typename T>
+void hash_append(bklib::stream_hash& h, grid2d<T> const& grid) {
+    hash_append(h, grid_view<T>(grid));
+}
+
+//! Feed the tiles, room ids and room count of @p m to @p h.
+void hash_append(bklib::stream_hash& h, map const& m);
+
+//! Feed the bounds and tiles of @p r to @p h; hash its shape() alone for
+//! the tiles wherever the room is.
+void hash_append(bklib::stream_hash& h, room const& r);
+
+template <typename T>
+uint64_t hash(grid_view<T> const& grid) {
+    bklib::stream_hash h;
+    hash_append(h, grid);
+    return h.digest64();
+}
+
+template <typename T>
+bklib::hash128 hash128(grid_view<T> const& grid) {
+    bklib::stream_hash h;
+    hash_append(h, grid);
+    return h.digest128();
+}
+
+template <typename T>
+uint64_t hash(grid2d<T> const& grid) {
+    return hash(grid_view<T>(grid));
+}
+
+template <typename T>
+bklib::hash128 hash128(grid2d<T> const& grid) {
+    return hash128(grid_view<T>(grid));
+}
+
+uint64_t       hash(map const& m);
+bklib::hash128 hash128(map const& m);
+
+uint64_t       hash(room const& r);
+bklib::hash128 hash128(room const& r);
+
+//==============================================================================
+//! A hash of a map kept up to date through its tile writes, at O(1) a write.
+//!
+//! Zobrist style: the xor of one key for the map size and one for each
+//! tile, a pure function of its position, tile_data and owning room; a
+//! write takes out the key of the old tile and puts in the key of the new
+//! one. The keys are mixed from the values rather than looked up in tables,
+//! as tile_data has far too many values for those.
+//!
+//! Maps with equal tiles and room ids have equal values, however they were
+//! reached; the room count is not part of it, and the value is not the same
+//! as hash(map).
+//==============================================================================
+class zobrist_hash {
+public:
+    typedef map::room_id room_id;
+
+    //! The value for @p m, from a full pass over it.
+    explicit zobrist_hash(map const& m);
+
+    uint64_t value() const { return value_; }
+
+    //--------------------------------------------------------------------------
+    //! Account for the tile at (@p x, @p y) changing from @p before, owned by
+    //! @p before_id, to @p after, owned by @p after_id.
+    //--------------------------------------------------------------------------
+    void update(
+        unsigned x, unsigned y,
+        tile_data const& before, room_id before_id,
+        tile_data const& after,  room_id after_id
+    ) {
+        value_ ^= key(x, y, before, before_id) ^ key(x, y, after, after_id);
+    }
+
+    //--------------------------------------------------------------------------
+    //! Write @p value over the tile at (@p x, @p y) of @p m, and update.
+    //!
+    //! @pre the hash is of @p m.
+    //--------------------------------------------------------------------------
+    void set(map& m, unsigned x, unsigned y, tile_data const& value);
+
+    //! The key of one tile.
+    static uint64_t key(
+        unsigned x, unsigned y, tile_data const& tile, room_id id
+    );
+private:
+    uint64_t value_;
+};
+
+} //namespace tez
@@ -2,6 +2,7 @@
 #include "map_layout.hpp"
 
 #include "room_generator.hpp" //temp
+#include "bklib/thread_pool.hpp"
 
 using tez::map_layout;
 
@@ -124,48 +125,290 @@ rect_t get_rect_relative_to(
     return room_rect;
 }
 
+//==============================================================================
+//! Floor division of @p n by occupancy_grid::CELL_SIZE.
+//==============================================================================
+signed cell_of(signed const n) {
+    static auto const SIZE = tez::occupancy_grid::CELL_SIZE;
+    return (n >= 0) ? (n / SIZE) : ((n + 1) / SIZE - 1);
+}
+
+uint64_t cell_key(signed const x, signed const y) {
+    return (static_cast<uint64_t>(static_cast<uint32_t>(x)) << 32) |
+            static_cast<uint64_t>(static_cast<uint32_t>(y));
+}
+
+//==============================================================================
+//! Wall clock limit; a limit of zero never expires.
+//==============================================================================
+class deadline {
+public:
+    typedef std::chrono::steady_clock clock;
+
+    explicit deadline(
+        std::chrono::milliseconds const limit,
+        clock::time_point const         start = clock::now()
+    )
+        : limit_(limit)
+        , start_(start)
+    {
+    }
+
+    bool expired() const {
+        return limit_.count() > 0 && (clock::now() - start_) >= limit_;
+    }
+private:
+    std::chrono::milliseconds limit_;
+    clock::time_point         start_;
+};
+
+//==============================================================================
+//! A coarse grid of the cells of a map that have been written to.
+//==============================================================================
+class dirty_regions {
+public:
+    static unsigned const CELL_SIZE = 16;
+
+    dirty_regions(unsigned const w, unsigned const h)
+        : width_((w + CELL_SIZE - 1) / CELL_SIZE)
+        , height_((h + CELL_SIZE - 1) / CELL_SIZE)
+        , cells_(width_ * height_, 0)
+    {
+    }
+
+    void mark(unsigned const x, unsigned const y) {
+        cells_[x / CELL_SIZE + (y / CELL_SIZE) * width_] = 1;
+    }
+
+    //--------------------------------------------------------------------------
+    //! Whether any cell overlapping the half open rect @p r is dirty.
+    //--------------------------------------------------------------------------
+    bool any(bklib::rect<unsigned> const r) const {
+        auto const x1 = bklib::min(width_,  (r.right  + CELL_SIZE - 1) / CELL_SIZE);
+        auto const y1 = bklib::min(height_, (r.bottom + CELL_SIZE - 1) / CELL_SIZE);
+
+        for (auto y = r.top / CELL_SIZE; y < y1; ++y) {
+            for (auto x = r.left / CELL_SIZE; x < x1; ++x) {
+                if (cells_[x + y * width_]) return true;
+            }
+        }
+
+        return false;
+    }
+private:
+    unsigned             width_;
+    unsigned             height_;
+    std::vector<uint8_t> cells_;
+};
+
+//==============================================================================
+//! Routing state for the first corridor out of a single room.
+//==============================================================================
+struct corridor_job {
+    typedef map_layout::random_t random_t;
+
+    corridor_job(
+        random_t const&                      random,
+        unsigned const                       max_length,
+        tez::shared_generation_params const& tables
+    )
+        : start(random)
+        , random(random)
+        , pg(random_t(), max_length, tables)
+        , found(false)
+        , end_index(0)
+    {
+    }
+
+    //--------------------------------------------------------------------------
+    //! Rewind to the start of this room's random stream.
+    //--------------------------------------------------------------------------
+    void restart() {
+        random      = start;
+        pg.random() = random.split();
+        pg.reset_footprint();
+        found     = false;
+        end_index = 0;
+    }
+
+    random_t            start;
+    random_t            random;
+    tez::path_generator pg;
+    bool                found;
+    unsigned            end_index;
+private:
+    corridor_job(corridor_job const&)            BK_DELETE;
+    corridor_job& operator=(corridor_job const&) BK_DELETE;
+};
+
+//==============================================================================
+//! Index of the room owning @p p in @p m.
+//==============================================================================
+unsigned find_room(tez::map const& m, tez::path_generator::point_t const p) {
+    auto const id = m.room_at(p);
+    BK_ASSERT(id != tez::map::NO_ROOM);
+
+    return static_cast<unsigned>(id - 1);
+}
+
+//==============================================================================
+//! Try random paths out of @p room toward random sides.
+//!
+//! @returns whether one was found, and the index of the room it reached.
+//==============================================================================
+std::pair<bool, unsigned> find_path(
+    tez::room const&           room,
+    tez::map const&            m,
+    tez::map_layout::random_t& random,
+    tez::path_generator&       pg
+) {
+    static unsigned const MAX_ATTEMPTS_PER_ROOM = 5;
+    static unsigned const MAX_ATTEMPTS_PER_DIR  = 5;
+
+    bool found_path = false;
+
+    for (unsigned i = 0; !found_path && i < MAX_ATTEMPTS_PER_ROOM; ++i) {
+        auto const side = tez::random_cardinal_direction(random);
+        
+        for (unsigned j = 0; !found_path && j < MAX_ATTEMPTS_PER_DIR; ++j) {
+            found_path = pg.generate(room, m, side);
+        }
+    }
+    
+    if (!found_path) {
+        return std::make_pair(false, 0u);
+    }
+
+    auto start_point = static_cast<tez::room::point_t>(pg.start_point());
+    BK_ASSERT(room.contains(start_point));
+    
+    return std::make_pair(true, find_room(m, pg.end_point()));
+}
+
 } //namespace
 
-void map_layout::add_room(tez::room room) {
+void tez::occupancy_grid::insert(rect_t const r) {
+    if (!r) return;
+
+    for (auto y = cell_of(r.top); y <= cell_of(r.bottom - 1); ++y) {
+        for (auto x = cell_of(r.left); x <= cell_of(r.right - 1); ++x) {
+            cells_.insert(cell_key(x, y));
+        }
+    }
+}
+
+std::pair<unsigned, unsigned>
+tez::occupancy_grid::count_free(rect_t const r) const {
+    unsigned total = 0;
+    unsigned free  = 0;
+
+    if (!r) return std::make_pair(total, free);
+
+    for (auto y = cell_of(r.top); y <= cell_of(r.bottom - 1); ++y) {
+        for (auto x = cell_of(r.left); x <= cell_of(r.right - 1); ++x) {
+            total++;
+            free += cells_.count(cell_key(x, y)) ? 0 : 1;
+        }
+    }
+
+    return std::make_pair(total, free);
+}
+
+//------------------------------------------------------------------------------
+// The fraction (out of SCORE_MAX) of the cells on the [candidate] side of its
+// rect that are free; zero means the side is enclosed by other rooms.
+//------------------------------------------------------------------------------
+unsigned map_layout::score_candidate_(candidate_t const& candidate) const {
+    static signed   const PROBE_SIZE = 3 * occupancy_grid::CELL_SIZE;
+    static unsigned const SCORE_MAX  = 1024;
+
+    auto const probe = get_rect_relative_to(
+        candidate.first, candidate.second, rect_t(0, 0, PROBE_SIZE, PROBE_SIZE)
+    );
+
+    auto const count = occupied_.count_free(probe);
+
+    return count.first ? (count.second * SCORE_MAX / count.first) : 0;
+}
+
+bool map_layout::add_room(tez::room room) {
     //--------------------------------------------------------------------------
     // Add candidates for each cardinal direction except [from] in random order.
     //--------------------------------------------------------------------------
     auto const add_candidates = [&](direction const from, rect_t const rect) {
         auto dir = tez::random_cardinal_direction(random_);
         for (auto i = 0u; i < NUM_CARDINAL_DIR-1; ++i) {
-            if (dir != from) {
-                candidates_.emplace(dir, rect);
+            auto const candidate = candidate_t(dir, rect);
+            auto const score     = score_candidate_(candidate);
+
+            //skip directions that are already enclosed
+            if (dir != from && score) {
+                scored_candidate const sc = {candidate, score, candidate_order_++};
+                candidates_.push_back(sc);
+                std::push_heap(candidates_.begin(), candidates_.end());
             }
 
             dir = tez::next_cardinal_direction(dir);
         }
     };
     //--------------------------------------------------------------------------
-    // Return a usuable candidate position.
+    // Return the usuable candidate position with the most free space.
     //--------------------------------------------------------------------------
-    auto const get_candidate = [&] {
-        if (candidates_.empty()) {
-            //add candidates for the rect containing all current rooms.
-            add_candidates(direction::here, rect_t(
-                extent_x_.min, extent_y_.min, extent_x_.max, extent_y_.max
-            ));
-        }
+    auto const get_candidate = [&]() -> candidate_t {
+        for (;;) {
+            if (candidates_.empty()) {
+                //add candidates for the rect containing all current rooms.
+                add_candidates(direction::here, rect_t(
+                    extent_x_.min, extent_y_.min, extent_x_.max, extent_y_.max
+                ));
+            }
+
+            std::pop_heap(candidates_.begin(), candidates_.end());
+            auto top = candidates_.back();
+            candidates_.pop_back();
+
+            //scores only go down as rooms are added; rescore lazily.
+            top.score = score_candidate_(top.candidate);
+            if (top.score == 0) {
+                continue;
+            }
 
-        auto const candidate = candidates_.front();
-        candidates_.pop();
+            if (!candidates_.empty() && top < candidates_.front()) {
+                candidates_.push_back(top);
+                std::push_heap(candidates_.begin(), candidates_.end());
+                continue;
+            }
 
-        return candidate;
+            return top.candidate;
+        }
+    };
+    //--------------------------------------------------------------------------
+    auto const try_place = [&](rect_t& where) {
+        status_.placement_attempts++;
+        return adjust_rect(where, rooms_);
     };
     //--------------------------------------------------------------------------
+    auto const time_limit = deadline(budget_.placement_time);
+
     auto where = rect_t(0, 0, 0, 0);
     auto dir   = direction::here;
 
     //find a useable candidate
-    while (!where || !adjust_rect(where, rooms_)) {
+    for (unsigned i = 0; !where || !try_place(where); ++i) {
+        auto const timed_out = time_limit.expired();
+
+        //out of budget; drop the room
+        if (timed_out || i >= budget_.max_placement_attempts) {
+            status_.placement_timed_out |= timed_out;
+            status_.rooms_dropped++;
+            return false;
+        }
+
         std::tie(dir, where) = get_candidate();
         where = get_rect_relative_to(dir, where, room.bounds());
     }
 
+    occupied_.insert(where);
     add_candidates(tez::opposite_direction(dir), where);
 
     room.translate_to(where.left, where.top);
@@ -175,12 +418,44 @@ void map_layout::add_room(tez::room room) {
     extent_x_(where.right);
     extent_y_(where.top);
     extent_y_(where.bottom);
+
+    return true;
 }
 
-tez::map map_layout::make_map() {
-    static unsigned const MAX_ATTEMPTS_PER_ROOM = 5;
-    static unsigned const MAX_ATTEMPTS_PER_DIR  = 5;
+bool map_layout::place_room(tez::room room) {
+    auto const where = room.bounds();
+
+    //coarse cells all free means nothing can overlap; else check exactly.
+    auto const count = occupied_.count_free(where);
+    if (count.first != count.second) {
+        auto const overlaps = std::any_of(
+            std::cbegin(rooms_), std::cend(rooms_), [&](tez::room const& r) {
+                return intersects(where, r.bounds());
+            }
+        );
+
+        if (overlaps) {
+            status_.rooms_dropped++;
+            return false;
+        }
+    }
+
+    occupied_.insert(where);
+    rooms_.emplace_back(std::move(room));
+
+    extent_x_(where.left);
+    extent_x_(where.right);
+    extent_y_(where.top);
+    extent_y_(where.bottom);
+
+    return true;
+}
+
+tez::map map_layout::make_map(bklib::thread_pool* const pool) {
+    return repair_connectivity(route_corridors(rasterise(), pool));
+}
 
+tez::map map_layout::rasterise() {
     auto result = tez::map(extent_x_.distance(), extent_y_.distance());
 
     if (extent_x_.min < 0 || extent_y_.min < 0) {
@@ -190,61 +465,95 @@ tez::map map_layout::make_map() {
     for (auto const& room : rooms_) {
         result.add_room(room);
     }
-   
-    auto pg    = path_generator(bklib::make_random_wrapper(random_));
-    auto graph = boost::adjacency_matrix<boost::undirectedS>(rooms_.size());
+
+    return result;
+}
+
+tez::routed_map map_layout::route_corridors(
+    tez::map                  tiles,
+    bklib::thread_pool* const pool
+) {
+    auto const started = routed_map::clock::now();
+
+    //every corridor steps by the same tables, even across a reload.
+    auto const tables = current_generation_params();
+
+    auto routed = routed_map(
+        std::move(tiles),
+        path_generator(random_.split(), budget_.max_path_length, tables),
+        rooms_.size(),
+        started
+    );
+
+    auto& result = routed.tiles_;
+    auto& graph  = routed.graph_;
 
     //--------------------------------------------------------------------------
-    // Get a random NSEW direction
+    // For each room, attempt to find a path that connects it to another room.
+    //
+    // Each room draws from its own stream, so the paths can be found
+    // speculatively in parallel against the map without corridors. They are
+    // then written in order; a path is found again if it read any region
+    // written by an earlier one. Either way the result is that of finding and
+    // writing the paths one at a time.
     //--------------------------------------------------------------------------
-    auto const find_path = [&](tez::room const& room)
-        -> std::pair<bool, unsigned>
-    {
-        bool found_path = false;
+    std::vector<std::unique_ptr<corridor_job>> jobs;
+    jobs.reserve(rooms_.size());
 
-        for (unsigned i = 0; !found_path && i < MAX_ATTEMPTS_PER_ROOM; ++i) {
-            auto const side = random_cardinal_direction(random_);
-            
-            for (unsigned j = 0; !found_path && j < MAX_ATTEMPTS_PER_DIR; ++j) {
-                found_path = pg.generate(room, result, side);
-            }
-        }
-        
-        if (!found_path) {
-            return std::make_pair(false, 0u);
-        }
+    for (size_t i = 0; i < rooms_.size(); ++i) {
+        jobs.emplace_back(
+            new corridor_job(random_.split(), budget_.max_path_length, tables)
+        );
+    }
+
+    auto const route_room = [&](size_t const i) {
+        auto& job = *jobs[i];
+        job.restart();
 
-        auto start_point = static_cast<room::point_t>(pg.start_point());
-        auto end_point   = static_cast<room::point_t>(pg.end_point());
+        std::tie(job.found, job.end_index) =
+            find_path(rooms_[i], result, job.random, job.pg);
+    };
+
+    auto regions = dirty_regions(result.width(), result.height());
+
+    auto const commit_room = [&](size_t const i) {
+        auto& job = *jobs[i];
+        if (!job.found) return;
 
-        BK_ASSERT(room.contains(start_point));
-            
-        unsigned end_index = 0;
-        for (auto const& r : rooms_) {
-            if (r.contains(end_point)) break;
-            ++end_index;
+        for (auto const& p : job.pg.path()) {
+            regions.mark(p.x, p.y);
         }
-        
-        return std::make_pair(true, end_index);
+
+        boost::add_edge(i, job.end_index, graph);
+        job.pg.write_path(result);
+        status_.corridors++;
     };
-    //--------------------------------------------------------------------------
 
-    
-    unsigned src_index  = 0;
-    unsigned end_index  = 0;
-    bool     found_path = false;
-    
-    //for each room, attempt to find a path that connects it to another room.
-    for (auto const& room : rooms_) {    
-        std::tie(found_path, end_index) = find_path(room);
+    if (pool) {
+        pool->parallel_for(rooms_.size(), route_room);
+    }
 
-        if (found_path) {
-            boost::add_edge(src_index, end_index, graph);
-            pg.write_path(result);
+    for (size_t i = 0; i < rooms_.size(); ++i) {
+        if (!pool || regions.any(jobs[i]->pg.footprint())) {
+            route_room(i);
         }
 
-        ++src_index;
+        commit_room(i);
     }
+
+    return routed;
+}
+
+tez::map map_layout::repair_connectivity(routed_map routed) {
+    auto const time_limit = deadline(budget_.routing_time, routed.started_);
+
+    auto& result = routed.tiles_;
+    auto& graph  = routed.graph_;
+    auto& pg     = routed.pg_;
+
+    unsigned src_index  = 0;
+    unsigned end_index  = 0;
+    bool     found_path = false;
     
     std::vector<unsigned> components(rooms_.size(), 0);
     std::vector<unsigned> vertex_counts(rooms_.size(), 0);
@@ -271,66 +580,119 @@ tez::map map_layout::make_map() {
 
         auto const beg = std::cbegin(components);
         auto const end = std::cend(components);
-        
-        //while a bridge between components has not been found
-        for (bool found_bridge = false; !found_bridge;) {
+
+        //----------------------------------------------------------------------
+        // Commit the path in pg from src to dst if it joins two components.
+        //----------------------------------------------------------------------
+        auto const try_bridge = [&](unsigned const src, unsigned const dst) {
+            bool const exists = boost::edge(src, dst, graph).second;
+            if (exists) return false;
+
+            boost::add_edge(src, dst, graph);
+
+            auto const new_count = boost::connected_components(
+                graph, &components_after[0]
+            );
+            BK_ASSERT(new_count <= count);
+
+            //the path wasn't a bridge; try again
+            if (new_count == count) {
+                boost::remove_edge(src, dst, graph);
+                return false;
+            }
+
+            //commit the new path and components
+            pg.write_path(result);
+            status_.bridges++;
+            count = new_count;
+            std::copy(
+                std::cbegin(components_after),
+                std::cend(components_after),
+                std::begin(components)
+            );
+
+            return true;
+        };
+        //----------------------------------------------------------------------
+
+        bool found_bridge = false;
+
+        //while a bridge between components has not been found, and there is
+        //budget left, try random paths.
+        for (unsigned attempts = 0;
+            !found_bridge && attempts < budget_.max_bridge_attempts;
+        ) {
+            if (time_limit.expired()) {
+                status_.routing_timed_out = true;
+                break;
+            }
+
             //for each vertex, in order, in the component with the minimum
             //number of verticies attempt to add a new path as a bridge
             for (
                 auto where = std::find(beg, end, min);
-                !found_bridge && where != end;
-                where = std::find(++where, end, min)
+                !found_bridge && where != end &&
+                    attempts < budget_.max_bridge_attempts;
+                where = std::find(++where, end, min), ++attempts
             ) {
                 src_index = static_cast<unsigned>(std::distance(beg, where));
-                auto const& room = rooms_[src_index];
-
-                std::tie(found_path, end_index) = find_path(room);
-                if (!found_path) continue;
-
-                bool const exists = boost::edge(src_index, end_index, graph).second;
-                if (exists) continue;
-
-                boost::add_edge(src_index, end_index, graph);
-
-                auto const new_count = boost::connected_components(
-                    graph, &components_after[0]
-                );
-                BK_ASSERT(new_count <= count);
-
-                //the path wasn't a bridge; try again
-                if (new_count == count) {
-                    boost::remove_edge(src_index, end_index, graph);
-                    continue;
-                }
-
-                found_bridge = true;
-                
-                //commit the new path and components
-                pg.write_path(result);
-                count = new_count;
-                std::copy(
-                    std::cbegin(components_after),
-                    std::cend(components_after),
-                    std::begin(components)
-                );
-
-                //reset the vertex counts
-                std::fill(
-                    std::begin(vertex_counts), std::end(vertex_counts), 0
-                );
+
+                std::tie(found_path, end_index) =
+                    find_path(rooms_[src_index], result, random_, pg);
+                found_bridge = found_path && try_bridge(src_index, end_index);
             }
         }
+
+        //out of budget; search for the shortest corridor out of the component
+        //instead.
+        auto const is_other_component = [&](path_generator::point_t const p) {
+            return components[find_room(result, p)] != min;
+        };
+
+        for (
+            auto where = std::find(beg, end, min);
+            !found_bridge && where != end;
+            where = std::find(++where, end, min)
+        ) {
+            src_index = static_cast<unsigned>(std::distance(beg, where));
+            if (!pg.route(rooms_[src_index], result, is_other_component)) {
+                continue;
+            }
+
+            end_index = find_room(result, pg.end_point());
+            found_bridge = try_bridge(src_index, end_index);
+            BK_ASSERT(found_bridge);
+
+            status_.bridges_routed++;
+        }
+
+        //the component is walled in; give up on connecting the rest.
+        if (!found_bridge) {
+            status_.disconnected = true;
+            break;
+        }
+
+        //reset the vertex counts
+        std::fill(std::begin(vertex_counts), std::end(vertex_counts), 0);
     }
 
-    return result;
+    return std::move(result);
 }
 
 void map_layout::normalize() {
     auto const dx = extent_x_.min;
     auto const dy = extent_y_.min;
 
+    occupied_.clear();
+
     for (auto& room : rooms_) {
         room.translate_by(0 - dx, 0 - dy);
+        occupied_.insert(room.bounds());
+    }
+
+    for (auto& c : candidates_) {
+        auto& rect = c.candidate.second;
+        rect = bklib::translate_by(rect, 0 - dx, 0 - dy);
     }
 
     extent_x_.min =  0;
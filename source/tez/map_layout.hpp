@@ -2,60 +2,259 @@
 
 #include "bklib/util.hpp"
 #include "bklib/geometry.hpp"
+#include "bklib/random.hpp"
 
 #include "room.hpp"
 #include "map.hpp"
 
+#include <boost/graph/adjacency_matrix.hpp>
+
 #include <vector>
-#include <queue>
+#include <chrono>
+#include <unordered_set>
+
+namespace bklib { class thread_pool; }
 
 namespace tez {
 
+//==============================================================================
+//! Limits on the work each phase of generation may do before falling back.
+//!
+//! A time limit of zero means "no limit"; the attempt limits always apply.
+//==============================================================================
+struct generation_budget {
+    generation_budget()
+        : max_placement_attempts(100)
+        , max_bridge_attempts(50)
+        , max_path_length(1024)
+        , placement_time(0)
+        , routing_time(0)
+    {
+    }
+
+    unsigned max_placement_attempts; //!< Candidates tried per room.
+    unsigned max_bridge_attempts;    //!< Random paths tried per bridge.
+    unsigned max_path_length;        //!< Steps in a single random path.
+
+    std::chrono::milliseconds placement_time; //!< Per call to add_room.
+    std::chrono::milliseconds routing_time;   //!< Per call to make_map.
+};
+
+//==============================================================================
+//! What, if anything, was degraded to stay within a generation_budget.
+//==============================================================================
+struct generation_status {
+    generation_status()
+        : rooms_dropped(0)
+        , bridges_routed(0)
+        , placement_timed_out(false)
+        , routing_timed_out(false)
+        , disconnected(false)
+        , placement_attempts(0)
+        , corridors(0)
+        , bridges(0)
+    {
+    }
+
+    bool is_degraded() const {
+        return rooms_dropped || bridges_routed || disconnected ||
+               placement_timed_out || routing_timed_out;
+    }
+
+    unsigned rooms_dropped;  //!< Rooms discarded by add_room.
+    unsigned bridges_routed; //!< Bridges made by a searched corridor.
+
+    bool placement_timed_out; //!< A room was dropped due to placement_time.
+    bool routing_timed_out;   //!< Bridging fell back due to routing_time.
+    bool disconnected;        //!< Some rooms could not be connected at all.
+
+    unsigned placement_attempts; //!< Candidate positions tested by add_room.
+    unsigned corridors;          //!< First corridors out of rooms.
+    unsigned bridges;            //!< Corridors added to join components.
+};
+
+//==============================================================================
+//! Sparse set of the coarse cells that rooms in a layout cover.
+//==============================================================================
+class occupancy_grid {
+public:
+    typedef bklib::rect<signed> rect_t;
+
+    static signed const CELL_SIZE = 8;
+
+    void clear() {
+        cells_.clear();
+    }
+
+    //--------------------------------------------------------------------------
+    //! Mark every cell overlapping the half open rect @p r.
+    //--------------------------------------------------------------------------
+    void insert(rect_t r);
+
+    //--------------------------------------------------------------------------
+    //! The number of cells overlapping the half open rect @p r, and how many
+    //! of those are unmarked.
+    //--------------------------------------------------------------------------
+    std::pair<unsigned, unsigned> count_free(rect_t r) const;
+private:
+    std::unordered_set<uint64_t> cells_;
+};
+
+//==============================================================================
+//! A rasterised layout with the first corridor out of each room; the output
+//! of map_layout::route_corridors and the input of repair_connectivity.
+//==============================================================================
+class routed_map {
+public:
+    typedef boost::adjacency_matrix<boost::undirectedS> graph_t;
+    typedef std::chrono::steady_clock                   clock;
+
+    routed_map(routed_map&& other)
+        : tiles_(std::move(other.tiles_))
+        , pg_(std::move(other.pg_))
+        , graph_(std::move(other.graph_))
+        , started_(other.started_)
+    {
+    }
+
+    map const& tiles() const { return tiles_; }
+
+    //! Rooms by index, joined where a corridor connects them.
+    graph_t const& graph() const { return graph_; }
+private:
+    friend class map_layout;
+
+    routed_map(
+        map               tiles,
+        path_generator    pg,
+        size_t            rooms,
+        clock::time_point started
+    )
+        : tiles_(std::move(tiles))
+        , pg_(std::move(pg))
+        , graph_(rooms)
+        , started_(started)
+    {
+    }
+
+    routed_map(routed_map const&)            BK_DELETE;
+    routed_map& operator=(routed_map const&) BK_DELETE;
+
+    map               tiles_;
+    path_generator    pg_;      //!< Carries on into repair_connectivity.
+    graph_t           graph_;
+    clock::time_point started_; //!< For generation_budget::routing_time.
+};
+
 //==============================================================================
 //! Maintains a layout of a variable number of rooms such that no rooms
 //! intersect each other.
 //==============================================================================
 class map_layout {
 public:
-    typedef bklib::random_wrapper<>      random_t;
+    typedef bklib::random_engine         random_t;
     typedef std::vector<room>            room_list;
     typedef bklib::rect<signed>          rect_t;
     typedef std::pair<direction, rect_t> candidate_t;
     
-    map_layout(random_t random)
+    map_layout(random_t random, generation_budget budget = generation_budget())
         : random_(random)
+        , budget_(budget)
         , extent_x_(0)
         , extent_y_(0)    
+        , candidate_order_(0)
     {
     }
 
     //--------------------------------------------------------------------------
     //! Add a room to the layout and take ownership.
+    //!
+    //! @returns @c false if the room was dropped because no position could be
+    //! found within the placement budget.
     //--------------------------------------------------------------------------    
-    void add_room(room r);
+    bool add_room(room r);
+
+    //--------------------------------------------------------------------------
+    //! Add a room to the layout where it already is, for rooms laid out by
+    //! something else (see bsp_layout), and take ownership.
+    //!
+    //! @returns @c false if the room was dropped because it overlaps another.
+    //--------------------------------------------------------------------------
+    bool place_room(room r);
 
     unsigned width()  const { return extent_x_.distance(); }
     unsigned height() const { return extent_y_.distance(); }
 
+    size_t room_count() const { return rooms_.size(); }
+
+    //--------------------------------------------------------------------------
+    //! Create a map from the layout; rasterise, route_corridors and
+    //! repair_connectivity in turn.
+    //!
+    //! If @p pool is given, the first corridor from each room is routed on it
+    //! in parallel; the result is the same as routing them in order.
+    //--------------------------------------------------------------------------
+    map make_map(bklib::thread_pool* pool = nullptr);
+
+    //--------------------------------------------------------------------------
+    //! A map of the rooms alone; normalizes the layout first if need be.
+    //--------------------------------------------------------------------------
+    map rasterise();
+
+    //--------------------------------------------------------------------------
+    //! Route the first corridor out of each room of @p tiles, the result of
+    //! rasterise(); on @p pool as for make_map.
+    //--------------------------------------------------------------------------
+    routed_map route_corridors(
+        map                 tiles,
+        bklib::thread_pool* pool = nullptr
+    );
+
     //--------------------------------------------------------------------------
-    //! Create a map from the layout
+    //! Add corridors until the rooms are connected or the budget runs out.
     //--------------------------------------------------------------------------
-    map make_map();
+    map repair_connectivity(routed_map routed);
 
     //--------------------------------------------------------------------------
     //! Adjust the layout such that all rooms lie in the positive quadrant.
     //--------------------------------------------------------------------------
     void normalize();
+
+    //--------------------------------------------------------------------------
+    //! What was degraded by add_room and make_map so far.
+    //--------------------------------------------------------------------------
+    generation_status const& status() const {
+        return status_;
+    }
 private:
-    random_t random_;
+    random_t          random_;
+    generation_budget budget_;
+    generation_status status_;
 
     bklib::min_max<> extent_x_; //! x range that the rooms occupy.
     bklib::min_max<> extent_y_; //! y range that the rooms occypy.
     
     room_list rooms_; //! The rooms.
 
-    //! Possible locations to attempt to place a new room relative to.
-    std::queue<candidate_t> candidates_;
+    //! A candidate scored by the free space on its side; ties go to the oldest.
+    struct scored_candidate {
+        bool operator<(scored_candidate const& rhs) const {
+            return (score < rhs.score) ||
+                   (score == rhs.score && order > rhs.order);
+        }
+
+        candidate_t candidate;
+        unsigned    score;
+        unsigned    order;
+    };
+
+    unsigned score_candidate_(candidate_t const& candidate) const;
+
+    //! Possible locations to attempt to place a new room relative to; a heap.
+    std::vector<scored_candidate> candidates_;
+    unsigned                      candidate_order_;
+
+    occupancy_grid occupied_; //! Cells covered by rooms.
 };
 
 } //namespace tez
@@ -0,0 +1,341 @@
+#include "pch.hpp"
+#include "map_pipeline.hpp"
+
+#include "room_generator.hpp"
+#include "bklib/thread_pool.hpp"
+#include "bklib/ordered_queue.hpp"
+#include "bklib/scope_exit.hpp"
+
+namespace {
+
+//==============================================================================
+//! Adds the time until it goes out of scope, and one run, to @p stats.
+//==============================================================================
+class stage_timer {
+public:
+    typedef std::chrono::steady_clock clock;
+
+    explicit stage_timer(tez::stage_stats& stats)
+        : stats_(stats)
+        , start_(clock::now())
+    {
+    }
+
+    ~stage_timer() {
+        stats_.time += clock::now() - start_;
+        stats_.runs++;
+    }
+private:
+    stage_timer(stage_timer const&)            BK_DELETE;
+    stage_timer& operator=(stage_timer const&) BK_DELETE;
+
+    tez::stage_stats& stats_;
+    clock::time_point start_;
+};
+
+//==============================================================================
+//! The room generators of a map, in the order generate_map has always drawn
+//! them, so that the maps of a seed do not change.
+//!
+//! Copies generate the same rooms, so each thread may have its own.
+//==============================================================================
+class room_synthesiser {
+public:
+    typedef tez::map_layout::random_t random_t;
+
+    //--------------------------------------------------------------------------
+    //! @param random the map's stream, after the layout's split.
+    //--------------------------------------------------------------------------
+    room_synthesiser(tez::map_params const& params, random_t& random)
+        : compound_interval_(params.compound_interval)
+        , cave_interval_(params.cave_interval)
+        , simple_(random.split())
+        , compound_(random.split())
+        , keys_(random())
+        , cave_(random.split())
+    {
+    }
+
+    //--------------------------------------------------------------------------
+    //! Rooms are keyed by @p index; each is independent of the ones before it.
+    //--------------------------------------------------------------------------
+    tez::room generate(unsigned const index) {
+        auto const key   = static_cast<signed>(index);
+        auto const n     = compound_interval_;
+        auto const caves = cave_interval_;
+
+        if (n && (index % n == 0)) {
+            compound_.seed_at(keys_, key, 0);
+            return compound_.generate();
+        } else if (caves && (index % caves == 0)) {
+            cave_.seed_at(keys_, key, 0);
+            return cave_.generate();
+        }
+
+        simple_.seed_at(keys_, key, 0);
+        return simple_.generate();
+    }
+private:
+    unsigned compound_interval_;
+    unsigned cave_interval_;
+
+    //the members below are initialised in the order of the draws.
+    tez::simple_room_generator   simple_;
+    tez::compound_room_generator compound_;
+    bklib::hash_random           keys_;
+    tez::cave_room_generator     cave_;
+};
+
+//! Rooms synthesised ahead of placement by synthesise_and_place.
+size_t const SYNTHESIS_QUEUE_SIZE = 32;
+
+} //namespace
+
+char const* tez::stage_name(pipeline_stage const stage) {
+    switch (stage) {
+    case pipeline_stage::synthesis     : return "synthesis";
+    case pipeline_stage::placement     : return "placement";
+    case pipeline_stage::rasterisation : return "rasterisation";
+    case pipeline_stage::routing       : return "routing";
+    case pipeline_stage::repair        : return "repair";
+    case pipeline_stage::decoration    : return "decoration";
+    }
+
+    BK_ASSERT(false);
+    return "";
+}
+
+tez::map_pipeline::map_pipeline(map_params const params)
+    : params_(params)
+{
+    BK_ASSERT(params_.room_count > 0);
+}
+
+void tez::map_pipeline::add_decorator(decorator_f f) {
+    decorators_.emplace_back(std::move(f));
+}
+
+tez::room_set tez::map_pipeline::synthesise(uint64_t const seed) {
+    auto& stats = stats_of_(pipeline_stage::synthesis);
+    stage_timer timer(stats);
+
+    auto random = random_t(seed);
+
+    room_set result(seed, random.split());
+    room_synthesiser synth(params_, random);
+
+    result.rooms.reserve(params_.room_count);
+    for (unsigned i = 0; i < params_.room_count; ++i) {
+        result.rooms.emplace_back(synth.generate(i));
+    }
+
+    stats.items += static_cast<unsigned>(result.rooms.size());
+
+    return result;
+}
+
+tez::placed_layout tez::map_pipeline::synthesise_and_place(
+    uint64_t     const  seed,
+    bklib::thread_pool& pool
+) {
+    typedef bklib::ordered_queue<room> queue_t;
+
+    auto random = random_t(seed);
+
+    auto const layout_random = random.split();
+    auto const synth         = room_synthesiser(params_, random);
+    auto const count         = params_.room_count;
+
+    queue_t queue(count, SYNTHESIS_QUEUE_SIZE);
+
+    //each producer has its own generators; the rooms depend only on index.
+    auto const produce = [&](size_t) {
+        auto   local = synth;
+        size_t i     = 0;
+
+        try {
+            while (queue.claim(i)) {
+                queue.push(i, local.generate(static_cast<unsigned>(i)));
+            }
+        } catch (...) {
+            queue.close();
+            throw;
+        }
+    };
+
+    std::exception_ptr error;
+
+    std::thread feeder([&] {
+        stage_timer timer(stats_of_(pipeline_stage::synthesis));
+
+        try {
+            pool.parallel_for(pool.size(), produce);
+        } catch (...) {
+            error = std::current_exception();
+        }
+    });
+
+    //whichever way this ends, the feeder must not outlive the queue.
+    BK_ON_SCOPE_EXIT({
+        queue.close();
+        if (feeder.joinable()) feeder.join();
+    });
+
+    auto& stats = stats_of_(pipeline_stage::placement);
+    stage_timer timer(stats);
+
+    std::unique_ptr<map_layout> layout(
+        new map_layout(layout_random, params_.budget)
+    );
+
+    auto const add = [&](room r) {
+        if (layout->add_room(std::move(r))) {
+            stats.items++;
+        }
+    };
+
+    while (queue.pop(add)) {
+    }
+
+    //the queue is only closed early by a producer that threw.
+    feeder.join();
+    if (error) {
+        std::rethrow_exception(error);
+    }
+
+    stats_of_(pipeline_stage::synthesis).items += count;
+
+    layout->normalize();
+
+    return placed_layout(seed, std::move(layout));
+}
+
+tez::placed_layout tez::map_pipeline::place(room_set rooms) {
+    auto& stats = stats_of_(pipeline_stage::placement);
+    stage_timer timer(stats);
+
+    std::unique_ptr<map_layout> layout(
+        new map_layout(rooms.layout_random, params_.budget)
+    );
+
+    for (auto& r : rooms.rooms) {
+        if (layout->add_room(std::move(r))) {
+            stats.items++;
+        }
+    }
+
+    layout->normalize();
+
+    return placed_layout(rooms.seed, std::move(layout));
+}
+
+tez::rasterised_map tez::map_pipeline::rasterise(placed_layout placed) {
+    auto& stats = stats_of_(pipeline_stage::rasterisation);
+    stage_timer timer(stats);
+
+    auto tiles = placed.layout->rasterise();
+    stats.items += static_cast<unsigned>(placed.layout->room_count());
+
+    return rasterised_map(std::move(placed), std::move(tiles));
+}
+
+tez::routed_layout tez::map_pipeline::route(
+    rasterised_map            raster,
+    bklib::thread_pool* const pool
+) {
+    auto& stats = stats_of_(pipeline_stage::routing);
+    stage_timer timer(stats);
+
+    auto routed = raster.layout->route_corridors(std::move(raster.tiles), pool);
+    stats.items += raster.layout->status().corridors;
+
+    return routed_layout(std::move(raster), std::move(routed));
+}
+
+tez::generated_map tez::map_pipeline::repair(routed_layout routed) {
+    auto& stats = stats_of_(pipeline_stage::repair);
+    stage_timer timer(stats);
+
+    auto& layout = *routed.layout;
+    auto  tiles  = layout.repair_connectivity(std::move(routed.routed));
+
+    stats.items += layout.status().bridges;
+
+    return generated_map(routed.seed, std::move(tiles), layout.status());
+}
+
+tez::generated_map tez::map_pipeline::decorate(generated_map m) {
+    auto& stats = stats_of_(pipeline_stage::decoration);
+    stage_timer timer(stats);
+
+    //a stream of its own, so decorators do not disturb the other stages.
+    auto random = bklib::hash_random(m.seed).engine_at(
+        0, 0, random_purpose::decoration
+    );
+
+    for (auto const& f : decorators_) {
+        stats.items += f(m.result, random);
+    }
+
+    return m;
+}
+
+tez::generated_map tez::map_pipeline::finish_(
+    room_set                  rooms,
+    bklib::thread_pool* const pool
+) {
+    return decorate(repair(route(rasterise(place(std::move(rooms))), pool)));
+}
+
+tez::generated_map tez::map_pipeline::run(
+    uint64_t            const seed,
+    bklib::thread_pool* const pool
+) {
+    if (!pool) {
+        return finish_(synthesise(seed), nullptr);
+    }
+
+    return decorate(repair(route(
+        rasterise(synthesise_and_place(seed, *pool)), pool
+    )));
+}
+
+void tez::map_pipeline::run_overlapped(
+    uint64_t            const  batch_seed,
+    unsigned            const  count,
+    bklib::thread_pool&        pool,
+    sink_f              const& sink
+) {
+    if (count == 0) return;
+
+    std::unique_ptr<room_set> current(
+        new room_set(synthesise(map_seed(batch_seed, 0)))
+    );
+
+    for (unsigned i = 0; i < count; ++i) {
+        std::unique_ptr<room_set>      next;
+        std::unique_ptr<generated_map> done;
+
+        //synthesis of the next map alongside the rest of this one.
+        pool.parallel_for(2, [&](size_t const job) {
+            if (job == 0) {
+                if (i + 1 < count) {
+                    next.reset(new room_set(
+                        synthesise(map_seed(batch_seed, i + 1))
+                    ));
+                }
+            } else {
+                done.reset(new generated_map(
+                    finish_(std::move(*current), nullptr)
+                ));
+            }
+        });
+
+        sink(std::move(*done));
+        current = std::move(next);
+    }
+}
+
+void tez::map_pipeline::reset_stats() {
+    std::fill(std::begin(stats_), std::end(stats_), stage_stats());
+}
@@ -0,0 +1,235 @@
+#pragma once
+
+#include "bklib/util.hpp"
+#include "bklib/random.hpp"
+
+#include "map.hpp"
+#include "map_layout.hpp"
+#include "map_batch.hpp"
+
+#include <vector>
+#include <memory>
+#include <chrono>
+#include <functional>
+#include <cstdint>
+
+namespace bklib { class thread_pool; }
+
+namespace tez {
+
+//==============================================================================
+//! The stages of map_pipeline, in the order they run.
+//==============================================================================
+enum class pipeline_stage : uint8_t {
+    synthesis,     //!< Generate the rooms.
+    placement,     //!< Lay the rooms out.
+    rasterisation, //!< Draw the rooms into a map.
+    routing,       //!< The first corridor out of each room.
+    repair,        //!< Corridors joining the rooms left apart.
+    decoration,    //!< Anything else drawn into the finished map.
+};
+
+static unsigned const PIPELINE_STAGE_COUNT = 6;
+
+char const* stage_name(pipeline_stage stage);
+
+//==============================================================================
+//! Time spent and work done by one stage, summed over every map.
+//==============================================================================
+struct stage_stats {
+    stage_stats()
+        : time(0)
+        , runs(0)
+        , items(0)
+    {
+    }
+
+    std::chrono::steady_clock::duration time;
+
+    unsigned runs;  //!< Maps passed through.
+    unsigned items; //!< What the stage makes; see map_pipeline.
+};
+
+//==============================================================================
+//! The output of synthesis.
+//==============================================================================
+struct room_set {
+    typedef map_layout::random_t random_t;
+
+    room_set(uint64_t const seed, random_t const layout_random)
+        : seed(seed)
+        , layout_random(layout_random)
+    {
+    }
+
+    room_set(room_set&& other)
+        : seed(other.seed)
+        , layout_random(other.layout_random)
+        , rooms(std::move(other.rooms))
+    {
+    }
+
+    uint64_t          seed;
+    random_t          layout_random; //!< For the map_layout to place them.
+    std::vector<room> rooms;
+};
+
+//==============================================================================
+//! The output of placement.
+//==============================================================================
+struct placed_layout {
+    placed_layout(uint64_t const seed, std::unique_ptr<map_layout> layout)
+        : seed(seed)
+        , layout(std::move(layout))
+    {
+    }
+
+    placed_layout(placed_layout&& other)
+        : seed(other.seed)
+        , layout(std::move(other.layout))
+    {
+    }
+
+    uint64_t                    seed;
+    std::unique_ptr<map_layout> layout;
+};
+
+//==============================================================================
+//! The output of rasterisation.
+//==============================================================================
+struct rasterised_map {
+    rasterised_map(placed_layout placed, map tiles)
+        : seed(placed.seed)
+        , layout(std::move(placed.layout))
+        , tiles(std::move(tiles))
+    {
+    }
+
+    rasterised_map(rasterised_map&& other)
+        : seed(other.seed)
+        , layout(std::move(other.layout))
+        , tiles(std::move(other.tiles))
+    {
+    }
+
+    uint64_t                    seed;
+    std::unique_ptr<map_layout> layout;
+    map                         tiles;
+};
+
+//==============================================================================
+//! The output of routing.
+//==============================================================================
+struct routed_layout {
+    routed_layout(rasterised_map raster, routed_map routed)
+        : seed(raster.seed)
+        , layout(std::move(raster.layout))
+        , routed(std::move(routed))
+    {
+    }
+
+    routed_layout(routed_layout&& other)
+        : seed(other.seed)
+        , layout(std::move(other.layout))
+        , routed(std::move(other.routed))
+    {
+    }
+
+    uint64_t                    seed;
+    std::unique_ptr<map_layout> layout;
+    routed_map                  routed;
+};
+
+//==============================================================================
+//! Map generation as a chain of stages, each taking the output of the one
+//! before; the output of repair and decoration is a generated_map.
+//!
+//! Each stage is timed, and counts what it makes: rooms for synthesis, rooms
+//! kept for placement, rooms drawn for rasterisation, corridors for routing,
+//! bridges for repair and whatever the decorators report for decoration.
+//==============================================================================
+class map_pipeline {
+public:
+    typedef map_layout::random_t random_t;
+
+    //--------------------------------------------------------------------------
+    //! Draws into a finished map; returns how many things it drew.
+    //--------------------------------------------------------------------------
+    typedef std::function<unsigned (map& m, random_t& random)> decorator_f;
+
+    typedef std::function<void (generated_map m)> sink_f;
+
+    explicit map_pipeline(map_params params = map_params());
+
+    //--------------------------------------------------------------------------
+    //! Run @p f on every map, in the order added, at the decoration stage.
+    //--------------------------------------------------------------------------
+    void add_decorator(decorator_f f);
+
+    room_set       synthesise(uint64_t seed);
+    placed_layout  place(room_set rooms);
+    rasterised_map rasterise(placed_layout placed);
+    routed_layout  route(
+        rasterised_map raster, bklib::thread_pool* pool = nullptr
+    );
+    generated_map  repair(routed_layout routed);
+    generated_map  decorate(generated_map m);
+
+    //--------------------------------------------------------------------------
+    //! Synthesis and placement at once: the rooms are synthesised on @p pool,
+    //! a bounded queue ahead, and placed in order on the calling thread as
+    //! they arrive. The layout is that of place(synthesise(@p seed)).
+    //!
+    //! @remark Not to be called from a job on @p pool.
+    //--------------------------------------------------------------------------
+    placed_layout synthesise_and_place(uint64_t seed, bklib::thread_pool& pool);
+
+    //--------------------------------------------------------------------------
+    //! Every stage in turn. Without decorators, the map is that of
+    //! generate_map(seed, params()).
+    //!
+    //! With @p pool, synthesis overlaps placement (see synthesise_and_place)
+    //! and routing runs on it too; the map is the same.
+    //--------------------------------------------------------------------------
+    generated_map run(uint64_t seed, bklib::thread_pool* pool = nullptr);
+
+    //--------------------------------------------------------------------------
+    //! Give the maps of seeds map_seed(@p batch_seed, i) for i in
+    //! [0, @p count) to @p sink in order, on the calling thread.
+    //!
+    //! The rooms for map i + 1 are synthesised on @p pool while map i goes
+    //! through the later stages; the maps are those of run().
+    //--------------------------------------------------------------------------
+    void run_overlapped(
+        uint64_t            batch_seed,
+        unsigned            count,
+        bklib::thread_pool& pool,
+        sink_f const&       sink
+    );
+
+    stage_stats const& stats(pipeline_stage const stage) const {
+        return stats_[static_cast<unsigned>(stage)];
+    }
+
+    void reset_stats();
+
+    map_params const& params() const { return params_; }
+private:
+    map_pipeline(map_pipeline const&)            BK_DELETE;
+    map_pipeline& operator=(map_pipeline const&) BK_DELETE;
+
+    stage_stats& stats_of_(pipeline_stage const stage) {
+        return stats_[static_cast<unsigned>(stage)];
+    }
+
+    //! Placement through decoration.
+    generated_map finish_(room_set rooms, bklib::thread_pool* pool);
+
+    map_params               params_;
+    std::vector<decorator_f> decorators_;
+
+    //! Each stage only writes its own entry, so stages may overlap.
+    stage_stats stats_[PIPELINE_STAGE_COUNT];
+};
+
+} //namespace tez
@@ -1,3 +1,64 @@
 #include "pch.hpp"
 #include "room.hpp"
 
+void tez::room::scan_connections(
+    grid_t const& grid, connection_list (&out)[NUM_CARDINAL_DIR]
+) {
+    static auto const CEIL  = tile_category::ceiling;
+    static auto const FLOOR = tile_category::floor;
+    static auto const WALL  = tile_category::wall;
+    static auto const EMPTY = tile_category::empty;
+
+    auto const cols = grid.width();
+    auto const rows = grid.height();
+
+    //one pass over the ceiling tiles.
+    for (unsigned y = 0; y < rows; ++y) {
+        auto const* const row   = &grid.at(0, y);
+        auto const* const above = (y > 0)        ? row - cols : nullptr;
+        auto const* const below = (y + 1 < rows) ? row + cols : nullptr;
+
+        for (unsigned x = 0; x < cols; ++x) {
+            if (row[x] != CEIL) continue;
+
+            auto const n = above          ? above[x]   : EMPTY;
+            auto const s = below          ? below[x]   : EMPTY;
+            auto const e = (x + 1 < cols) ? row[x + 1] : EMPTY;
+            auto const w = (x > 0)        ? row[x - 1] : EMPTY;
+
+            //faces outward to nothing and inward to floor; the tiles under a
+            //north facing ceiling are wall. Indexed by direction.
+            bool const faces[NUM_CARDINAL_DIR] = {
+                n == EMPTY && (s == FLOOR || s == WALL),
+                s == EMPTY && n == FLOOR,
+                e == EMPTY && w == FLOOR,
+                w == EMPTY && e == FLOOR,
+            };
+
+            for (unsigned side = 0; side < NUM_CARDINAL_DIR; ++side) {
+                if (faces[side]) out[side].emplace_back(x, y);
+            }
+        }
+    }
+}
+
+void tez::room::find_connections_(connection_rule_f const rule) {
+    connections_.clear();
+    std::fill_n(connection_offsets_, NUM_CARDINAL_DIR + 1, 0);
+
+    //simple rooms compute their points on demand.
+    if (kind_ == room_kind::simple) return;
+
+    connection_list found[NUM_CARDINAL_DIR];
+    rule(*data_, found);
+
+    for (unsigned side = 0; side < NUM_CARDINAL_DIR; ++side) {
+        connection_offsets_[side] = static_cast<unsigned>(connections_.size());
+        connections_.insert(
+            connections_.end(), found[side].begin(), found[side].end()
+        );
+    }
+
+    connection_offsets_[NUM_CARDINAL_DIR] =
+        static_cast<unsigned>(connections_.size());
+}
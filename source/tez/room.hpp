@@ -2,16 +2,28 @@
 
 #include "bklib/geometry.hpp"
 #include "bklib/util.hpp"
+#include "bklib/random.hpp"
 
 #include "types.hpp"
 #include "grid2d.hpp"
 #include "tile_category.hpp"
 #include "direction.hpp"
 
-#include <functional>
+#include <vector>
+#include <memory>
 
 namespace tez {
 
+//==============================================================================
+//! The kinds of room; dispatched on with a switch rather than a stored
+//! callable.
+//==============================================================================
+enum class room_kind : uint8_t {
+    simple,   //!< Rectangular; connection points follow from the size.
+    compound, //!< Any shape; connection points found by a scan.
+    custom,   //!< Any shape; connection points found by a connection_rule_f.
+};
+
 //==============================================================================
 //! Room.
 //==============================================================================
@@ -24,44 +36,85 @@ public:
     typedef bklib::point2d<index_t> connection_point;
     typedef bklib::point2d<location_t> point_t;
 
-    typedef bklib::random_wrapper<> random_t;
+    typedef bklib::random_engine    random_t;
     typedef grid2d<tile_category>   grid_t;
 
-    typedef std::function<connection_point (
-        room const& room, direction side, random_t random
-    )> connection_finder_f;
-
-    typedef grid_t::iterator       iterator;
     typedef grid_t::const_iterator const_iterator;
+
+    //! Tile data is immutable once in a room, so equal rooms can share it.
+    typedef std::shared_ptr<grid_t const> shared_grid;
+
+    typedef std::vector<connection_point> connection_list;
+
+    //--------------------------------------------------------------------------
+    //! Extension hook for custom kinds: fill @p out[side] with the local
+    //! connection points of @p grid for each cardinal side. Called once, at
+    //! construction.
     //--------------------------------------------------------------------------
-    room(grid_t grid, connection_finder_f finder)
+    typedef void (*connection_rule_f)(
+        grid_t const& grid, connection_list (&out)[NUM_CARDINAL_DIR]
+    );
+    //--------------------------------------------------------------------------
+    explicit room(grid_t grid, room_kind const kind = room_kind::compound)
+        : data_(share_(std::move(grid)))
+        , rect_(0, 0, data_->width(), data_->height())
+        , kind_(kind)
+    {
+        BK_ASSERT(rect_);
+        BK_ASSERT(kind_ != room_kind::custom);
+        find_connections_(scan_connections);
+    }
+
+    //--------------------------------------------------------------------------
+    //! An instance of a shared (prefab) grid; see prefab_cache.
+    //--------------------------------------------------------------------------
+    explicit room(shared_grid grid, room_kind const kind = room_kind::compound)
         : data_(std::move(grid))
-        , rect_(0, 0, data_.width(), data_.height())
-        , finder_(std::move(finder))
+        , rect_(0, 0, data_->width(), data_->height())
+        , kind_(kind)
     {
         BK_ASSERT(rect_);
+        BK_ASSERT(kind_ != room_kind::custom);
+        find_connections_(scan_connections);
+    }
+
+    room(grid_t grid, connection_rule_f const rule)
+        : data_(share_(std::move(grid)))
+        , rect_(0, 0, data_->width(), data_->height())
+        , kind_(room_kind::custom)
+    {
+        BK_ASSERT(rect_);
+        BK_ASSERT(rule);
+        find_connections_(rule);
+    }
+
+    room(shared_grid grid, connection_rule_f const rule)
+        : data_(std::move(grid))
+        , rect_(0, 0, data_->width(), data_->height())
+        , kind_(room_kind::custom)
+    {
+        BK_ASSERT(rect_);
+        BK_ASSERT(rule);
+        find_connections_(rule);
     }
     
     room(room&& other)
         : data_(std::move(other.data_)) 
         , rect_(other.rect_)
-        , finder_(other.finder_)
+        , kind_(other.kind_)
+        , connections_(std::move(other.connections_))
     {
+        std::copy_n(
+            other.connection_offsets_, NUM_CARDINAL_DIR + 1, connection_offsets_
+        );
     }
     //--------------------------------------------------------------------------
-    block_iterator_adapter<grid_t> block_iterator() {
-        return block_iterator_adapter<grid_t>(data_);
-    }
-
     block_iterator_adapter<grid_t const> block_iterator() const {
-        return block_iterator_adapter<grid_t const>(data_);
+        return block_iterator_adapter<grid_t const>(*data_);
     }
     //--------------------------------------------------------------------------
-    iterator begin() { return data_.begin(); }
-    iterator end()   { return data_.end(); }
-
-    const_iterator begin() const { return data_.begin(); }
-    const_iterator end()   const { return data_.end(); }
+    const_iterator begin() const { return data_->begin(); }
+    const_iterator end()   const { return data_->end(); }
     //--------------------------------------------------------------------------
     room& operator=(room&& rhs) {
         swap(rhs);
@@ -71,9 +124,15 @@ public:
     void swap(room& other) {
         using std::swap;
 
-        swap(data_,   other.data_);
-        swap(rect_,   other.rect_);
-        swap(finder_, other.finder_);
+        swap(data_,        other.data_);
+        swap(rect_,        other.rect_);
+        swap(kind_,        other.kind_);
+        swap(connections_, other.connections_);
+
+        std::swap_ranges(
+            connection_offsets_, connection_offsets_ + NUM_CARDINAL_DIR + 1,
+            other.connection_offsets_
+        );
     }
     //--------------------------------------------------------------------------
     unsigned width()  const { return rect_.width(); }
@@ -97,11 +156,14 @@ public:
     }
     //--------------------------------------------------------------------------
     tile_category at(unsigned x, unsigned y) const {
-        return data_.at(x, y);
+        return data_->at(x, y);
     }
-    
-    tile_category& at(unsigned x, unsigned y) {
-        return data_.at(x, y);
+
+    //--------------------------------------------------------------------------
+    //! The tile data; possibly shared with other rooms.
+    //--------------------------------------------------------------------------
+    shared_grid const& shape() const {
+        return data_;
     }
 
     bool contains(point_t const p) const {
@@ -113,23 +175,118 @@ public:
     }
 
     grid_block<tile_category, true> block_at(unsigned x, unsigned y) const {
-        return data_.block_at(x, y);
+        return data_->block_at(x, y);
     }
 
+    //--------------------------------------------------------------------------
+    //! The number of tiles a corridor may leave from toward @p side.
+    //--------------------------------------------------------------------------
+    unsigned connection_count(direction const side) const {
+        auto const i = side_index_(side);
+
+        switch (kind_) {
+        case room_kind::simple :
+            return simple_connection_count_(side);
+        default :
+            return connection_offsets_[i + 1] - connection_offsets_[i];
+        }
+    }
+
+    room_kind kind() const {
+        return kind_;
+    }
+
+    bool has_connection_point(direction const side) const {
+        return connection_count(side) != 0;
+    }
+
+    //--------------------------------------------------------------------------
+    //! A uniformly chosen connection point on @p side, in map coordinates.
+    //! @pre has_connection_point(side).
+    //--------------------------------------------------------------------------
     connection_point find_connection_point(
         direction const side,
-        random_t        random
+        random_t&       random
     ) const {
-        BK_ASSERT(finder_);
-        return finder_(*this, side, random);
+        auto const n = connection_count(side);
+        BK_ASSERT(n > 0);
+
+        auto const p = connection_at_(side, bklib::random_bounded(random, n));
+        return connection_point(p.x + left(), p.y + top());
     }
+
+    //--------------------------------------------------------------------------
+    //! The rule for room_kind::compound; usable by custom rules too. A point
+    //! on a side faces outward to nothing and inward to floor (or to wall,
+    //! under a north facing ceiling).
+    //--------------------------------------------------------------------------
+    static void scan_connections(
+        grid_t const& grid, connection_list (&out)[NUM_CARDINAL_DIR]
+    );
 private:
     room(room const&)            BK_DELETE;
     room& operator=(room const&) BK_DELETE;
 
-    grid_t              data_;   //<! Tile data.
-    rect_t              rect_;   //<! Bounds.
-    connection_finder_f finder_; //<! Algorithm to find an edge.
+    static unsigned side_index_(direction const side) {
+        auto const i = static_cast<unsigned>(side);
+        BK_ASSERT(i < NUM_CARDINAL_DIR);
+        return i;
+    }
+
+    //--------------------------------------------------------------------------
+    //! Simple rooms: the edge tiles between the corners, less the wall row on
+    //! the east and west sides.
+    //--------------------------------------------------------------------------
+    unsigned simple_connection_count_(direction const side) const {
+        auto const w = width();
+        auto const h = height();
+
+        switch (side) {
+        case direction::north :
+        case direction::south :
+            return (w > 2) ? w - 2 : 0;
+        default :
+            return (h > 3) ? h - 3 : 0;
+        }
+    }
+
+    connection_point connection_at_(
+        direction const side,
+        unsigned  const i
+    ) const {
+        auto const r = width() - 1;
+        auto const b = height() - 1;
+
+        switch (kind_) {
+        case room_kind::simple :
+            switch (side) {
+            case direction::north : return connection_point(1 + i, 0);
+            case direction::south : return connection_point(1 + i, b);
+            case direction::east  : return connection_point(r, 2 + i);
+            default               : return connection_point(0, 2 + i);
+            }
+        default :
+            return connections_[connection_offsets_[side_index_(side)] + i];
+        }
+    }
+
+    static shared_grid share_(grid_t&& grid) {
+        return std::make_shared<grid_t const>(std::move(grid));
+    }
+
+    //--------------------------------------------------------------------------
+    //! Fill the connection lists with @p rule; simple rooms need none.
+    //--------------------------------------------------------------------------
+    void find_connections_(connection_rule_f rule);
+
+    shared_grid data_; //<! Tile data.
+    rect_t      rect_; //<! Bounds.
+    room_kind   kind_; //<! Selects the connection rule.
+
+    //! Local connection points grouped by side; side i is the range
+    //! [connection_offsets_[i], connection_offsets_[i+1]).
+    connection_list connections_;
+    unsigned        connection_offsets_[NUM_CARDINAL_DIR + 1];
 };
 
 inline void swap(room& a, room& b) {
@@ -9,18 +9,18 @@ tez::simple_room_generator::simple_room_generator(random_t random)
 
 tez::room
 tez::simple_room_generator::generate() {
-    static auto const MIN_W = 3;
-    static auto const MAX_W = 10;
-    static auto const MIN_H = 4;
-    static auto const MAX_H = 10;
+    auto const w = tables_->simple_width()(random_);
+    auto const h = tables_->simple_height()(random_);
 
-    typedef std::uniform_int_distribution<unsigned> distribution_t;
+    return make(prefabs_, w, h);
+}
 
-    auto const w = distribution_t(MIN_W, MAX_W)(random_);
-    auto const h = distribution_t(MIN_H, MAX_H)(random_);
+tez::generator::grid_t
+tez::simple_room_generator::rasterise(unsigned const w, unsigned const h) {
+    BK_ASSERT(w >= 3 && h >= 4);
 
     grid_t result(w, h, tile_category::floor);
-    
+
     for (auto& block : result.block_iterator()) {
         auto const x = block.x;
         auto const y = block.y;
@@ -34,68 +34,148 @@ tez::simple_room_generator::generate() {
         }
     }
 
-    return room(std::move(result), find_connection_point);
+    return result;
 }
 
-tez::simple_room_generator::connection_point
-tez::simple_room_generator::find_connection_point(
-    room      const& room,
-    direction const  side,
-    random_t         random
+tez::room tez::simple_room_generator::make(
+    prefab_cache&  prefabs,
+    unsigned const w,
+    unsigned const h
 ) {
-    typedef std::uniform_int_distribution<unsigned> distribution_t;
-
-    auto const w = room.width() - 1;
-    auto const h = room.height() - 1;
+    auto const key = (static_cast<uint64_t>(w) << 32) | h;
+    auto const raster = [w, h] { return rasterise(w, h); };
 
-    unsigned const x =
-        (side == direction::west) ? 0 :
-        (side == direction::east) ? w :
-        distribution_t(1, w-1)(random);
-
-    unsigned const y =
-        (side == direction::north) ? 0 :
-        (side == direction::south) ? h :
-        distribution_t(2, h-1)(random);
-
-    BK_ASSERT(room.at(x, y) == tile_category::ceiling);
-
-    return connection_point(x + room.left(), y + room.top());
+    return room(prefabs.find_or_make(key, raster), room_kind::simple);
 }
 
 tez::compound_room_generator::compound_room_generator(random_t random)
     : generator(random)
+    , cell_count_(tables_->cell_count())
 {
 }
 
+tez::compound_room_generator::compound_room_generator(
+    random_t       random,
+    unsigned const count_min,
+    unsigned const count_max
+)
+    : generator(random)
+    , cell_count_(count_min, count_max)
+{
+    BK_ASSERT(count_min > 0);
+}
+
 //==============================================================================
 namespace {
 
-typedef bklib::random_wrapper<>         random_t;
+typedef bklib::random_engine            random_t;
 typedef bklib::point2d<signed>          point_t;
 typedef std::vector<point_t>            point_list;
 typedef tez::grid2d<tez::tile_category> grid_t;
+typedef bklib::uniform_int<unsigned>    distribution_t;
+
+//==============================================================================
+//! Open addressing (linear probing) set of points.
+//==============================================================================
+class point_set {
+public:
+    explicit point_set(size_t const expected) {
+        size_t capacity = 16;
+        while (capacity < expected * 2) capacity *= 2;
+
+        reset_(capacity);
+    }
+
+    bool contains(point_t const p) const {
+        auto const key = key_(p);
+
+        for (auto i = slot_(key); used_[i]; i = (i + 1) & mask_) {
+            if (keys_[i] == key) return true;
+        }
+
+        return false;
+    }
+
+    //--------------------------------------------------------------------------
+    //! @returns false if @p p was already present.
+    //--------------------------------------------------------------------------
+    bool insert(point_t const p) {
+        if ((size_ + 1) * 2 > keys_.size()) {
+            grow_();
+        }
+
+        return insert_(key_(p));
+    }
+private:
+    static uint64_t key_(point_t const p) {
+        return (static_cast<uint64_t>(static_cast<uint32_t>(p.y)) << 32) |
+                static_cast<uint64_t>(static_cast<uint32_t>(p.x));
+    }
+
+    size_t slot_(uint64_t const key) const {
+        return static_cast<size_t>(bklib::mix64(key)) & mask_;
+    }
+
+    bool insert_(uint64_t const key) {
+        auto i = slot_(key);
+
+        for (; used_[i]; i = (i + 1) & mask_) {
+            if (keys_[i] == key) return false;
+        }
+
+        keys_[i] = key;
+        used_[i] = 1;
+        size_++;
+
+        return true;
+    }
+
+    void reset_(size_t const capacity) {
+        keys_.assign(capacity, 0);
+        used_.assign(capacity, 0);
+        mask_ = capacity - 1;
+        size_ = 0;
+    }
+
+    void grow_() {
+        std::vector<uint64_t> keys;
+        std::vector<uint8_t>  used;
+
+        keys.swap(keys_);
+        used.swap(used_);
+
+        reset_(keys.size() * 2);
+
+        for (size_t i = 0; i < keys.size(); ++i) {
+            if (used[i]) insert_(keys[i]);
+        }
+    }
+
+    std::vector<uint64_t> keys_;
+    std::vector<uint8_t>  used_;
+    size_t                mask_;
+    size_t                size_;
+};
 
 std::tuple<unsigned, bklib::min_max<>, bklib::min_max<>>
 generate_points(
-    point_list& out,
-    random_t    random
+    point_list&           out,
+    random_t&             random,
+    distribution_t const& cell_sizes,
+    distribution_t const& cell_counts
 ) {
-    typedef std::uniform_int_distribution<unsigned> distribution_t;
-
     BK_DECLARE_DIRECTION_ARRAYS(dx, dy);
 
-    static auto const CELL_SIZE_MIN = 4;
-    static auto const CELL_SIZE_MAX = 6;
-    static auto const COUNT_MIN     = 10;
-    static auto const COUNT_MAX     = 20;
+    static auto const MAX_RESTARTS = 64;
 
-    auto const cell_size  = distribution_t(CELL_SIZE_MIN, CELL_SIZE_MAX)(random);
-    auto const cell_count = distribution_t(COUNT_MIN, COUNT_MAX)(random);   
+    auto const cell_size  = cell_sizes(random);
+    auto const cell_count = cell_counts(random);
 
     bklib::min_max<> range_x;
     bklib::min_max<> range_y;
 
+    point_set occupied(cell_count);
+
     //--------------------------------------------------------------------------
     // Add a point and update the x and y range
     //--------------------------------------------------------------------------
@@ -103,11 +183,11 @@ generate_points(
         range_x(p.x);
         range_y(p.y);
         out.push_back(p);
+        occupied.insert(p);
     };
     //----------------------------------------------------------------------
     auto const is_occupied = [&](point_t const p) {
-        return std::cend(out) !=
-            std::find(std::cbegin(out), std::cend(out), p);
+        return occupied.contains(p);
     };
     //----------------------------------------------------------------------
     auto const choose_point = [&](point_t const p) -> std::pair<bool, point_t> {
@@ -134,6 +214,14 @@ generate_points(
     for (bool found = true; found && out.size() < cell_count;) {
         add_point(p);
         std::tie(found, p) = choose_point(p);
+
+        //the walk boxed itself in; carry on from some earlier point.
+        for (auto i = 0; !found && i < MAX_RESTARTS; ++i) {
+            auto const n = static_cast<unsigned>(out.size());
+            auto const q = out[distribution_t(0, n-1)(random)];
+
+            std::tie(found, p) = choose_point(q);
+        }
     }
 
     return std::make_tuple(cell_size, range_x, range_y);
@@ -155,47 +243,97 @@ grid_t points_to_grid(
         auto const yb = (p.y - range_y.min) * cell_size;
 
         for (auto yi = 0u; yi < cell_size; ++yi) {
-            for (auto xi = 0u; xi < cell_size; ++xi) {
-                result.at(xi + xb, yi + yb) = tez::tile_category::floor;
-            }
+            std::fill_n(
+                &result.at(xb, yi + yb), cell_size, tez::tile_category::floor
+            );
         }
     }
 
     return result;
 }
 
+//==============================================================================
+//! Non empty tiles next to (or diagonal to) an empty tile, or the edge of the
+//! grid, become ceiling; those directly south of a ceiling become wall.
+//!
+//! Done a row of 64 tiles at a time: the empty mask is dilated by one tile in
+//! each direction and intersected with the solid mask.
+//==============================================================================
 void transform_grid(grid_t& grid) {
-    typedef tez::grid_block<tez::tile_category> block_t;
+    typedef uint64_t word_t;
 
-    static auto const EMPTY = tez::tile_category::empty;
-    static auto const CEIL  = tez::tile_category::ceiling;
-    static auto const WALL  = tez::tile_category::wall;
+    static unsigned const BITS  = 64;
+    static word_t   const ALL   = ~word_t(0);
+    static auto     const EMPTY = tez::tile_category::empty;
+    static auto     const CEIL  = tez::tile_category::ceiling;
+    static auto     const WALL  = tez::tile_category::wall;
+
+    auto const w     = grid.width();
+    auto const h     = grid.height();
+    auto const words = (w + BITS - 1) / BITS;
+
+    std::vector<word_t> solid(words * h, 0);
+    std::vector<word_t> spread(words * h, 0);
+    std::vector<word_t> ceiling(words * h, 0);
 
-    auto const get_value = [](tez::tile_category* p) {
-        return p ? *p : EMPTY;
+    //--------------------------------------------------------------------------
+    // Tiles outside the grid (and the padding bits) count as empty.
+    //--------------------------------------------------------------------------
+    auto const empty_at = [&](unsigned const y, size_t const i) -> word_t {
+        return (i < words) ? ~solid[y*words + i] : ALL;
     };
-    
-    auto const ceiling_rule = [&](block_t& block) {
-        if (get_value(block.north()) == EMPTY) return true;
-        if (get_value(block.south()) == EMPTY) return true;
-        if (get_value(block.east())  == EMPTY) return true;
-        if (get_value(block.west())  == EMPTY) return true;
-
-        //all of nsew are not empty
-        if (get_value(block.north_west()) == EMPTY) return true;
-        if (get_value(block.north_east()) == EMPTY) return true;
-        if (get_value(block.south_west()) == EMPTY) return true;
-        if (get_value(block.south_east()) == EMPTY) return true;
 
-        return false;
+    auto const spread_at = [&](unsigned const y, size_t const i) -> word_t {
+        return (y < h) ? spread[y*words + i] : ALL;
     };
+    //--------------------------------------------------------------------------
+
+    for (unsigned y = 0; y < h; ++y) {
+        auto const* const tiles = &grid.at(0, y);
+        auto*       const row   = &solid[y*words];
+
+        for (unsigned x = 0; x < w; ++x) {
+            if (tiles[x] != EMPTY) row[x / BITS] |= word_t(1) << (x % BITS);
+        }
+    }
+
+    //horizontal dilation of the empty mask.
+    for (unsigned y = 0; y < h; ++y) {
+        for (size_t i = 0; i < words; ++i) {
+            auto const e = empty_at(y, i);
+            
+            spread[y*words + i] = e | (e << 1) | (e >> 1) |
+                (empty_at(y, i - 1) >> (BITS - 1)) |
+                (empty_at(y, i + 1) << (BITS - 1));
+        }
+    }
+
+    //vertical dilation, then classify and write back.
+    for (unsigned y = 0; y < h; ++y) {
+        auto* const tiles = &grid.at(0, y);
+
+        for (size_t i = 0; i < words; ++i) {
+            auto const near = spread_at(y - 1, i) | spread_at(y, i) |
+                              spread_at(y + 1, i);
+
+            auto const here  = solid[y*words + i];
+            auto const ceil  = here & near;
+            auto const above = (y > 0) ? ceiling[(y - 1)*words + i] : 0;
+            auto const wall  = here & ~near & above;
+
+            ceiling[y*words + i] = ceil;
 
-    for (auto& block : grid.block_iterator()) {
-        auto here = block.here();
-        if (!here || *here == EMPTY) continue;
+            if (!(ceil | wall)) continue;
 
-        if (ceiling_rule(block))                   *here = CEIL;
-        else if (get_value(block.north()) == CEIL) *here = WALL;
+            auto const first = static_cast<unsigned>(i * BITS);
+            auto const last  = bklib::min(first + BITS, w);
+
+            for (auto x = first; x < last; ++x) {
+                auto const bit = word_t(1) << (x - first);
+                if      (ceil & bit) tiles[x] = CEIL;
+                else if (wall & bit) tiles[x] = WALL;
+            }
+        }
     }
 }
 
@@ -203,7 +341,8 @@ void transform_grid(grid_t& grid) {
 
 tez::room
 tez::compound_room_generator::generate() {
-    auto const points_info = generate_points(points_, random_);
+    auto const points_info =
+        generate_points(points_, random_, tables_->cell_size(), cell_count_);
     
     auto grid = points_to_grid(points_,
         std::get<0>(points_info),
@@ -213,81 +352,520 @@ tez::compound_room_generator::generate() {
 
     transform_grid(grid);
 
-    return room(std::move(grid), find_connection_point);
+    return room(std::move(grid));
+}
+
+//==============================================================================
+tez::cave_room_generator::cave_room_generator(
+    random_t    random,
+    cave_params params
+)
+    : generator(random)
+    , params_(params)
+{
+    BK_ASSERT(params_.width  >= 3);
+    BK_ASSERT(params_.height >= 3);
+    BK_ASSERT(params_.fill_percent <= 100);
 }
 
-tez::compound_room_generator::connection_point
-tez::compound_room_generator::find_connection_point(
-    room      const& room,
-    direction const  side,
-    random_t         random
+//==============================================================================
+namespace {
+
+//==============================================================================
+//! Packed bits, a row of 64 bit words at a time. The padding bits past the
+//! width are kept set; outside the grid counts as solid.
+//==============================================================================
+class bit_grid {
+public:
+    typedef uint64_t word_t;
+
+    static unsigned const BITS = 64;
+    static word_t   const ALL  = ~word_t(0);
+
+    bit_grid(unsigned const w, unsigned const h)
+        : width_(w)
+        , height_(h)
+        , words_((w + BITS - 1) / BITS)
+        , data_(words_ * h, 0)
+    {
+        pad();
+    }
+
+    unsigned width()  const { return width_; }
+    unsigned height() const { return height_; }
+    size_t   words()  const { return words_; }
+
+    word_t*       row(unsigned const y)       { return &data_[y * words_]; }
+    word_t const* row(unsigned const y) const { return &data_[y * words_]; }
+
+    bool get(unsigned const x, unsigned const y) const {
+        return (row(y)[x / BITS] >> (x % BITS)) & 1;
+    }
+
+    void set(unsigned const x, unsigned const y) {
+        row(y)[x / BITS] |= word_t(1) << (x % BITS);
+    }
+
+    //--------------------------------------------------------------------------
+    //! The word @p i of row @p y; all set outside the grid.
+    //--------------------------------------------------------------------------
+    word_t word_at(unsigned const y, size_t const i) const {
+        return (y < height_ && i < words_) ? row(y)[i] : ALL;
+    }
+
+    void pad() {
+        auto const used = width_ % BITS;
+        if (!used) return;
+
+        auto const mask = ALL << used;
+        for (unsigned y = 0; y < height_; ++y) {
+            row(y)[words_ - 1] |= mask;
+        }
+    }
+
+    void swap(bit_grid& other) {
+        using std::swap;
+        swap(width_,  other.width_);
+        swap(height_, other.height_);
+        swap(words_,  other.words_);
+        swap(data_,   other.data_);
+    }
+private:
+    unsigned            width_;
+    unsigned            height_;
+    size_t              words_;
+    std::vector<word_t> data_;
+};
+
+//==============================================================================
+//! One step of the automaton over 64 tiles at a time: the eight neighbour
+//! masks are summed into four bit planes, then matched against the rules.
+//==============================================================================
+void cave_step(
+    bit_grid const& in,
+    bit_grid&       out,
+    uint16_t const  birth,
+    uint16_t const  survival
 ) {
-    static auto const TARGET = tile_category::ceiling;
+    typedef bit_grid::word_t word_t;
 
-    auto const search_dir = opposite_direction(side);
-    
-    auto const w = room.width()  - 1;
-    auto const h = room.height() - 1;
+    static unsigned const BITS      = bit_grid::BITS;
+    static unsigned const MAX_COUNT = 8;
+
+    auto const h     = in.height();
+    auto const words = in.words();
 
-    unsigned x = (search_dir == direction::west) ? w :
-                 (search_dir == direction::east) ? 0 :
-                  std::uniform_int_distribution<>(0, w)(random);
+    //--------------------------------------------------------------------------
+    // Add a one bit mask to the bit planes, with ripple carry.
+    //--------------------------------------------------------------------------
+    auto const add = [](word_t (&planes)[4], word_t carry) {
+        for (auto& p : planes) {
+            auto const next = p & carry;
+            p    ^= carry;
+            carry = next;
+        }
+    };
+    //--------------------------------------------------------------------------
 
-    unsigned y = (search_dir == direction::north) ? h :
-                 (search_dir == direction::south) ? 0 :
-                  std::uniform_int_distribution<>(0, h)(random);
+    for (unsigned y = 0; y < h; ++y) {
+        auto* const dest = out.row(y);
 
-    auto const is_ns =
-        (search_dir == direction::north || search_dir == direction::south);
+        for (size_t i = 0; i < words; ++i) {
+            word_t planes[4] = {0, 0, 0, 0};
 
-    auto&      primary        = is_ns ? y : x;
-    auto&      secondary      = is_ns ? x : y;
-    auto const primary_size   = is_ns ? room.height() : room.width();
-    auto const secondary_size = is_ns ? room.width()  : room.height();
-    
-    auto const delta = is_ns ? direction_vector(search_dir).second :
-                               direction_vector(search_dir).first;
+            for (unsigned r = 0; r < 3; ++r) {
+                auto const ry = y + r - 1; //wraps to outside for y = 0.
+
+                auto const c = in.word_at(ry, i);
+                auto const w = (c << 1) | (in.word_at(ry, i - 1) >> (BITS - 1));
+                auto const e = (c >> 1) | (in.word_at(ry, i + 1) << (BITS - 1));
+
+                add(planes, w);
+                add(planes, e);
+                if (r != 1) add(planes, c);
+            }
+
+            word_t born = 0;
+            word_t kept = 0;
+
+            for (unsigned k = 0; k <= MAX_COUNT; ++k) {
+                if (!(((birth | survival) >> k) & 1)) continue;
+
+                auto is_k = bit_grid::ALL;
+                for (unsigned p = 0; p < 4; ++p) {
+                    is_k &= ((k >> p) & 1) ? planes[p] : ~planes[p];
+                }
+
+                if ((birth    >> k) & 1) born |= is_k;
+                if ((survival >> k) & 1) kept |= is_k;
+            }
+
+            auto const here = in.row(y)[i];
+            dest[i] = (here & kept) | (~here & born);
+        }
+    }
+
+    out.pad();
+}
+
+//==============================================================================
+//! A horizontal run [x0, x1) of open tiles on row y.
+//==============================================================================
+struct open_run {
+    unsigned y;
+    unsigned x0;
+    unsigned x1;
+};
+
+//==============================================================================
+//! The runs of the largest 4-connected open area, in row order. Runs that
+//! overlap on adjacent rows are joined with a union-find.
+//==============================================================================
+std::vector<open_run> largest_open_area(bit_grid const& solid) {
+    auto const w = solid.width();
+    auto const h = solid.height();
+
+    std::vector<open_run> runs;
+    std::vector<uint32_t> parent;
 
     //--------------------------------------------------------------------------
-    auto const is_in_bounds = [&] {
-        return (delta > 0 && primary < primary_size) ||
-               (delta < 0 && primary > 0);
+    auto const find = [&](uint32_t i) {
+        while (parent[i] != i) {
+            i = parent[i] = parent[parent[i]];
+        }
+        return i;
     };
     //--------------------------------------------------------------------------
-    auto const is_valid_pos = [&] {
-        BK_ASSERT(x <= w && y <= h);
-        
-        if (room.at(x, y) != TARGET) {
-            return false;
+
+    size_t prev_first = 0;
+    size_t prev_last  = 0;
+
+    for (unsigned y = 0; y < h; ++y) {
+        auto const first = runs.size();
+
+        for (unsigned x = 0; x < w;) {
+            if (solid.get(x, y)) { ++x; continue; }
+
+            auto const x0 = x;
+            while (x < w && !solid.get(x, y)) ++x;
+
+            open_run const run = {y, x0, x};
+            runs.push_back(run);
+            parent.push_back(static_cast<uint32_t>(parent.size()));
         }
 
-        primary += delta;
-        BK_ON_SCOPE_EXIT({ primary -= delta; });
-        
-        auto const is_floor = [&](tile_category const c) {
-            return c == tile_category::floor;
-        };
-        auto const is_wall = [&](tile_category const c) {
-            return c == tile_category::wall && search_dir == direction::south;
-        };
-
-        auto const c = room.at(x, y);
-        return is_floor(c) || is_wall(c);
+        //both rows are sorted by x; join the overlapping pairs.
+        auto p = prev_first;
+
+        for (auto i = first; i < runs.size(); ++i) {
+            while (p < prev_last && runs[p].x1 <= runs[i].x0) ++p;
+
+            for (auto q = p; q < prev_last && runs[q].x0 < runs[i].x1; ++q) {
+                parent[find(static_cast<uint32_t>(i))] =
+                    find(static_cast<uint32_t>(q));
+            }
+        }
+
+        prev_first = first;
+        prev_last  = runs.size();
+    }
+
+    std::vector<unsigned> sizes(runs.size(), 0);
+    uint32_t best = 0;
+
+    for (uint32_t i = 0; i < runs.size(); ++i) {
+        auto const root = find(i);
+        sizes[root] += runs[i].x1 - runs[i].x0;
+        if (sizes[root] > sizes[best]) best = root;
+    }
+
+    std::vector<open_run> result;
+    for (uint32_t i = 0; i < runs.size(); ++i) {
+        if (find(i) == best) result.push_back(runs[i]);
+    }
+
+    return result;
+}
+
+typedef tez::room::connection_list  point_list_t;
+typedef tez::room::connection_point connection_t;
+
+template <typename F>
+void keep_if(point_list_t& points, F predicate) {
+    points.erase(
+        std::remove_if(points.begin(), points.end(), [&](connection_t const p) {
+            return !predicate(p);
+        }),
+        points.end()
+    );
+}
+
+//==============================================================================
+//! Scan, then keep only the points with nothing between them and the edge of
+//! the grid on their side; others face into an enclosed pillar of rock.
+//==============================================================================
+void cave_connections(
+    grid_t const& grid,
+    point_list_t (&out)[tez::NUM_CARDINAL_DIR]
+) {
+    static auto const EMPTY = tez::tile_category::empty;
+
+    tez::room::scan_connections(grid, out);
+
+    auto const w = grid.width();
+    auto const h = grid.height();
+
+    //the first and last non empty tile of each column and row.
+    std::vector<unsigned> top(w, h), bottom(w, 0), left(h, w), right(h, 0);
+
+    for (unsigned y = 0; y < h; ++y) {
+        auto const* const row = &grid.at(0, y);
+
+        for (unsigned x = 0; x < w; ++x) {
+            if (row[x] == EMPTY) continue;
+
+            top[x]    = bklib::min(top[x], y);
+            bottom[x] = bklib::max(bottom[x], y);
+            left[y]   = bklib::min(left[y], x);
+            right[y]  = bklib::max(right[y], x);
+        }
+    }
+
+    //--------------------------------------------------------------------------
+    auto const side = [&](tez::direction const d) -> point_list_t& {
+        return out[static_cast<unsigned>(d)];
     };
     //--------------------------------------------------------------------------
 
-    //scan along the primary direction
-    while (is_in_bounds() && (room.at(x, y) != TARGET)) {
-        primary += delta;
+    keep_if(side(tez::direction::north), [&](connection_t const p) {
+        return p.y == top[p.x];
+    });
+    keep_if(side(tez::direction::south), [&](connection_t const p) {
+        return p.y == bottom[p.x];
+    });
+    keep_if(side(tez::direction::east), [&](connection_t const p) {
+        return p.x == right[p.y];
+    });
+    keep_if(side(tez::direction::west), [&](connection_t const p) {
+        return p.x == left[p.y];
+    });
+}
+
+} //namespace
+
+tez::detail::cave_cells tez::detail::cave_step(
+    cave_cells const& solid,
+    uint16_t   const  birth,
+    uint16_t   const  survival
+) {
+    auto const w = solid.width();
+    auto const h = solid.height();
+
+    bit_grid in(w, h);
+    bit_grid out(w, h);
+
+    for (unsigned y = 0; y < h; ++y) {
+        for (unsigned x = 0; x < w; ++x) {
+            if (solid.at(x, y)) in.set(x, y);
+        }
+    }
+
+    ::cave_step(in, out, birth, survival);
+
+    cave_cells result(w, h, 0);
+
+    for (unsigned y = 0; y < h; ++y) {
+        for (unsigned x = 0; x < w; ++x) {
+            result.at(x, y) = out.get(x, y) ? 1 : 0;
+        }
+    }
+
+    return result;
+}
+
+tez::room
+tez::cave_room_generator::generate() {
+    static auto const EMPTY = tile_category::empty;
+    static auto const FLOOR = tile_category::floor;
+    static auto const CEIL  = tile_category::ceiling;
+    static auto const WALL  = tile_category::wall;
+
+    auto const w = params_.width;
+    auto const h = params_.height;
+
+    //--------------------------------------------------------------------------
+    // Random fill, four 16 bit rolls to a hash; the edge is always solid, so
+    // the kept area never reaches it and there is room for the ceiling.
+    //--------------------------------------------------------------------------
+    static unsigned const ROLLS = 4;
+
+    auto const noise = bklib::hash_random(random_());
+
+    bit_grid solid(w, h);
+    bit_grid next(w, h);
+
+    for (unsigned y = 0; y < h; ++y) {
+        for (unsigned x = 0; x < w; x += ROLLS) {
+            auto bits = noise(
+                static_cast<signed>(x / ROLLS), static_cast<signed>(y),
+                random_purpose::cave
+            );
+
+            for (auto i = x; i < bklib::min(x + ROLLS, w); ++i, bits >>= 16) {
+                auto const roll = ((bits & 0xFFFF) * 100) >> 16;
+                if (roll < params_.fill_percent) solid.set(i, y);
+            }
+        }
+    }
+
+    for (unsigned i = 0; i < params_.steps; ++i) {
+        cave_step(solid, next, params_.birth, params_.survival);
+        solid.swap(next);
+    }
+
+    //set after smoothing, which may otherwise open the edge again.
+    for (unsigned x = 0; x < w; ++x) {
+        solid.set(x, 0);
+        solid.set(x, h - 1);
+    }
+
+    for (unsigned y = 0; y < h; ++y) {
+        solid.set(0, y);
+        solid.set(w - 1, y);
+    }
+
+    //--------------------------------------------------------------------------
+    // Crop to the largest open area plus a tile of rock around it.
+    //--------------------------------------------------------------------------
+    auto area = largest_open_area(solid);
+    if (area.empty()) {
+        open_run const middle = {h / 2, w / 2, w / 2 + 1}; //all rock.
+        area.push_back(middle);
+    }
+
+    bklib::min_max<unsigned> range_x;
+
+    for (auto const& run : area) {
+        range_x(run.x0);
+        range_x(run.x1 - 1);
+    }
+
+    auto const x0 = range_x.min - 1;
+    auto const y0 = area.front().y - 1;
+    auto const rh = area.back().y - area.front().y + 3;
+
+    grid_t result(range_x.distance() + 3, rh, EMPTY);
+
+    //--------------------------------------------------------------------------
+    // Rock next to (or diagonal to) floor becomes ceiling; floor directly
+    // south of a ceiling becomes wall.
+    //--------------------------------------------------------------------------
+    for (auto const& run : area) {
+        auto const y   = run.y - y0;
+        auto const beg = run.x0 - x0;
+        auto const end = run.x1 - x0;
+
+        std::fill_n(&result.at(beg, y), end - beg, FLOOR);
+
+        for (auto ry = y - 1; ry <= y + 1; ++ry) {
+            auto* const row = &result.at(0, ry);
+            for (auto x = beg - 1; x <= end; ++x) {
+                if (row[x] == EMPTY) row[x] = CEIL;
+            }
+        }
+    }
+
+    for (auto const& run : area) {
+        auto const y = run.y - y0;
+
+        auto*       const row   = &result.at(0, y);
+        auto const* const above = &result.at(0, y - 1);
+
+        for (auto x = run.x0 - x0; x < run.x1 - x0; ++x) {
+            if (above[x] == CEIL) row[x] = WALL;
+        }
     }
-    BK_ASSERT(room.at(x, y) == TARGET);
-                
-    //scan along the secondary direction
-    while (!is_valid_pos()) {
-        secondary = (secondary + 1) % secondary_size;
+
+    return room(std::move(result), cave_connections);
+}
+
+//==============================================================================
+tez::wfc_room_generator::wfc_room_generator(
+    random_t      random,
+    grid_t const& sample,
+    wfc_params    params
+)
+    : generator(random)
+    , params_(params)
+    , sample_(std::make_shared<grid_t const>(sample.clone()))
+    , model_(sample, params.pattern_size)
+{
+    BK_ASSERT(params_.width  >= params_.pattern_size);
+    BK_ASSERT(params_.height >= params_.pattern_size);
+    BK_ASSERT(params_.max_attempts > 0);
+}
+
+tez::room
+tez::wfc_room_generator::generate() {
+    static auto const EMPTY = tile_category::empty;
+
+    auto const n = model_.size();
+
+    //--------------------------------------------------------------------------
+    // Whether the tiles of pattern p on its side d are all empty.
+    //--------------------------------------------------------------------------
+    auto const empty_side = [&](unsigned const p, direction const d) {
+        for (unsigned i = 0; i < n; ++i) {
+            tile_category t;
+
+            switch (d) {
+            case direction::north : t = model_.tile(p, i, 0);     break;
+            case direction::south : t = model_.tile(p, i, n - 1); break;
+            case direction::east  : t = model_.tile(p, n - 1, i); break;
+            default               : t = model_.tile(p, 0, i);     break;
+            }
+
+            if (t != EMPTY) return false;
+        }
+
+        return true;
+    };
+    //--------------------------------------------------------------------------
+
+    for (unsigned attempt = 0; attempt < params_.max_attempts; ++attempt) {
+        wfc_solver solver(model_, params_.width, params_.height);
+
+        auto const cols = solver.cell_width();
+        auto const rows = solver.cell_height();
+
+        bool ok = true;
+
+        if (params_.empty_border) {
+            for (unsigned x = 0; ok && x < cols; ++x) {
+                ok = solver.constrain(x, 0, [&](unsigned const p) {
+                    return empty_side(p, direction::north);
+                }) && solver.constrain(x, rows - 1, [&](unsigned const p) {
+                    return empty_side(p, direction::south);
+                });
+            }
+
+            for (unsigned y = 0; ok && y < rows; ++y) {
+                ok = solver.constrain(0, y, [&](unsigned const p) {
+                    return empty_side(p, direction::west);
+                }) && solver.constrain(cols - 1, y, [&](unsigned const p) {
+                    return empty_side(p, direction::east);
+                });
+            }
+
+            //the sample has no such patterns; no use trying again.
+            if (!ok) break;
+        }
+
+        if (solver.run(random_)) {
+            return room(solver.result());
+        }
     }
-    BK_ASSERT(room.at(x, y) == TARGET);
 
-    return connection_point(x + room.left(), y + room.top());
+    return room(sample_);
 }
 
@@ -1,28 +1,65 @@
 #pragma once
 
 #include "bklib/util.hpp"
+#include "bklib/random.hpp"
 #include "bklib/geometry.hpp"
 
 #include "tile_category.hpp"
 #include "room.hpp"
+#include "room_prefab.hpp"
+#include "wfc.hpp"
+#include "generation_params.hpp"
 
 #include <vector>
 
 namespace tez {
 
+//==============================================================================
+//! Purposes for bklib::hash_random; decisions of different kinds made at the
+//! same position must not share values.
+//==============================================================================
+namespace random_purpose {
+    static uint32_t const room       = 1;
+    static uint32_t const cave       = 2;
+    static uint32_t const bsp        = 3; //!< Plus the depth; see bsp_layout.
+    static uint32_t const decoration = 4;
+}
+
 class generator {
 public:
-    typedef bklib::random_wrapper<> random_t;
+    typedef bklib::random_engine    random_t;
     typedef grid2d<tile_category>   grid_t;
     typedef room::connection_point  connection_point;
 
-    generator(random_t random) : random_(random) {}
+    //--------------------------------------------------------------------------
+    //! Takes the current generation_params; a later reload does not affect
+    //! this generator.
+    //--------------------------------------------------------------------------
+    generator(random_t random)
+        : random_(random)
+        , tables_(current_generation_params())
+    {
+    }
+
+    //--------------------------------------------------------------------------
+    //! Key the next room to (@p x, @p y) of @p random, so that it is the same
+    //! no matter which rooms were generated before it.
+    //--------------------------------------------------------------------------
+    void seed_at(bklib::hash_random const& random, signed x, signed y) {
+        random_ = random.engine_at(x, y, random_purpose::room);
+    }
+
+    generation_params const& tables() const { return *tables_; }
 protected:
-    random_t random_;
+    random_t                 random_;
+    shared_generation_params tables_;
 };
 
 //==============================================================================
 //! Generate a simple rectangular room.
+//!
+//! A room is determined by its size, so each size is rasterised once and
+//! shared by every room of that size.
 //==============================================================================
 class simple_room_generator : public generator {
 public:
@@ -30,9 +67,20 @@ public:
 
     room generate();
 
-    static connection_point find_connection_point(
-        room const& room, direction side, random_t random
-    );
+    //--------------------------------------------------------------------------
+    //! The tiles of a @p w x @p h simple room: a ceiling border with a wall
+    //! row under the top edge. @pre w >= 3 and h >= 4.
+    //--------------------------------------------------------------------------
+    static grid_t rasterise(unsigned w, unsigned h);
+
+    //--------------------------------------------------------------------------
+    //! A @p w x @p h simple room sharing its grid through @p prefabs.
+    //--------------------------------------------------------------------------
+    static room make(prefab_cache& prefabs, unsigned w, unsigned h);
+
+    prefab_cache const& prefabs() const { return prefabs_; }
+private:
+    prefab_cache prefabs_;
 };
 
 //==============================================================================
@@ -40,16 +88,128 @@ public:
 //==============================================================================
 class compound_room_generator : public generator {
 public:
-    compound_room_generator(random_t random);
+    //--------------------------------------------------------------------------
+    //! The number of cells to walk is from generation_params::cell_count.
+    //--------------------------------------------------------------------------
+    explicit compound_room_generator(random_t random);
 
-    room generate();
-
-    static connection_point find_connection_point(
-        room const& room, direction side, random_t random
+    //--------------------------------------------------------------------------
+    //! @param count_min, count_max the range of the number of cells to walk.
+    //--------------------------------------------------------------------------
+    compound_room_generator(
+        random_t random,
+        unsigned count_min,
+        unsigned count_max
     );
+
+    room generate();
 private:    
-    typedef bklib::point2d<signed> point_t;
+    typedef bklib::point2d<signed>            point_t;
+    typedef generation_params::distribution_t distribution_t;
+
     std::vector<point_t> points_; //list of occupied points
+
+    distribution_t cell_count_;
+};
+
+//==============================================================================
+//! Parameters for cave_room_generator.
+//!
+//! Rules are masks over the number (0 to 8) of solid neighbours: an open tile
+//! with k solid neighbours turns solid if bit k of @c birth is set; a solid
+//! tile stays solid if bit k of @c survival is set. Tiles outside count as
+//! solid.
+//==============================================================================
+struct cave_params {
+    cave_params()
+        : width(40)
+        , height(30)
+        , fill_percent(45)
+        , steps(4)
+        , birth(0x1E0)    //5 to 8
+        , survival(0x1F0) //4 to 8
+    {
+    }
+
+    unsigned width;        //!< Of the area before cropping; at least 3.
+    unsigned height;       //!< Of the area before cropping; at least 3.
+    unsigned fill_percent; //!< Chance that a tile starts solid.
+    unsigned steps;        //!< Smoothing steps.
+    uint16_t birth;
+    uint16_t survival;
+};
+
+//==============================================================================
+//! Generate an organic cave: random fill, smoothed by a cellular automaton,
+//! keeping only the largest open area.
+//!
+//! Rooms are of room_kind::custom; corridors only leave from ceiling tiles
+//! that can see out of the room, never toward an enclosed pillar.
+//==============================================================================
+class cave_room_generator : public generator {
+public:
+    cave_room_generator(random_t random, cave_params params = cave_params());
+
+    room generate();
+
+    cave_params const& params() const { return params_; }
+private:
+    cave_params params_;
+};
+
+namespace detail {
+    //! 1 for solid, 0 for open.
+    typedef grid2d<uint8_t> cave_cells;
+
+    //--------------------------------------------------------------------------
+    //! One smoothing step of cave_room_generator, run on @p solid through the
+    //! packed rows it uses; outside the grid counts as solid.
+    //--------------------------------------------------------------------------
+    cave_cells cave_step(
+        cave_cells const& solid, uint16_t birth, uint16_t survival
+    );
+}
+
+//==============================================================================
+//! Parameters for wfc_room_generator.
+//==============================================================================
+struct wfc_params {
+    wfc_params()
+        : width(24)
+        , height(24)
+        , pattern_size(3)
+        , empty_border(true)
+        , max_attempts(4)
+    {
+    }
+
+    unsigned width;        //!< Of the room; at least pattern_size.
+    unsigned height;       //!< Of the room; at least pattern_size.
+    unsigned pattern_size; //!< n of the n x n patterns taken from the sample.
+    bool     empty_border; //!< Only patterns with empty outer tiles on edges.
+    unsigned max_attempts; //!< Solver runs before falling back to the sample.
+};
+
+//==============================================================================
+//! Generate a room like a sample by wave function collapse.
+//!
+//! Should the solver fail max_attempts times, the room is the sample itself.
+//==============================================================================
+class wfc_room_generator : public generator {
+public:
+    wfc_room_generator(
+        random_t      random,
+        grid_t const& sample,
+        wfc_params    params = wfc_params()
+    );
+
+    room generate();
+
+    wfc_model const& model() const { return model_; }
+private:
+    wfc_params        params_;
+    room::shared_grid sample_;
+    wfc_model         model_;
 };
 
 
@@ -0,0 +1,67 @@
+#include "pch.hpp"
+#include "room_prefab.hpp"
+
+tez::prefab_cache::key_t
+tez::prefab_cache::shape_hash(grid_t const& grid) {
+    auto const w = grid.width();
+    auto const h = grid.height();
+
+    auto result = bklib::mix64((static_cast<uint64_t>(w) << 32) | h);
+
+    for (unsigned y = 0; y < h; ++y) {
+        auto const* const row = &grid.at(0, y);
+
+        uint64_t word  = 0;
+        unsigned shift = 0;
+
+        for (unsigned x = 0; x < w; ++x) {
+            word |= static_cast<uint64_t>(row[x]) << shift;
+
+            if ((shift += 8) == 64) {
+                result = bklib::mix64(result ^ word);
+                word   = 0;
+                shift  = 0;
+            }
+        }
+
+        result = bklib::mix64(result ^ word ^ y);
+    }
+
+    return result;
+}
+
+tez::prefab_cache::shared_grid
+tez::prefab_cache::intern(grid_t grid) {
+    auto const key   = shape_hash(grid);
+    auto const range = shapes_.equal_range(key);
+
+    auto const w = grid.width();
+    auto const h = grid.height();
+
+    //--------------------------------------------------------------------------
+    auto const same_tiles = [&](grid_t const& other) {
+        if (other.width() != w || other.height() != h) return false;
+
+        for (unsigned y = 0; y < h; ++y) {
+            auto const* const row = &grid.at(0, y);
+            if (!std::equal(row, row + w, &other.at(0, y))) return false;
+        }
+
+        return true;
+    };
+    //--------------------------------------------------------------------------
+
+    for (auto it = range.first; it != range.second; ++it) {
+        if (same_tiles(*it->second)) {
+            hits_++;
+            return it->second;
+        }
+    }
+
+    misses_++;
+
+    auto result = std::make_shared<grid_t const>(std::move(grid));
+    shapes_.emplace(key, result);
+
+    return result;
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include "bklib/util.hpp"
+#include "bklib/random.hpp"
+
+#include "room.hpp"
+
+#include <unordered_map>
+#include <cstdint>
+
+namespace tez {
+
+//==============================================================================
+//! Deduplicating store of room grids. Equal grids are kept once and shared,
+//! immutably, by every room made from them; a room places its instance with
+//! its own bounds.
+//==============================================================================
+class prefab_cache {
+public:
+    typedef room::grid_t      grid_t;
+    typedef room::shared_grid shared_grid;
+    typedef uint64_t          key_t;
+
+    prefab_cache() : hits_(0), misses_(0) {}
+
+    //--------------------------------------------------------------------------
+    //! Hash of the size and tiles of @p grid.
+    //--------------------------------------------------------------------------
+    static key_t shape_hash(grid_t const& grid);
+
+    //--------------------------------------------------------------------------
+    //! The stored grid equal to @p grid; @p grid itself if there is none yet.
+    //--------------------------------------------------------------------------
+    shared_grid intern(grid_t grid);
+
+    //--------------------------------------------------------------------------
+    //! The grid previously made for @p key; otherwise intern the result of
+    //! make(). @p key is chosen by the caller and must determine the grid, so
+    //! a hit skips rasterising altogether.
+    //--------------------------------------------------------------------------
+    template <typename F>
+    shared_grid find_or_make(key_t const key, F make) {
+        auto const it = made_.find(key);
+
+        if (it != made_.end()) {
+            hits_++;
+            return it->second;
+        }
+
+        auto result = intern(make());
+        made_.emplace(key, result);
+
+        return result;
+    }
+
+    //! Distinct grids stored.
+    size_t size() const { return shapes_.size(); }
+
+    //! Lookups answered from the store.
+    unsigned hits() const { return hits_; }
+
+    //! Lookups that stored a new grid.
+    unsigned misses() const { return misses_; }
+
+    //! Empty the store and reset hits() and misses().
+    void clear() {
+        shapes_.clear();
+        made_.clear();
+        hits_   = 0;
+        misses_ = 0;
+    }
+private:
+    std::unordered_multimap<key_t, shared_grid> shapes_; //!< By shape_hash.
+    std::unordered_map<key_t, shared_grid>      made_;   //!< By caller's key.
+
+    unsigned hits_;
+    unsigned misses_;
+};
+
+} //namespace tez
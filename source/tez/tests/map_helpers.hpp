@@ -0,0 +1,33 @@
+#pragma once
+
+#include "tez/map.hpp"
+#include "tez/map_batch.hpp"
+
+//==============================================================================
+// Helpers shared by the map tests.
+//==============================================================================
+namespace tez {
+namespace test {
+
+//! Whether @p a and @p b are the same size with the same tile types.
+inline bool same_tiles(map const& a, map const& b) {
+    if (a.width() != b.width() || a.height() != b.height()) {
+        return false;
+    }
+
+    for (unsigned y = 0; y < a.height(); ++y) {
+        for (unsigned x = 0; x < a.width(); ++x) {
+            if (a.at(x, y).type != b.at(x, y).type) return false;
+        }
+    }
+
+    return true;
+}
+
+//! The map generate_map makes from @p seed with the default map_params.
+inline map make_map(uint64_t const seed) {
+    return std::move(generate_map(seed, map_params()).result);
+}
+
+} //namespace test
+} //namespace tez
@@ -0,0 +1,137 @@
+#include "pch.hpp"
+#include "tez/bsp_layout.hpp"
+#include "tez/map.hpp"
+#include "tez/map_layout.hpp"
+#include "bklib/thread_pool.hpp"
+
+#include <gtest/gtest.h>
+
+namespace {
+
+tez::bsp_params large_params() {
+    tez::bsp_params params;
+    params.width  = 512;
+    params.height = 384;
+    params.min_size = 6;
+
+    return params;
+}
+
+bool same_nodes(tez::bsp_node const& a, tez::bsp_node const& b) {
+    return a.x == b.x && a.y == b.y && a.w == b.w && a.h == b.h
+        && a.first == b.first && a.second == b.second;
+}
+
+} //namespace
+
+TEST(BspLayout, LeavesTileTheArea) {
+    auto const params = large_params();
+
+    tez::bsp_layout layout(bklib::random_engine(7), params);
+    layout.generate();
+
+    ASSERT_GT(layout.leaf_count(), 64u);
+    EXPECT_EQ(2 * layout.leaf_count() - 1, layout.nodes().size());
+
+    std::vector<unsigned> cover(params.width * params.height, 0);
+    unsigned leaves = 0;
+
+    layout.for_each_leaf([&](tez::bsp_node const& leaf) {
+        EXPECT_GE(leaf.w, params.min_size);
+        EXPECT_GE(leaf.h, params.min_size);
+
+        for (unsigned y = leaf.y; y < leaf.y + leaf.h; ++y) {
+            for (unsigned x = leaf.x; x < leaf.x + leaf.w; ++x) {
+                cover[y * params.width + x]++;
+            }
+        }
+
+        leaves++;
+    });
+
+    EXPECT_EQ(layout.leaf_count(), leaves);
+    EXPECT_TRUE(std::all_of(cover.begin(), cover.end(), [](unsigned n) {
+        return n == 1;
+    }));
+}
+
+TEST(BspLayout, IndependentOfThreadCount) {
+    auto const params = large_params();
+
+    tez::bsp_layout serial(bklib::random_engine(11), params);
+    tez::bsp_layout parallel(bklib::random_engine(11), params);
+
+    bklib::thread_pool pool(4);
+
+    serial.generate();
+    parallel.generate(&pool);
+
+    auto const& a = serial.nodes();
+    auto const& b = parallel.nodes();
+
+    ASSERT_EQ(a.size(), b.size());
+    EXPECT_TRUE(std::equal(a.begin(), a.end(), b.begin(), same_nodes));
+
+    //regenerating reuses the arena and gives the same tree.
+    auto const data = parallel.nodes().data();
+    parallel.generate(&pool);
+
+    EXPECT_EQ(data, parallel.nodes().data());
+    EXPECT_TRUE(std::equal(a.begin(), a.end(), b.begin(), same_nodes));
+}
+
+TEST(BspLayout, SeedsDiffer) {
+    auto const params = large_params();
+
+    tez::bsp_layout a(bklib::random_engine(1), params);
+    tez::bsp_layout b(bklib::random_engine(2), params);
+
+    a.generate();
+    b.generate();
+
+    auto const& na = a.nodes();
+    auto const& nb = b.nodes();
+
+    EXPECT_FALSE(na.size() == nb.size() &&
+        std::equal(na.begin(), na.end(), nb.begin(), same_nodes));
+}
+
+TEST(BspLayout, MakeMap) {
+    tez::bsp_layout layout(bklib::random_engine(3));
+    layout.generate();
+
+    auto const m = layout.make_map();
+
+    EXPECT_EQ(layout.params().width,  m.width());
+    EXPECT_EQ(layout.params().height, m.height());
+    EXPECT_EQ(layout.leaf_count(), m.room_count());
+
+    //rooms of the same size share their tiles.
+    EXPECT_LE(layout.prefabs().size(), layout.leaf_count());
+
+    //the gap to the east and south of each room is left empty.
+    layout.for_each_leaf([&](tez::bsp_node const& leaf) {
+        auto const x = leaf.x + leaf.w - 1;
+        auto const y = leaf.y + leaf.h - 1;
+
+        EXPECT_EQ(tez::map::NO_ROOM, m.room_at(x, leaf.y));
+        EXPECT_EQ(tez::map::NO_ROOM, m.room_at(leaf.x, y));
+        EXPECT_NE(tez::map::NO_ROOM, m.room_at(leaf.x, leaf.y));
+    });
+}
+
+TEST(BspLayout, AddToLayout) {
+    tez::bsp_layout layout(bklib::random_engine(5));
+    layout.generate();
+
+    tez::map_layout rooms(bklib::random_engine(5));
+    EXPECT_EQ(layout.leaf_count(), layout.add_to(rooms));
+
+    //already placed rooms are refused.
+    auto again = layout.make_rooms();
+    EXPECT_FALSE(rooms.place_room(std::move(again.front())));
+    EXPECT_EQ(1u, rooms.status().rooms_dropped);
+
+    auto const m = rooms.make_map();
+    EXPECT_EQ(layout.leaf_count(), m.room_count());
+}
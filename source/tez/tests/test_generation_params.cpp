@@ -0,0 +1,188 @@
+#include "pch.hpp"
+#include "tez/generation_params.hpp"
+#include "tez/room_generator.hpp"
+
+#include <gtest/gtest.h>
+
+#include <sstream>
+#include <fstream>
+
+namespace {
+
+tez::generation_source parse(char const* json) {
+    std::istringstream in(json);
+    return tez::parse_generation_source(in);
+}
+
+//==============================================================================
+//! Restores the built in block when it goes out of scope.
+//==============================================================================
+struct restore_params {
+    ~restore_params() {
+        tez::set_generation_params(
+            std::make_shared<tez::generation_params const>()
+        );
+    }
+};
+
+} //namespace
+
+TEST(GenerationParams, ParseDef) {
+    auto const source = parse(
+        "{\n"
+        "  \"simple_room\": {\n"
+        "    \"width\":  {\"uniform\": [5, 7]},\n"
+        "    \"height\": {\"uniform\": [6, 9]}\n"
+        "  },\n"
+        "  \"compound_room\": {\n"
+        "    \"cell_size\":  {\"uniform\": [2, 3]},\n"
+        "    \"cell_count\": {\"uniform\": [4, 4]}\n"
+        "  },\n"
+        "  \"regular_corridor\": {\n"
+        "    \"primary\": 100, \"secondary\": 10, \"tertiary\": 5\n"
+        "  }\n"
+        "}\n"
+    );
+
+    EXPECT_EQ(5u, source.simple_width.min);
+    EXPECT_EQ(7u, source.simple_width.max);
+    EXPECT_EQ(6u, source.simple_height.min);
+    EXPECT_EQ(9u, source.simple_height.max);
+    EXPECT_EQ(2u, source.cell_size.min);
+    EXPECT_EQ(3u, source.cell_size.max);
+    EXPECT_EQ(4u, source.cell_count.min);
+    EXPECT_EQ(4u, source.cell_count.max);
+
+    EXPECT_EQ(100u, source.regular_corridor.primary);
+    EXPECT_EQ(10u,  source.regular_corridor.secondary);
+    EXPECT_EQ(5u,   source.regular_corridor.tertiary);
+}
+
+TEST(GenerationParams, MissingKeepsDefaults) {
+    auto const source   = parse("{\"simple_room\": {}}");
+    auto const defaults = tez::generation_source();
+
+    EXPECT_EQ(defaults.simple_width.min,  source.simple_width.min);
+    EXPECT_EQ(defaults.simple_height.max, source.simple_height.max);
+    EXPECT_EQ(defaults.cell_count.max,    source.cell_count.max);
+    EXPECT_EQ(defaults.regular_corridor.primary,
+              source.regular_corridor.primary);
+}
+
+TEST(GenerationParams, Rejects) {
+    EXPECT_THROW(parse("{"), tez::bad_generation_params);
+    EXPECT_THROW(
+        parse("{\"simple_room\": {\"width\": {\"uniform\": [3]}}}"),
+        tez::bad_generation_params
+    );
+    EXPECT_THROW(
+        parse("{\"simple_room\": {\"width\": {\"uniform\": [-1, 3]}}}"),
+        tez::bad_generation_params
+    );
+    EXPECT_THROW(
+        parse("{\"regular_corridor\": {\"primary\": \"many\"}}"),
+        tez::bad_generation_params
+    );
+
+    //parses, but simple rooms must be at least 3 x 4.
+    auto source = parse(
+        "{\"simple_room\": {\"height\": {\"uniform\": [3, 8]}}}"
+    );
+    EXPECT_THROW(tez::generation_params p(source), tez::bad_generation_params);
+
+    source = tez::generation_source();
+    source.cell_count.min = 9;
+    source.cell_count.max = 8;
+    EXPECT_THROW(tez::generation_params p(source), tez::bad_generation_params);
+
+    source = tez::generation_source();
+    tez::generation_source::corridor_weights const none = {0, 0, 0};
+    source.regular_corridor = none;
+    EXPECT_THROW(tez::generation_params p(source), tez::bad_generation_params);
+
+    EXPECT_THROW(
+        tez::load_generation_params("no/such/generation.def"),
+        tez::bad_generation_params
+    );
+}
+
+//run from the root of the tree, as the game is.
+TEST(GenerationParams, DataFile) {
+    static char const FILENAME[] = "data/generation.def";
+
+    EXPECT_NO_THROW(tez::load_generation_params(FILENAME));
+
+    std::ifstream in(FILENAME);
+    auto const source = tez::parse_generation_source(in);
+
+    EXPECT_EQ(3U, source.simple_width.min);
+    EXPECT_EQ(8U, source.simple_width.max);
+    EXPECT_EQ(100U, source.regular_corridor.primary);
+}
+
+TEST(GenerationParams, CorridorTables) {
+    auto const source = tez::generation_source();
+    tez::generation_params const params(source);
+
+    //every direction, from every column, in proportion to its weight.
+    for (unsigned d = 0; d < tez::NUM_CARDINAL_DIR; ++d) {
+        typedef tez::generation_params::path_table_t table_t;
+
+        auto const  dir   = static_cast<tez::direction>(d);
+        auto const& table = params.path_table(dir);
+
+        unsigned counts[tez::NUM_CARDINAL_DIR] = {0};
+        auto const samples = 1u << table_t::SAMPLE_BITS;
+
+        for (unsigned bits = 0; bits < samples; ++bits) {
+            counts[table(bits)]++;
+        }
+
+        auto const back =
+            static_cast<unsigned>(tez::opposite_direction(dir));
+
+        for (unsigned i = 0; i < tez::NUM_CARDINAL_DIR; ++i) {
+            if (i == d) continue;
+            EXPECT_GT(counts[d], counts[i]);
+            if (i != back) {
+                EXPECT_GT(counts[i], counts[back]);
+            }
+        }
+    }
+}
+
+TEST(GenerationParams, Reload) {
+    restore_params restore;
+
+    auto before = tez::simple_room_generator(bklib::random_engine(1));
+
+    tez::generation_source source;
+    tez::generation_source::range const fixed_width  = {7, 7};
+    tez::generation_source::range const fixed_height = {5, 5};
+    source.simple_width  = fixed_width;
+    source.simple_height = fixed_height;
+
+    tez::set_generation_params(
+        std::make_shared<tez::generation_params const>(source)
+    );
+
+    auto after = tez::simple_room_generator(bklib::random_engine(1));
+
+    for (int i = 0; i < 16; ++i) {
+        auto const r = after.generate();
+        EXPECT_EQ(7u, r.width());
+        EXPECT_EQ(5u, r.height());
+    }
+
+    //a generator keeps the block it was made with.
+    EXPECT_EQ(tez::current_generation_params().get(), &after.tables());
+    EXPECT_NE(&before.tables(), &after.tables());
+
+    bool varied = false;
+    for (int i = 0; i < 16; ++i) {
+        auto const r = before.generate();
+        varied |= r.width() != 7 || r.height() != 5;
+    }
+
+    EXPECT_TRUE(varied);
+}
@@ -17,6 +17,11 @@ public :
     typedef grid_t::position position_t;
 };
 
+//EXPECT_EQ binds its arguments by reference.
+const unsigned Grid2DTest::WIDTH;
+const unsigned Grid2DTest::HEIGHT;
+const unsigned Grid2DTest::VALUE;
+
 } //namespace
 
 TEST_F(Grid2DTest, GridCopy) {
@@ -215,3 +220,24 @@ TEST_F(Grid2DTest, MoveConstructor) {
         EXPECT_EQ(VALUE, i);
     }
 }
+
+TEST_F(Grid2DTest, FillRandom) {
+    bklib::hash_random const random(1984);
+
+    auto const fill = [](int& value, uint64_t const bits) {
+        value = static_cast<int>(bits % 1000);
+    };
+
+    grid_t whole(WIDTH, HEIGHT, 0);
+    grid_fill_random(whole, random, 1, fill);
+
+    //a window placed at its origin sees the same values.
+    grid_t window(2, 3, 0);
+    grid_fill_random(window, random, 1, fill, 2, 4);
+
+    for (unsigned y = 0; y < 3; ++y) {
+        for (unsigned x = 0; x < 2; ++x) {
+            EXPECT_EQ(whole.at(x + 2, y + 4), window.at(x, y));
+        }
+    }
+}
@@ -349,7 +349,5 @@
 int main(int argc, char* argv[]) {
     ::testing::InitGoogleTest(&argc, argv);
 
-    RUN_ALL_TESTS();
-
-    return 0;
+    return RUN_ALL_TESTS();
 }
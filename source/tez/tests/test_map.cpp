@@ -3,9 +3,12 @@
 #include "tez/map.hpp"
 #include "tez/map_layout.hpp"
 #include "tez/room_generator.hpp"
+#include "bklib/thread_pool.hpp"
 
 #include <gtest/gtest.h>
 
+#include <chrono>
+
 TEST(Map, Constructor) {
     auto test_map = tez::map(10, 20);
 
@@ -16,8 +19,8 @@ TEST(Map, Constructor) {
 TEST(Map, AddRoom) {
     auto test_map = tez::map(10, 20);
 
-    std::default_random_engine random(1984);
-    tez::room test_room = tez::simple_room_generator(bklib::make_random_wrapper(random)).generate();
+    bklib::random_engine random(1984);
+    tez::room test_room = tez::simple_room_generator(random).generate();
 
     test_map.add_room(test_room, 0, 0);
 
@@ -26,15 +29,40 @@ TEST(Map, AddRoom) {
     }
 }
 
+TEST(Map, RoomAt) {
+    auto test_map = tez::map(30, 20);
+
+    bklib::random_engine random(1984);
+    auto gen = tez::simple_room_generator(random);
+
+    tez::room room_a = gen.generate();
+    tez::room room_b = gen.generate();
+    room_b.translate_to(room_a.width() + 1, 0);
+
+    EXPECT_EQ(1, test_map.add_room(room_a));
+    EXPECT_EQ(2, test_map.add_room(room_b));
+    EXPECT_EQ(2U, test_map.room_count());
+
+    for (auto const& i : room_a) {
+        EXPECT_EQ(1, test_map.room_at(i.x, i.y));
+    }
+
+    for (auto const& i : room_b) {
+        EXPECT_EQ(2, test_map.room_at(i.x + room_b.left(), i.y + room_b.top()));
+    }
+
+    EXPECT_EQ(tez::map::NO_ROOM, test_map.room_at(room_a.width(), 0));
+    EXPECT_EQ(tez::map::NO_ROOM, test_map.room_at(29, 19));
+}
+
 TEST(MapCreation, Test) {
     for(unsigned n = 0; n < 10000; ++n) {
-    std::default_random_engine engine(::GetTickCount());
-    auto random = bklib::make_random_wrapper(engine);
+    bklib::random_engine random(n);
 
-    tez::map_layout layout(random);
+    tez::map_layout layout(random.split());
 
-    auto gen_simple   = tez::simple_room_generator(random);
-    auto gen_compound = tez::compound_room_generator(random);
+    auto gen_simple   = tez::simple_room_generator(random.split());
+    auto gen_compound = tez::compound_room_generator(random.split());
 
     for (int i = 0; i < 20; ++i) {
         if (i % 4 == 0) {
@@ -50,3 +78,198 @@ TEST(MapCreation, Test) {
     std::cout << test_map;
     }
 }
+
+TEST(MapLayout, PlacementBudget) {
+    bklib::random_engine random(1984);
+
+    tez::generation_budget budget;
+    budget.max_placement_attempts = 0;
+
+    tez::map_layout layout(random.split(), budget);
+    auto gen_simple = tez::simple_room_generator(random.split());
+
+    for (int i = 0; i < 5; ++i) {
+        EXPECT_FALSE(layout.add_room(gen_simple.generate()));
+    }
+
+    EXPECT_EQ(5U, layout.status().rooms_dropped);
+    EXPECT_TRUE(layout.status().is_degraded());
+}
+
+TEST(MapLayout, OccupancyGrid) {
+    typedef tez::occupancy_grid::rect_t rect_t;
+    static auto const N = tez::occupancy_grid::CELL_SIZE;
+
+    tez::occupancy_grid grid;
+    grid.insert(rect_t(-1, -1, 1, 1)); //four cells about the origin
+
+    auto const a = grid.count_free(rect_t(-N, -N, N, N));
+    EXPECT_EQ(4U, a.first);
+    EXPECT_EQ(0U, a.second);
+
+    auto const b = grid.count_free(rect_t(0, 0, 2*N, 2*N));
+    EXPECT_EQ(4U, b.first);
+    EXPECT_EQ(3U, b.second);
+
+    auto const c = grid.count_free(rect_t(0, 0, 0, 0));
+    EXPECT_EQ(0U, c.first);
+}
+
+//------------------------------------------------------------------------------
+// Candidates are tried in order of free space; nearly every room should fit at
+// the first candidate tried.
+//------------------------------------------------------------------------------
+TEST(MapLayout, PlacementAttempts) {
+    static unsigned const SEEDS = 50;
+    static unsigned const ROOMS = 100;
+
+    unsigned attempts = 0;
+    unsigned dropped  = 0;
+
+    for (unsigned seed = 0; seed < SEEDS; ++seed) {
+        bklib::random_engine random(seed);
+
+        tez::map_layout layout(random.split());
+        auto gen_simple   = tez::simple_room_generator(random.split());
+        auto gen_compound = tez::compound_room_generator(random.split());
+
+        for (unsigned i = 0; i < ROOMS; ++i) {
+            layout.add_room((i % 4 == 0) ?
+                gen_compound.generate() : gen_simple.generate()
+            );
+        }
+
+        attempts += layout.status().placement_attempts;
+        dropped  += layout.status().rooms_dropped;
+    }
+
+    auto const per_room = static_cast<double>(attempts) / (SEEDS * ROOMS);
+
+    EXPECT_EQ(0U, dropped);
+    EXPECT_LT(per_room, 1.25);
+}
+
+//==============================================================================
+//! Placement attempts per room and layout time over 200 seeds of 100 rooms,
+//! one in four compound.
+//!
+//! tez_tests --gtest_filter=MapLayout.DISABLED_PlacementThroughput
+//!           --gtest_also_run_disabled_tests
+//==============================================================================
+TEST(MapLayout, DISABLED_PlacementThroughput) {
+    typedef std::chrono::steady_clock clock;
+
+    static unsigned const SEEDS = 200;
+    static unsigned const ROOMS = 100;
+
+    unsigned attempts = 0;
+    unsigned dropped  = 0;
+
+    auto const start = clock::now();
+
+    for (unsigned seed = 0; seed < SEEDS; ++seed) {
+        bklib::random_engine random(seed);
+
+        tez::map_layout layout(random.split());
+        auto gen_simple   = tez::simple_room_generator(random.split());
+        auto gen_compound = tez::compound_room_generator(random.split());
+
+        for (unsigned i = 0; i < ROOMS; ++i) {
+            layout.add_room((i % 4 == 0) ?
+                gen_compound.generate() : gen_simple.generate()
+            );
+        }
+
+        attempts += layout.status().placement_attempts;
+        dropped  += layout.status().rooms_dropped;
+    }
+
+    std::chrono::duration<double, std::milli> const time = clock::now() - start;
+
+    std::cout << SEEDS << " seeds x " << ROOMS << " rooms: "
+              << static_cast<double>(attempts) / (SEEDS * ROOMS)
+              << " attempts/room, " << dropped << " dropped, "
+              << time.count() << " ms (room generation included)\n";
+}
+
+TEST(MapLayout, BridgeBudget) {
+    static unsigned const SEEDS = 20;
+
+    tez::generation_budget budget;
+    budget.max_bridge_attempts = 0;
+
+    unsigned routed = 0;
+
+    for (unsigned seed = 0; seed < SEEDS; ++seed) {
+        bklib::random_engine random(seed);
+
+        tez::map_layout layout(random.split(), budget);
+
+        auto gen_simple   = tez::simple_room_generator(random.split());
+        auto gen_compound = tez::compound_room_generator(random.split());
+
+        for (int i = 0; i < 20; ++i) {
+            if (i % 4 == 0) {
+                EXPECT_TRUE(layout.add_room(gen_compound.generate()));
+            } else {
+                EXPECT_TRUE(layout.add_room(gen_simple.generate()));
+            }
+        }
+
+        layout.normalize();
+        auto test_map = layout.make_map();
+
+        EXPECT_EQ(0U, layout.status().rooms_dropped);
+        EXPECT_FALSE(layout.status().disconnected);
+
+        routed += layout.status().bridges_routed;
+    }
+
+    //with no random bridges, every join was made by the search.
+    EXPECT_LT(0U, routed);
+}
+
+TEST(MapLayout, ParallelCorridors) {
+    auto const fill_layout = [](
+        tez::map_layout&          layout,
+        tez::map_layout::random_t random
+    ) {
+        auto gen_simple   = tez::simple_room_generator(random.split());
+        auto gen_compound = tez::compound_room_generator(random.split());
+
+        for (int i = 0; i < 60; ++i) {
+            if (i % 4 == 0) {
+                layout.add_room(gen_compound.generate());
+            } else {
+                layout.add_room(gen_simple.generate());
+            }
+        }
+
+        layout.normalize();
+    };
+
+    bklib::thread_pool pool(4);
+
+    for (unsigned seed = 0; seed < 4; ++seed) {
+        bklib::random_engine random_a(seed);
+        bklib::random_engine random_b(seed);
+
+        tez::map_layout layout_a(random_a.split());
+        tez::map_layout layout_b(random_b.split());
+
+        fill_layout(layout_a, random_a);
+        fill_layout(layout_b, random_b);
+
+        auto const map_a = layout_a.make_map();
+        auto const map_b = layout_b.make_map(&pool);
+
+        ASSERT_EQ(map_a.width(),  map_b.width());
+        ASSERT_EQ(map_a.height(), map_b.height());
+
+        for (unsigned y = 0; y < map_a.height(); ++y) {
+            for (unsigned x = 0; x < map_a.width(); ++x) {
+                ASSERT_EQ(map_a.at(x, y).type, map_b.at(x, y).type);
+            }
+        }
+    }
+}
@@ -0,0 +1,52 @@
+#include "pch.hpp"
+#include "tez/map_batch.hpp"
+#include "tez/tests/map_helpers.hpp"
+
+#include <gtest/gtest.h>
+
+using tez::test::same_tiles;
+
+TEST(MapBatch, SeedsDiffer) {
+    EXPECT_NE(tez::map_seed(1, 0), tez::map_seed(1, 1));
+    EXPECT_NE(tez::map_seed(1, 0), tez::map_seed(2, 0));
+    EXPECT_EQ(tez::map_seed(1, 5), tez::map_seed(1, 5));
+}
+
+TEST(MapBatch, IndependentOfThreadCount) {
+    static uint64_t const SEED  = 1984;
+    static unsigned const COUNT = 8;
+
+    tez::map_params params;
+
+    auto const serial   = tez::generate_maps(SEED, COUNT, params, 1);
+    auto const parallel = tez::generate_maps(SEED, COUNT, params, 4);
+
+    ASSERT_EQ(COUNT, serial.size());
+    ASSERT_EQ(COUNT, parallel.size());
+
+    for (unsigned i = 0; i < COUNT; ++i) {
+        EXPECT_EQ(tez::map_seed(SEED, i), serial[i].seed);
+        EXPECT_EQ(serial[i].seed, parallel[i].seed);
+        EXPECT_TRUE(same_tiles(serial[i].result, parallel[i].result));
+    }
+}
+
+TEST(MapBatch, Reproducible) {
+    tez::map_params params;
+
+    auto const batch  = tez::generate_maps(7, 3, params, 2);
+    auto const single = tez::generate_map(batch[2].seed, params);
+
+    EXPECT_TRUE(same_tiles(batch[2].result, single.result));
+}
+
+TEST(MapBatch, Caves) {
+    tez::map_params params;
+    params.cave_interval = 3;
+
+    auto const batch  = tez::generate_maps(11, 2, params, 2);
+    auto const single = tez::generate_map(batch[1].seed, params);
+
+    EXPECT_TRUE(same_tiles(batch[1].result, single.result));
+    EXPECT_FALSE(batch[1].status.disconnected);
+}
@@ -0,0 +1,160 @@
+#include "pch.hpp"
+#include "tez/map_delta.hpp"
+#include "tez/tests/map_helpers.hpp"
+
+#include <gtest/gtest.h>
+
+#include <sstream>
+#include <cstring>
+
+namespace {
+
+using tez::test::make_map;
+
+bool same_map(tez::map const& a, tez::map const& b) {
+    if (a.width() != b.width() || a.height() != b.height()) return false;
+    if (a.room_count() != b.room_count()) return false;
+
+    auto const n = a.tiles().size();
+
+    return std::memcmp(
+            a.tiles().data(), b.tiles().data(), n * sizeof(tez::tile_data)
+        ) == 0
+        && std::memcmp(
+            a.room_ids().data(), b.room_ids().data(),
+            n * sizeof(tez::map::room_id)
+        ) == 0;
+}
+
+//! Carve a corridor along row @p y, and open a door at its end.
+void edit(tez::map& m, unsigned const y) {
+    for (unsigned x = 2; x < 12; ++x) {
+        m.at(x, y).type = tez::tile_category::corridor;
+    }
+
+    auto& door = m.at(12, y);
+    door.type = tez::tile_category::door;
+    door.get_data<tez::door_data>().state = tez::door_data::door_state::open;
+}
+
+} //namespace
+
+TEST(MapDelta, Unchanged) {
+    auto const a = make_map(42);
+    auto const b = make_map(42);
+
+    auto const delta = tez::diff(a, b);
+
+    EXPECT_TRUE(delta.empty());
+    EXPECT_EQ(a.width(),  delta.width());
+    EXPECT_EQ(a.height(), delta.height());
+}
+
+TEST(MapDelta, Patch) {
+    auto const from = make_map(42);
+    auto to = make_map(42);
+
+    edit(to, 5);
+    edit(to, 9);
+
+    auto const delta = tez::diff(from, to);
+
+    //only the edited rows, a run or two each.
+    ASSERT_FALSE(delta.empty());
+    EXPECT_LE(delta.tiles().size(), 22u);
+    EXPECT_EQ(delta.tiles().size(), delta.room_ids().size());
+
+    for (auto const& s : delta.spans()) {
+        EXPECT_TRUE(s.y == 5 || s.y == 9);
+        EXPECT_LT(0u, s.length);
+    }
+
+    auto m = make_map(42);
+    tez::patch(m, delta);
+    EXPECT_TRUE(same_map(to, m));
+
+    //and back.
+    tez::patch(m, tez::diff(to, from));
+    EXPECT_TRUE(same_map(from, m));
+}
+
+TEST(MapDelta, DoorState) {
+    auto const from = make_map(7);
+    auto to = make_map(7);
+
+    edit(to, 3);
+    auto m = make_map(7);
+    edit(m, 3);
+
+    auto& door = to.at(12, 3).get_data<tez::door_data>();
+    door.state = tez::door_data::door_state::locked;
+
+    //only the data changed.
+    auto const delta = tez::diff(m, to);
+    ASSERT_EQ(1u, delta.spans().size());
+    EXPECT_EQ(12u, delta.spans()[0].x);
+    EXPECT_EQ(1u,  delta.spans()[0].length);
+
+    tez::patch(m, delta);
+    EXPECT_EQ(
+        tez::door_data::door_state::locked,
+        m.at(12, 3).get_data<tez::door_data>().state
+    );
+    EXPECT_TRUE(same_map(to, m));
+}
+
+TEST(MapDelta, RoundTrip) {
+    auto const from = make_map(3);
+    auto to = make_map(3);
+    edit(to, 1);
+    edit(to, 20);
+
+    std::stringstream bytes;
+    tez::write_map_delta(bytes, tez::diff(from, to));
+
+    auto const delta = tez::read_map_delta(bytes);
+
+    auto m = make_map(3);
+    tez::patch(m, delta);
+    EXPECT_TRUE(same_map(to, m));
+}
+
+TEST(MapDelta, Rejects) {
+    auto const from = make_map(5);
+    auto to = make_map(5);
+    edit(to, 2);
+
+    auto const delta = tez::diff(from, to);
+
+    tez::map other(from.width() + 1, from.height());
+    EXPECT_THROW(tez::patch(other, delta), tez::bad_map_delta);
+
+    std::ostringstream out;
+    tez::write_map_delta(out, delta);
+    auto const good = out.str();
+
+    //each case on a fresh copy; the first span is at offset 40.
+    auto const rejects = [&](std::function<void (std::string&)> const& f) {
+        auto bytes = good;
+        f(bytes);
+
+        std::istringstream in(bytes);
+        try {
+            tez::read_map_delta(in);
+        } catch (tez::bad_map_delta const&) {
+            return true;
+        }
+
+        return false;
+    };
+
+    typedef std::string& s;
+
+    EXPECT_FALSE(rejects([](s) {}));
+
+    EXPECT_TRUE(rejects([](s b) { b[0] = 'X'; }));
+    EXPECT_TRUE(rejects([](s b) { b.resize(b.size() - 1); }));
+    EXPECT_TRUE(rejects([](s b) { b.resize(20); }));
+    EXPECT_TRUE(rejects([](s b) { b[40] = '\xFF'; b[43] = '\x7F'; }));
+    EXPECT_TRUE(rejects([](s b) { b[48] = 0; b[49] = 0; }));
+}
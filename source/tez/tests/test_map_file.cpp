@@ -0,0 +1,157 @@
+#include "pch.hpp"
+#include "tez/map_file.hpp"
+#include "tez/map_batch.hpp"
+
+#include <gtest/gtest.h>
+
+#include <sstream>
+#include <cstdio>
+#include <cstring>
+
+namespace {
+
+//! The bytes of a map file, 8 byte aligned as a mapping would be.
+struct file_bytes {
+    explicit file_bytes(tez::map const& m) {
+        std::ostringstream out;
+        tez::write_map_file(out, m);
+
+        auto const s = out.str();
+        size  = s.size();
+        words.resize((size + 7) / 8);
+        std::memcpy(words.data(), s.data(), size);
+    }
+
+    char* data() { return reinterpret_cast<char*>(words.data()); }
+
+    tez::map_file_header& header() {
+        return *reinterpret_cast<tez::map_file_header*>(data());
+    }
+
+    tez::map_view view() { return tez::map_view(data(), size); }
+
+    std::vector<uint64_t> words;
+    size_t                size;
+};
+
+template <typename View>
+bool same_map(tez::map const& m, View const& v) {
+    if (m.width() != v.width() || m.height() != v.height()) return false;
+    if (m.room_count() != v.room_count()) return false;
+
+    for (unsigned y = 0; y < m.height(); ++y) {
+        for (unsigned x = 0; x < m.width(); ++x) {
+            if (m.at(x, y).type != v.at(x, y).type)       return false;
+            if (m.at(x, y).data != v.at(x, y).data)       return false;
+            if (m.room_at(x, y) != v.room_at(x, y))       return false;
+        }
+    }
+
+    return true;
+}
+
+} //namespace
+
+TEST(MapFile, RoundTrip) {
+    auto const generated = tez::generate_map(42, tez::map_params());
+    auto const& m = generated.result;
+
+    file_bytes bytes(m);
+    auto const view = bytes.view();
+
+    EXPECT_TRUE(same_map(m, view));
+
+    //in place: the view points into the bytes.
+    auto const first = reinterpret_cast<char const*>(&view.at(0, 0));
+    EXPECT_EQ(bytes.data() + bytes.header().tiles_offset, first);
+
+    auto const copy = tez::load_map(view);
+    EXPECT_TRUE(same_map(m, copy));
+}
+
+TEST(MapFile, Rooms) {
+    auto const generated = tez::generate_map(7, tez::map_params());
+    auto const& m = generated.result;
+
+    file_bytes bytes(m);
+    auto const view = bytes.view();
+
+    ASSERT_LT(0u, view.room_count());
+
+    std::vector<unsigned> counts(view.room_count() + 1);
+
+    for (unsigned y = 0; y < m.height(); ++y) {
+        for (unsigned x = 0; x < m.width(); ++x) {
+            auto const id = view.room_at(x, y);
+            if (id == tez::map::NO_ROOM) continue;
+
+            auto const& r = view.room(id);
+            EXPECT_LE(r.left, x);
+            EXPECT_LE(r.top, y);
+            EXPECT_GT(r.right, x);
+            EXPECT_GT(r.bottom, y);
+
+            counts[id]++;
+        }
+    }
+
+    for (unsigned id = 1; id <= view.room_count(); ++id) {
+        auto const key = static_cast<tez::map::room_id>(id);
+        EXPECT_EQ(counts[id], view.room(key).tiles);
+    }
+}
+
+TEST(MapFile, Mapped) {
+    static char const FILENAME[] = "test_map_file.tezmap";
+
+    auto const generated = tez::generate_map(3, tez::map_params());
+    tez::write_map_file(FILENAME, generated.result);
+
+    {
+        tez::map_file file(FILENAME);
+        EXPECT_TRUE(same_map(generated.result, file.view()));
+
+        auto const moved = std::move(file);
+        EXPECT_TRUE(same_map(generated.result, moved.view()));
+    }
+
+    std::remove(FILENAME);
+
+    EXPECT_THROW(
+        tez::map_file("no/such/map.tezmap"), bklib::mapped_file_error
+    );
+}
+
+TEST(MapFile, Rejects) {
+    auto const generated = tez::generate_map(5, tez::map_params());
+
+    //each case on a fresh copy.
+    auto const rejects = [&](std::function<void (file_bytes&)> const& f) {
+        file_bytes bytes(generated.result);
+        f(bytes);
+
+        try {
+            bytes.view();
+        } catch (tez::bad_map_file const&) {
+            return true;
+        }
+
+        return false;
+    };
+
+    typedef file_bytes& b;
+
+    EXPECT_FALSE(rejects([](b) {}));
+
+    EXPECT_TRUE(rejects([](b x) { x.header().magic[0] = 'X'; }));
+    EXPECT_TRUE(rejects([](b x) { x.header().version++; }));
+    EXPECT_TRUE(rejects([](b x) { x.header().byte_order = 0x04030201; }));
+    EXPECT_TRUE(rejects([](b x) { x.header().tile_size = 8; }));
+    EXPECT_TRUE(rejects([](b x) { x.header().width = 0xFFFFFFFF; }));
+    EXPECT_TRUE(rejects([](b x) { x.header().room_ids_offset += 8; }));
+    EXPECT_TRUE(rejects([](b x) {
+        x.header().rooms_offset = x.header().tiles_offset;
+    }));
+    EXPECT_TRUE(rejects([](b x) { x.size = 32; }));
+    EXPECT_TRUE(rejects([](b x) { x.size = x.header().rooms_offset; }));
+}
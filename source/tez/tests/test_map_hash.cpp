@@ -0,0 +1,87 @@
+#include "pch.hpp"
+#include "tez/map_hash.hpp"
+#include "tez/tests/map_helpers.hpp"
+#include "tez/room_generator.hpp"
+
+#include <gtest/gtest.h>
+
+using tez::test::make_map;
+
+TEST(MapHash, Content) {
+    auto const a = make_map(42);
+    auto b = make_map(42);
+    auto const c = make_map(43);
+
+    EXPECT_EQ(tez::hash(a), tez::hash(b));
+    EXPECT_EQ(tez::hash128(a), tez::hash128(b));
+    EXPECT_NE(tez::hash(a), tez::hash(c));
+
+    //a door opened is a change.
+    b.at(1, 1).type = tez::tile_category::door;
+    b.at(1, 1).get_data<tez::door_data>().state =
+        tez::door_data::door_state::open;
+
+    EXPECT_NE(tez::hash(a), tez::hash(b));
+    EXPECT_NE(tez::hash128(a), tez::hash128(b));
+}
+
+TEST(MapHash, Grids) {
+    auto const m = make_map(7);
+
+    auto const& tiles = m.tiles();
+    tez::grid_view<tez::tile_data> const view(tiles);
+
+    EXPECT_EQ(tez::hash(tiles), tez::hash(view));
+    EXPECT_EQ(tez::hash128(tiles), tez::hash128(view));
+
+    //the same values in another shape differ.
+    tez::grid_view<tez::tile_data> const flat(
+        tiles.data(), tiles.width() * tiles.height(), 1
+    );
+    EXPECT_NE(tez::hash(view), tez::hash(flat));
+}
+
+TEST(MapHash, Room) {
+    bklib::random_engine random(1984);
+    auto gen = tez::simple_room_generator(random);
+
+    tez::room a = gen.generate();
+    tez::room b = gen.generate();
+
+    EXPECT_EQ(tez::hash(a), tez::hash(a));
+    EXPECT_NE(tez::hash(a), tez::hash(b));
+
+    //where a room is matters; its shape hashes the same anywhere.
+    auto const shape = tez::hash(*a.shape());
+    auto const before = tez::hash(a);
+    a.translate_by(3, 4);
+
+    EXPECT_NE(before, tez::hash(a));
+    EXPECT_EQ(shape, tez::hash(*a.shape()));
+}
+
+TEST(MapHash, Zobrist) {
+    auto m = make_map(5);
+    auto const original = make_map(5);
+
+    tez::zobrist_hash z(m);
+    EXPECT_EQ(tez::zobrist_hash(original).value(), z.value());
+
+    tez::tile_data corridor = m.at(2, 2);
+    corridor.type = tez::tile_category::corridor;
+
+    for (unsigned x = 2; x < 20; ++x) {
+        z.set(m, x, 2, corridor);
+    }
+
+    //kept up to date: the same as a full pass.
+    EXPECT_EQ(tez::zobrist_hash(m).value(), z.value());
+    EXPECT_NE(tez::zobrist_hash(original).value(), z.value());
+
+    //undone in another order, the value returns.
+    for (unsigned x = 20; x-- > 2;) {
+        z.set(m, x, 2, original.at(x, 2));
+    }
+
+    EXPECT_EQ(tez::zobrist_hash(original).value(), z.value());
+}
@@ -0,0 +1,126 @@
+#include "pch.hpp"
+#include "tez/map_pipeline.hpp"
+#include "tez/tests/map_helpers.hpp"
+#include "bklib/thread_pool.hpp"
+
+#include <gtest/gtest.h>
+
+namespace {
+
+using tez::pipeline_stage;
+using tez::test::same_tiles;
+
+} //namespace
+
+TEST(MapPipeline, SameAsGenerateMap) {
+    tez::map_params params;
+    params.cave_interval = 3;
+
+    tez::map_pipeline pipeline(params);
+
+    for (uint64_t seed = 1; seed <= 4; ++seed) {
+        auto const expected = tez::generate_map(seed, params);
+        auto const actual   = pipeline.run(seed);
+
+        EXPECT_EQ(seed, actual.seed);
+        EXPECT_TRUE(same_tiles(expected.result, actual.result));
+    }
+}
+
+TEST(MapPipeline, StageByStage) {
+    tez::map_pipeline pipeline;
+
+    auto rooms = pipeline.synthesise(11);
+    EXPECT_EQ(pipeline.params().room_count, rooms.rooms.size());
+
+    auto placed = pipeline.place(std::move(rooms));
+    auto raster = pipeline.rasterise(std::move(placed));
+
+    EXPECT_LT(0u, raster.tiles.width());
+    EXPECT_LT(0u, raster.tiles.height());
+
+    auto routed = pipeline.route(std::move(raster));
+    auto result = pipeline.decorate(pipeline.repair(std::move(routed)));
+
+    EXPECT_TRUE(same_tiles(pipeline.run(11).result, result.result));
+}
+
+TEST(MapPipeline, Overlapped) {
+    static uint64_t const SEED  = 2013;
+    static unsigned const COUNT = 5;
+
+    tez::map_pipeline  pipeline;
+    bklib::thread_pool pool(2);
+
+    unsigned next = 0;
+    pipeline.run_overlapped(SEED, COUNT, pool, [&](tez::generated_map m) {
+        auto const seed = tez::map_seed(SEED, next++);
+
+        EXPECT_EQ(seed, m.seed);
+        EXPECT_TRUE(same_tiles(pipeline.run(seed).result, m.result));
+    });
+
+    EXPECT_EQ(COUNT, next);
+}
+
+TEST(MapPipeline, Stats) {
+    tez::map_pipeline pipeline;
+
+    pipeline.run(3);
+    pipeline.run(4);
+
+    for (unsigned i = 0; i < tez::PIPELINE_STAGE_COUNT; ++i) {
+        auto const stage = static_cast<pipeline_stage>(i);
+        EXPECT_EQ(2u, pipeline.stats(stage).runs) << tez::stage_name(stage);
+    }
+
+    auto const rooms = pipeline.stats(pipeline_stage::synthesis).items;
+    auto const kept  = pipeline.stats(pipeline_stage::placement).items;
+
+    EXPECT_EQ(2 * pipeline.params().room_count, rooms);
+    EXPECT_GE(rooms, kept);
+    EXPECT_EQ(kept, pipeline.stats(pipeline_stage::rasterisation).items);
+    EXPECT_LT(0u, pipeline.stats(pipeline_stage::routing).items);
+    EXPECT_EQ(0u, pipeline.stats(pipeline_stage::decoration).items);
+
+    pipeline.reset_stats();
+    EXPECT_EQ(0u, pipeline.stats(pipeline_stage::synthesis).runs);
+    EXPECT_EQ(0u, pipeline.stats(pipeline_stage::synthesis).items);
+}
+
+TEST(MapPipeline, Decorators) {
+    tez::map_pipeline pipeline;
+
+    auto const plain = pipeline.run(5);
+
+    pipeline.add_decorator([](tez::map& m, tez::map_pipeline::random_t&) {
+        m.at(0, 0).type = tez::tile_category::water;
+        return 1u;
+    });
+
+    auto const decorated = pipeline.run(5);
+
+    EXPECT_EQ(tez::tile_category::water, decorated.result.at(0, 0).type);
+    EXPECT_EQ(1u, pipeline.stats(pipeline_stage::decoration).items);
+    EXPECT_EQ(plain.result.width(), decorated.result.width());
+}
+
+TEST(MapPipeline, SynthesiseAndPlace) {
+    tez::map_params params;
+    params.room_count    = 40;
+    params.cave_interval = 5;
+
+    tez::map_pipeline  pipeline(params);
+    bklib::thread_pool pool(4);
+
+    for (uint64_t seed = 20; seed < 24; ++seed) {
+        auto const serial   = pipeline.run(seed);
+        auto const streamed = pipeline.run(seed, &pool);
+
+        EXPECT_TRUE(same_tiles(serial.result, streamed.result));
+    }
+
+    auto const& synthesis = pipeline.stats(pipeline_stage::synthesis);
+    EXPECT_EQ(8u, synthesis.runs);
+    EXPECT_EQ(8 * params.room_count, synthesis.items);
+}
@@ -5,6 +5,8 @@
 
 #include <gtest/gtest.h>
 
+#include <chrono>
+
 class RoomTest : public ::testing::Test {
 public :
     typedef tez::room::grid_t grid_t;
@@ -15,12 +17,12 @@ public :
     RoomTest()
         : engine(std::random_device()())
         , test_room(
-            tez::simple_room_generator(bklib::make_random_wrapper(engine)).generate()
+            tez::simple_room_generator(engine).generate()
         )
     {
     }
 
-    std::default_random_engine engine;
+    bklib::random_engine engine;
     tez::room test_room;
 };
 
@@ -64,7 +66,7 @@ TEST_F(RoomTest, Iterator) {
 }
 
 TEST_F(RoomTest, FindConnectable) {
-    auto random = bklib::make_random_wrapper(engine);
+    auto& random = engine;
 
     auto const w = test_room.width();
     auto const h = test_room.height();
@@ -102,21 +104,94 @@ TEST_F(RoomTest, FindConnectable) {
     }
 }
 
+TEST_F(RoomTest, ConnectionCandidates) {
+    auto const w = test_room.width();
+    auto const h = test_room.height();
+
+    //the same points the edge scan used to choose between.
+    EXPECT_EQ(w - 2, test_room.connection_count(tez::direction::north));
+    EXPECT_EQ(w - 2, test_room.connection_count(tez::direction::south));
+    EXPECT_EQ(h - 3, test_room.connection_count(tez::direction::west));
+    EXPECT_EQ(h - 3, test_room.connection_count(tez::direction::east));
+
+    //no ceiling, nowhere to connect.
+    auto const bare = tez::room(grid_t(4, 4, tez::tile_category::floor));
+    for (unsigned i = 0; i < tez::NUM_CARDINAL_DIR; ++i) {
+        EXPECT_FALSE(bare.has_connection_point(static_cast<tez::direction>(i)));
+    }
+
+    auto moved = tez::room(std::move(test_room));
+    EXPECT_EQ(w - 2, moved.connection_count(tez::direction::north));
+}
+
+TEST_F(RoomTest, SimpleKind) {
+    ASSERT_EQ(tez::room_kind::simple, test_room.kind());
+
+    //the arithmetic points are exactly those the scan would find.
+    tez::room::connection_list found[tez::NUM_CARDINAL_DIR];
+    grid_t grid(test_room.width(), test_room.height());
+    for (unsigned y = 0; y < grid.height(); ++y) {
+        for (unsigned x = 0; x < grid.width(); ++x) {
+            grid.at(x, y) = test_room.at(x, y);
+        }
+    }
+
+    tez::room::scan_connections(grid, found);
+
+    for (unsigned i = 0; i < tez::NUM_CARDINAL_DIR; ++i) {
+        auto const side = static_cast<tez::direction>(i);
+        ASSERT_EQ(found[i].size(), test_room.connection_count(side));
+
+        for (int n = 0; n < 50; ++n) {
+            auto const p = test_room.find_connection_point(side, engine);
+            EXPECT_NE(
+                found[i].end(), std::find(found[i].begin(), found[i].end(), p)
+            );
+        }
+    }
+}
+
+TEST_F(RoomTest, CustomKind) {
+    //only the middle of the north side.
+    struct rule {
+        static void middle(
+            grid_t const& grid,
+            tez::room::connection_list (&out)[tez::NUM_CARDINAL_DIR]
+        ) {
+            out[0].emplace_back(grid.width() / 2, 0);
+        }
+    };
+
+    auto const r = tez::room(
+        grid_t(5, 5, tez::tile_category::ceiling), &rule::middle
+    );
+
+    EXPECT_EQ(tez::room_kind::custom, r.kind());
+    EXPECT_EQ(1U, r.connection_count(tez::direction::north));
+    EXPECT_FALSE(r.has_connection_point(tez::direction::south));
+    EXPECT_FALSE(r.has_connection_point(tez::direction::east));
+    EXPECT_FALSE(r.has_connection_point(tez::direction::west));
+
+    auto const p = r.find_connection_point(tez::direction::north, engine);
+    EXPECT_EQ(2U, p.x);
+    EXPECT_EQ(0U, p.y);
+}
+
 TEST_F(RoomTest, Constructor) {
 
 }
 
 TEST_F(RoomTest, SwapMove) {
-    auto random = bklib::make_random_wrapper(engine);
+    auto& random = engine;
 
     auto& room_a = test_room;
     auto  room_b = tez::room(tez::simple_room_generator(random).generate());
 
-    const unsigned      W0 = 5;
-    const unsigned      H0 = 10;
+    const unsigned      W0 = room_a.width();
+    const unsigned      H0 = room_a.height();
 
-    const unsigned      W1 = 4;
-    const unsigned      H1 = 9;
+    const unsigned      W1 = room_b.width();
+    const unsigned      H1 = room_b.height();
 
     swap(room_a, room_b);
     
@@ -126,3 +201,327 @@ TEST_F(RoomTest, SwapMove) {
     EXPECT_EQ(W1, room_a.width());    
     EXPECT_EQ(H1, room_a.height());
 }
+
+TEST(RoomGenerator, SeedAt) {
+    bklib::hash_random const keys(1984);
+
+    auto gen_a = tez::compound_room_generator(bklib::random_engine(1));
+    auto gen_b = tez::compound_room_generator(bklib::random_engine(2));
+
+    //gen_b has made other rooms first; keyed rooms don't depend on that.
+    gen_b.generate();
+    gen_b.generate();
+
+    gen_a.seed_at(keys, 5, 0);
+    gen_b.seed_at(keys, 5, 0);
+
+    auto const room_a = gen_a.generate();
+    auto const room_b = gen_b.generate();
+
+    ASSERT_EQ(room_a.width(),  room_b.width());
+    ASSERT_EQ(room_a.height(), room_b.height());
+
+    for (unsigned y = 0; y < room_a.height(); ++y) {
+        for (unsigned x = 0; x < room_a.width(); ++x) {
+            EXPECT_EQ(room_a.at(x, y), room_b.at(x, y));
+        }
+    }
+}
+
+TEST(RoomGenerator, CompoundCellCount) {
+    static unsigned const COUNT = 3000;
+
+    auto gen = tez::compound_room_generator(
+        bklib::random_engine(1984), COUNT, COUNT
+    );
+
+    auto const room = gen.generate();
+
+    //every cell is distinct and fills a square block of tiles.
+    unsigned tiles = 0;
+    for (auto const& i : room) {
+        if (i != tez::tile_category::empty) tiles++;
+    }
+
+    ASSERT_EQ(0U, tiles % COUNT);
+
+    auto const area = tiles / COUNT;
+    EXPECT_TRUE(area == 4*4 || area == 5*5 || area == 6*6);
+}
+
+TEST(RoomGenerator, CompoundClassification) {
+    typedef tez::grid2d<tez::tile_category> grid_t;
+
+    static auto const EMPTY = tez::tile_category::empty;
+    static auto const FLOOR = tez::tile_category::floor;
+    static auto const CEIL  = tez::tile_category::ceiling;
+    static auto const WALL  = tez::tile_category::wall;
+
+    //reference: tile by tile with checked neighbour reads.
+    auto const classify = [](grid_t& grid) {
+        auto const get = [](tez::tile_category* p) { return p ? *p : EMPTY; };
+
+        for (auto& block : grid.block_iterator()) {
+            auto here = block.here();
+            if (!here || *here == EMPTY) continue;
+
+            tez::tile_category* const around[] = {
+                block.north(),      block.south(),
+                block.east(),       block.west(),
+                block.north_west(), block.north_east(),
+                block.south_west(), block.south_east()
+            };
+
+            bool ceiling = false;
+            for (auto const p : around) ceiling |= (get(p) == EMPTY);
+
+            if (ceiling)                         *here = CEIL;
+            else if (get(block.north()) == CEIL) *here = WALL;
+        }
+    };
+
+    //wide enough to span several 64 tile words.
+    auto gen = tez::compound_room_generator(bklib::random_engine(7), 40, 80);
+
+    for (int n = 0; n < 20; ++n) {
+        auto const room = gen.generate();
+        auto const w = room.width();
+        auto const h = room.height();
+
+        grid_t expected(w, h, EMPTY);
+        for (unsigned y = 0; y < h; ++y) {
+            for (unsigned x = 0; x < w; ++x) {
+                if (room.at(x, y) != EMPTY) expected.at(x, y) = FLOOR;
+            }
+        }
+
+        classify(expected);
+
+        for (unsigned y = 0; y < h; ++y) {
+            for (unsigned x = 0; x < w; ++x) {
+                ASSERT_EQ(expected.at(x, y), room.at(x, y));
+            }
+        }
+    }
+}
+
+TEST(RoomGenerator, Cave) {
+    typedef tez::grid2d<tez::tile_category> grid_t;
+
+    static auto const EMPTY = tez::tile_category::empty;
+    static auto const CEIL  = tez::tile_category::ceiling;
+
+    auto gen = tez::cave_room_generator(bklib::random_engine(42));
+
+    for (int n = 0; n < 20; ++n) {
+        auto const room = gen.generate();
+        auto const w = room.width();
+        auto const h = room.height();
+
+        ASSERT_EQ(tez::room_kind::custom, room.kind());
+
+        //a single open area, enclosed by ceiling.
+        unsigned open = 0;
+        unsigned start_x = 0, start_y = 0;
+
+        for (unsigned y = 0; y < h; ++y) {
+            for (unsigned x = 0; x < w; ++x) {
+                auto const t = room.at(x, y);
+                if (t == EMPTY || t == CEIL) continue;
+
+                ASSERT_TRUE(x > 0 && y > 0 && x + 1 < w && y + 1 < h);
+                for (unsigned ny = y - 1; ny <= y + 1; ++ny) {
+                    for (unsigned nx = x - 1; nx <= x + 1; ++nx) {
+                        ASSERT_NE(EMPTY, room.at(nx, ny));
+                    }
+                }
+
+                start_x = x;
+                start_y = y;
+                open++;
+            }
+        }
+
+        ASSERT_LT(0U, open);
+
+        grid_t seen(w, h, EMPTY);
+        std::vector<std::pair<unsigned, unsigned>> queue(
+            1, std::make_pair(start_x, start_y)
+        );
+        seen.at(start_x, start_y) = CEIL;
+
+        for (size_t i = 0; i < queue.size(); ++i) {
+            auto const x = queue[i].first;
+            auto const y = queue[i].second;
+
+            unsigned const nx[] = {x - 1, x + 1, x, x};
+            unsigned const ny[] = {y, y, y - 1, y + 1};
+
+            for (int j = 0; j < 4; ++j) {
+                auto const t = room.at(nx[j], ny[j]);
+                if (t == EMPTY || t == CEIL) continue;
+                if (seen.at(nx[j], ny[j]) != EMPTY) continue;
+
+                seen.at(nx[j], ny[j]) = CEIL;
+                queue.emplace_back(nx[j], ny[j]);
+            }
+        }
+
+        EXPECT_EQ(open, queue.size());
+
+        //connections are ceiling with a clear line out of the room.
+        bklib::random_engine random(n);
+
+        if (room.has_connection_point(tez::direction::north)) {
+            auto const p =
+                room.find_connection_point(tez::direction::north, random);
+            EXPECT_EQ(CEIL, room.at(p.x, p.y));
+            for (unsigned y = 0; y < p.y; ++y) {
+                EXPECT_EQ(EMPTY, room.at(p.x, y));
+            }
+        }
+
+        if (room.has_connection_point(tez::direction::west)) {
+            auto const p =
+                room.find_connection_point(tez::direction::west, random);
+            EXPECT_EQ(CEIL, room.at(p.x, p.y));
+            for (unsigned x = 0; x < p.x; ++x) {
+                EXPECT_EQ(EMPTY, room.at(x, p.y));
+            }
+        }
+    }
+}
+
+TEST(RoomGenerator, CaveRules) {
+    tez::cave_params params;
+    params.width  = 70; //spans two 64 tile words.
+    params.height = 20;
+
+    //nothing solid and nothing born: the whole inside is open.
+    params.fill_percent = 0;
+    params.birth        = 0;
+
+    auto const open = tez::cave_room_generator(
+        bklib::random_engine(1), params
+    ).generate();
+
+    EXPECT_EQ(params.width,  open.width());
+    EXPECT_EQ(params.height, open.height());
+    EXPECT_EQ(tez::tile_category::floor, open.at(35, 10));
+
+    //all solid: only the middle is opened.
+    params.fill_percent = 100;
+
+    auto const rock = tez::cave_room_generator(
+        bklib::random_engine(1), params
+    ).generate();
+
+    EXPECT_EQ(3U, rock.width());
+    EXPECT_EQ(3U, rock.height());
+}
+
+TEST(RoomGenerator, CaveStep) {
+    typedef tez::detail::cave_cells cells_t;
+
+    //B3/S23, the default B5678/S45678, B0/S8 and everything.
+    uint16_t const rules[][2] = {
+        {0x008, 0x00C}, {0x1E0, 0x1F0}, {0x001, 0x100}, {0x1FF, 0x1FF},
+    };
+
+    //widths on, either side of and well past a 64 tile word.
+    unsigned const widths[] = {1, 3, 63, 64, 65, 100, 129};
+
+    bklib::random_engine random(1984);
+
+    for (auto const w : widths) {
+        for (auto const& rule : rules) {
+            auto const h = 1 + random() % 40;
+
+            cells_t solid(w, static_cast<unsigned>(h), 0);
+            for (unsigned y = 0; y < solid.height(); ++y) {
+                for (unsigned x = 0; x < w; ++x) {
+                    solid.at(x, y) = random() % 2 ? 1 : 0;
+                }
+            }
+
+            auto const result = tez::detail::cave_step(solid, rule[0], rule[1]);
+
+            //per tile B/S; outside the grid counts as solid.
+            auto const is_solid = [&](signed const x, signed const y) {
+                return x < 0 || y < 0 ||
+                       x >= static_cast<signed>(solid.width()) ||
+                       y >= static_cast<signed>(solid.height()) ||
+                       solid.at(x, y) != 0;
+            };
+
+            for (signed y = 0; y < static_cast<signed>(solid.height()); ++y) {
+                for (signed x = 0; x < static_cast<signed>(w); ++x) {
+                    unsigned count = 0;
+                    for (signed dy = -1; dy <= 1; ++dy) {
+                        for (signed dx = -1; dx <= 1; ++dx) {
+                            if ((dx || dy) && is_solid(x + dx, y + dy)) count++;
+                        }
+                    }
+
+                    auto const mask = is_solid(x, y) ? rule[1] : rule[0];
+                    auto const expected = ((mask >> count) & 1) ? 1 : 0;
+
+                    ASSERT_EQ(expected, result.at(x, y))
+                        << "at (" << x << ", " << y << ") of " << w << " x "
+                        << solid.height() << ", B/S " << rule[0] << "/"
+                        << rule[1];
+                }
+            }
+        }
+    }
+}
+
+TEST(RoomGenerator, CaveLarge) {
+    tez::cave_params params;
+    params.width  = 512;
+    params.height = 512;
+
+    auto gen = tez::cave_room_generator(bklib::random_engine(3), params);
+    auto const room = gen.generate();
+
+    EXPECT_LE(room.width(),  512U);
+    EXPECT_LE(room.height(), 512U);
+
+    //most of the open space is one area at this fill.
+    EXPECT_GT(room.width() * room.height(), 256U * 256U);
+}
+
+//==============================================================================
+//! Time to generate caves of 64 x 64 up to 512 x 512.
+//!
+//! tez_tests --gtest_filter=RoomGenerator.DISABLED_CaveThroughput
+//!           --gtest_also_run_disabled_tests
+//==============================================================================
+TEST(RoomGenerator, DISABLED_CaveThroughput) {
+    typedef std::chrono::steady_clock clock;
+
+    unsigned const sizes[] = {64, 128, 256, 512};
+
+    for (auto const size : sizes) {
+        static unsigned const RUNS = 8;
+
+        tez::cave_params params;
+        params.width  = size;
+        params.height = size;
+
+        auto gen = tez::cave_room_generator(bklib::random_engine(1), params);
+
+        auto const start = clock::now();
+
+        for (unsigned i = 0; i < RUNS; ++i) {
+            auto const room = gen.generate();
+            EXPECT_LE(room.width(), size);
+        }
+
+        std::chrono::duration<double, std::milli> const time =
+            clock::now() - start;
+
+        std::cout << size << "x" << size << ": " << time.count() / RUNS
+                  << " ms per cave\n";
+    }
+}
@@ -0,0 +1,87 @@
+#include "pch.hpp"
+#include "tez/room_prefab.hpp"
+
+#include "tez/room_generator.hpp"
+
+#include <gtest/gtest.h>
+
+namespace {
+    typedef tez::prefab_cache::grid_t grid_t;
+
+    grid_t make_grid(unsigned w, unsigned h, unsigned ceiling_x) {
+        grid_t result(w, h, tez::tile_category::floor);
+        result.at(ceiling_x, 0) = tez::tile_category::ceiling;
+        return result;
+    }
+} //namespace
+
+TEST(PrefabCache, Intern) {
+    tez::prefab_cache cache;
+
+    auto const a = cache.intern(make_grid(9, 3, 1));
+    auto const b = cache.intern(make_grid(9, 3, 1));
+    auto const c = cache.intern(make_grid(9, 3, 8)); //differs in the 2nd word.
+    auto const d = cache.intern(make_grid(3, 9, 1)); //same tiles, other size.
+
+    EXPECT_EQ(a, b);
+    EXPECT_NE(a, c);
+    EXPECT_NE(a, d);
+
+    EXPECT_EQ(3U, cache.size());
+    EXPECT_EQ(1U, cache.hits());
+    EXPECT_EQ(3U, cache.misses());
+
+    EXPECT_NE(
+        tez::prefab_cache::shape_hash(*a), tez::prefab_cache::shape_hash(*c)
+    );
+
+    cache.clear();
+
+    EXPECT_EQ(0U, cache.size());
+    EXPECT_EQ(0U, cache.hits());
+    EXPECT_EQ(0U, cache.misses());
+}
+
+TEST(PrefabCache, FindOrMake) {
+    tez::prefab_cache cache;
+
+    unsigned made = 0;
+    auto const make = [&]() -> grid_t {
+        made++;
+        return make_grid(4, 4, 2);
+    };
+
+    auto const a = cache.find_or_make(1, make);
+    auto const b = cache.find_or_make(1, make);
+    auto const c = cache.find_or_make(2, make); //same grid, other key.
+
+    EXPECT_EQ(2U, made);
+    EXPECT_EQ(a, b);
+    EXPECT_EQ(a, c);
+    EXPECT_EQ(1U, cache.size());
+}
+
+TEST(PrefabCache, SimpleRoomsShareGrids) {
+    auto gen = tez::simple_room_generator(bklib::random_engine(1984));
+
+    std::vector<tez::room> rooms;
+    for (int i = 0; i < 200; ++i) {
+        rooms.emplace_back(gen.generate());
+    }
+
+    //8 widths by 7 heights at most.
+    EXPECT_LE(gen.prefabs().size(), 8U * 7U);
+    EXPECT_LT(gen.prefabs().size(), rooms.size());
+
+    for (auto const& r : rooms) {
+        auto const& shape = *r.shape();
+        ASSERT_EQ(r.width(),  shape.width());
+        ASSERT_EQ(r.height(), shape.height());
+    }
+
+    //instances are placed independently.
+    rooms[0].translate_to(10, 20);
+    rooms[1].translate_to(-5, 7);
+    EXPECT_EQ(10, rooms[0].left());
+    EXPECT_EQ(-5, rooms[1].left());
+}
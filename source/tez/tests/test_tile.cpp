@@ -7,7 +7,11 @@ TEST(Tile, Constructor) {
     using namespace tez;
 
     tile_data tile;
+    tile.type = tile_category::door;
 
-    auto door = tile.get_data<door_data>();
+    auto& door = tile.get_data<door_data>();
+    door.state = door_data::door_state::open;
+
+    EXPECT_EQ(door_data::door_state::open, tile.get_data<door_data>().state);
 
 }
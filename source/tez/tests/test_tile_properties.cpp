@@ -0,0 +1,118 @@
+#include "pch.hpp"
+#include "tez/tile_properties.hpp"
+
+#include <gtest/gtest.h>
+
+#include <sstream>
+
+namespace {
+
+using tez::tile_category;
+using tez::has_tile_flag;
+
+namespace flag = tez::tile_flag;
+
+void load(char const* json) {
+    std::istringstream in(json);
+    tez::load_tile_types(in);
+}
+
+//==============================================================================
+//! Restores the compiled in properties when it goes out of scope.
+//==============================================================================
+struct restore_properties {
+    ~restore_properties() {
+        tez::reset_tile_properties();
+    }
+};
+
+} //namespace
+
+TEST(TileProperties, Defaults) {
+    EXPECT_TRUE(has_tile_flag(tile_category::empty,    flag::pathable));
+    EXPECT_TRUE(has_tile_flag(tile_category::corridor, flag::pathable));
+    EXPECT_FALSE(has_tile_flag(tile_category::floor,   flag::pathable));
+    EXPECT_FALSE(has_tile_flag(tile_category::door,    flag::pathable));
+
+    EXPECT_TRUE(has_tile_flag(tile_category::ceiling, flag::connectable));
+    EXPECT_FALSE(has_tile_flag(tile_category::wall,   flag::connectable));
+
+    EXPECT_TRUE(has_tile_flag(tile_category::door, flag::opening));
+    EXPECT_TRUE(has_tile_flag(tile_category::wall, flag::opaque));
+    EXPECT_TRUE(has_tile_flag(tile_category::floor, flag::passable));
+
+    EXPECT_EQ(0u,  tez::tile_atlas_index(tile_category::empty));
+    EXPECT_EQ(2u,  tez::tile_atlas_index(tile_category::wall));
+    EXPECT_EQ(24u, tez::tile_atlas_index(tile_category::ceiling));
+    EXPECT_EQ(1u,  tez::tile_atlas_index(tile_category::floor));
+    EXPECT_EQ(32u, tez::tile_atlas_index(tile_category::door));
+    EXPECT_EQ(20u, tez::tile_atlas_index(tile_category::corridor));
+
+    //values that are not categories have nothing set.
+    auto const none = static_cast<tile_category>('?');
+    EXPECT_EQ(0u, tez::tile_properties(none).flags);
+    EXPECT_EQ(0u, tez::tile_properties(none).atlas);
+}
+
+TEST(TileProperties, Override) {
+    restore_properties restore;
+
+    load(
+        "{\n"
+        "  \"floor\": {\n"
+        "    \"description\": {\"en\": \"A simple floor.\"},\n"
+        "    \"pathable\": true,\n"
+        "    \"atlas\": 7\n"
+        "  },\n"
+        "  \"door\": {\"opening\": false}\n"
+        "}\n"
+    );
+
+    //changed, kept.
+    EXPECT_TRUE(has_tile_flag(tile_category::floor, flag::pathable));
+    EXPECT_TRUE(has_tile_flag(tile_category::floor, flag::passable));
+    EXPECT_EQ(7u, tez::tile_atlas_index(tile_category::floor));
+
+    EXPECT_FALSE(has_tile_flag(tile_category::door, flag::opening));
+    EXPECT_EQ(32u, tez::tile_atlas_index(tile_category::door));
+
+    tez::reset_tile_properties();
+
+    EXPECT_FALSE(has_tile_flag(tile_category::floor, flag::pathable));
+    EXPECT_EQ(1u, tez::tile_atlas_index(tile_category::floor));
+    EXPECT_TRUE(has_tile_flag(tile_category::door, flag::opening));
+}
+
+TEST(TileProperties, RejectsAllOrNothing) {
+    restore_properties restore;
+
+    EXPECT_THROW(
+        load("{\"floor\": {\"atlas\": 3}, \"lava\": {\"atlas\": 4}}"),
+        tez::bad_tile_types
+    );
+    EXPECT_THROW(load("{\"floor\": {\"atlas\": 256}}"), tez::bad_tile_types);
+    EXPECT_THROW(load("{\"floor\": {\"opaque\": 2}}"), tez::bad_tile_types);
+    EXPECT_THROW(load("{\"floor\"; {}}"), tez::bad_tile_types);
+
+    EXPECT_EQ(1u, tez::tile_atlas_index(tile_category::floor));
+    EXPECT_FALSE(has_tile_flag(tile_category::floor, flag::opaque));
+}
+
+//run from the root of the tree, as the game is.
+TEST(TileProperties, DataFile) {
+    restore_properties restore;
+
+    //the shipped file describes the compiled in defaults.
+    tez::tile_property before[tez::TILE_PROPERTY_COUNT];
+    std::copy_n(
+        tez::detail::tile_properties, tez::TILE_PROPERTY_COUNT, before
+    );
+
+    ASSERT_NO_THROW(tez::load_tile_types(std::string("data/tile_types.def")));
+
+    for (unsigned i = 0; i < tez::TILE_PROPERTY_COUNT; ++i) {
+        auto const type = static_cast<tile_category>(i);
+        EXPECT_EQ(before[i].flags, tez::tile_properties(type).flags);
+        EXPECT_EQ(before[i].atlas, tez::tile_properties(type).atlas);
+    }
+}
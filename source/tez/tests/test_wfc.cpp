@@ -0,0 +1,238 @@
+#include "pch.hpp"
+#include "tez/wfc.hpp"
+
+#include "tez/room_generator.hpp"
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+
+namespace {
+
+typedef tez::wfc_model::grid_t grid_t;
+
+//a rectangular room with a margin of empty tiles.
+grid_t make_sample() {
+    static unsigned const W = 12;
+    static unsigned const H = 10;
+
+    grid_t result(W, H, tez::tile_category::empty);
+
+    for (unsigned y = 1; y < H - 1; ++y) {
+        for (unsigned x = 1; x < W - 1; ++x) {
+            auto const edge = x == 1 || y == 1 || x == W - 2 || y == H - 2;
+
+            result.at(x, y) = edge   ? tez::tile_category::ceiling :
+                              y == 2 ? tez::tile_category::wall :
+                                       tez::tile_category::floor;
+        }
+    }
+
+    return result;
+}
+
+//every n x n window of grid is a pattern of model.
+bool is_locally_similar(tez::wfc_model const& model, grid_t const& grid) {
+    auto const n = model.size();
+
+    for (unsigned y = 0; y + n <= grid.height(); ++y) {
+        for (unsigned x = 0; x + n <= grid.width(); ++x) {
+            bool found = false;
+
+            for (unsigned p = 0; !found && p < model.pattern_count(); ++p) {
+                found = true;
+                for (unsigned j = 0; found && j < n; ++j) {
+                    for (unsigned i = 0; found && i < n; ++i) {
+                        found = model.tile(p, i, j) == grid.at(x + i, y + j);
+                    }
+                }
+            }
+
+            if (!found) return false;
+        }
+    }
+
+    return true;
+}
+
+} //namespace
+
+TEST(Wfc, Model) {
+    auto const sample = make_sample();
+    tez::wfc_model const model(sample, 3);
+
+    ASSERT_LT(0U, model.pattern_count());
+
+    unsigned total = 0;
+    for (unsigned p = 0; p < model.pattern_count(); ++p) {
+        total += model.weight(p);
+    }
+
+    EXPECT_EQ((12U - 2) * (10U - 2), total);
+
+    //if q may be north of p, p may be south of q.
+    auto const has = [&](unsigned p, tez::direction d, unsigned q) {
+        return (model.compatible(p, d)[q / 64] >> (q % 64)) & 1;
+    };
+
+    for (unsigned p = 0; p < model.pattern_count(); ++p) {
+        EXPECT_TRUE(has(p, tez::direction::east, p) ==
+                    has(p, tez::direction::west, p));
+
+        for (unsigned q = 0; q < model.pattern_count(); ++q) {
+            EXPECT_EQ(
+                has(p, tez::direction::north, q),
+                has(q, tez::direction::south, p)
+            );
+            EXPECT_EQ(
+                has(p, tez::direction::east, q),
+                has(q, tez::direction::west, p)
+            );
+        }
+    }
+}
+
+TEST(Wfc, Solve) {
+    auto const sample = make_sample();
+    tez::wfc_model const model(sample, 3);
+
+    bklib::random_engine random(1984);
+
+    for (int i = 0; i < 5; ++i) {
+        tez::wfc_solver solver(model, 20, 16);
+        ASSERT_TRUE(solver.run(random));
+
+        auto const result = solver.result();
+        EXPECT_EQ(20U, result.width());
+        EXPECT_EQ(16U, result.height());
+        EXPECT_TRUE(is_locally_similar(model, result));
+    }
+}
+
+TEST(Wfc, Constrain) {
+    auto const sample = make_sample();
+    tez::wfc_model const model(sample, 3);
+
+    tez::wfc_solver solver(model, 16, 16);
+
+    //only patterns with a floor in the middle at the centre.
+    ASSERT_TRUE(solver.constrain(7, 7, [&](unsigned p) {
+        return model.tile(p, 1, 1) == tez::tile_category::floor;
+    }));
+
+    bklib::random_engine random(7);
+    ASSERT_TRUE(solver.run(random));
+
+    EXPECT_EQ(tez::tile_category::floor, solver.result().at(8, 8));
+
+    //nothing is allowed: no solution.
+    tez::wfc_solver none(model, 16, 16);
+    EXPECT_FALSE(none.constrain(3, 3, [](unsigned) { return false; }));
+}
+
+TEST(Wfc, Generator) {
+    tez::wfc_params params;
+    params.width  = 20;
+    params.height = 14;
+
+    auto gen_a = tez::wfc_room_generator(
+        bklib::random_engine(3), make_sample(), params
+    );
+    auto gen_b = tez::wfc_room_generator(
+        bklib::random_engine(3), make_sample(), params
+    );
+
+    for (int i = 0; i < 5; ++i) {
+        auto const a = gen_a.generate();
+        auto const b = gen_b.generate();
+
+        ASSERT_EQ(params.width,  a.width());
+        ASSERT_EQ(params.height, a.height());
+
+        for (unsigned y = 0; y < a.height(); ++y) {
+            for (unsigned x = 0; x < a.width(); ++x) {
+                EXPECT_EQ(a.at(x, y), b.at(x, y));
+
+                auto const edge = x == 0 || y == 0 ||
+                    x == a.width() - 1 || y == a.height() - 1;
+                if (edge) {
+                    EXPECT_EQ(tez::tile_category::empty, a.at(x, y));
+                }
+            }
+        }
+    }
+}
+
+TEST(Wfc, GeneratorFallback) {
+    //no empty tiles, so no pattern fits the border.
+    auto const sample = grid_t(6, 6, tez::tile_category::floor);
+
+    auto gen = tez::wfc_room_generator(bklib::random_engine(1), sample);
+    auto const room = gen.generate();
+
+    EXPECT_EQ(6U, room.width());
+    EXPECT_EQ(6U, room.height());
+}
+
+//==============================================================================
+//! Cells per second solving 64 x 64 and 256 x 256 outputs, from a
+//! rectangular and a compound room sample.
+//!
+//! tez_tests --gtest_filter=Wfc.DISABLED_Throughput
+//!           --gtest_also_run_disabled_tests
+//==============================================================================
+TEST(Wfc, DISABLED_Throughput) {
+    typedef std::chrono::steady_clock clock;
+
+    auto const compound = tez::compound_room_generator(
+        bklib::random_engine(1984)
+    ).generate();
+
+    grid_t compound_sample(compound.width(), compound.height());
+    for (unsigned y = 0; y < compound.height(); ++y) {
+        for (unsigned x = 0; x < compound.width(); ++x) {
+            compound_sample.at(x, y) = compound.at(x, y);
+        }
+    }
+
+    struct sample_t {
+        char const* name;
+        grid_t      grid;
+    } const samples[] = {
+        {"rectangular", make_sample()},
+        {"compound",    std::move(compound_sample)},
+    };
+
+    unsigned const sizes[] = {64, 256};
+
+    for (auto const& sample : samples) {
+        tez::wfc_model const model(sample.grid, 3);
+
+        for (auto const size : sizes) {
+            static unsigned const RUNS = 4;
+
+            bklib::random_engine random(1);
+            unsigned solved = 0;
+
+            auto const start = clock::now();
+
+            for (unsigned i = 0; i < RUNS; ++i) {
+                tez::wfc_solver solver(model, size, size);
+                if (solver.run(random)) solved++;
+            }
+
+            std::chrono::duration<double> const time = clock::now() - start;
+
+            auto const cells = static_cast<double>(RUNS) *
+                (size - model.size() + 1) * (size - model.size() + 1);
+
+            std::cout << sample.name << " ("
+                      << model.pattern_count() << " patterns) "
+                      << size << "x" << size << ": "
+                      << static_cast<uint64_t>(cells / time.count())
+                      << " cells/s, " << solved << "/" << RUNS << " solved\n";
+
+            EXPECT_LT(0U, solved);
+        }
+    }
+}
@@ -0,0 +1,262 @@
+#include "pch.hpp"
+#include "tez/world_map.hpp"
+#include "tez/map_batch.hpp"
+#include "tez/room_generator.hpp"
+
+#include <gtest/gtest.h>
+
+#include <fstream>
+#include <cstdio>
+
+namespace {
+
+char const FILENAME[] = "test_world_map.tezworld";
+
+tez::world_cache_params cache(unsigned const resident, bool const prefetch) {
+    tez::world_cache_params result;
+    result.resident = resident;
+    result.prefetch = prefetch;
+    return result;
+}
+
+uint64_t tag(unsigned const x, unsigned const y) {
+    return (static_cast<uint64_t>(x) << 32) | y;
+}
+
+//! The chunk statistics of reading every tile of @p w a row at a time.
+tez::world_cache_stats scan_rows(tez::world_map const& w) {
+    uint64_t sum = 0;
+
+    for (unsigned y = 0; y < w.height(); ++y) {
+        for (unsigned x = 0; x < w.width(); ++x) {
+            sum += w.at(x, y).data;
+        }
+    }
+
+    EXPECT_EQ(0u, sum);
+    return w.stats();
+}
+
+} //namespace
+
+TEST(WorldMap, RoundTrip) {
+    {
+        tez::world_map w(FILENAME, 200, 150, 16, cache(4, true));
+
+        EXPECT_EQ(200u, w.width());
+        EXPECT_EQ(150u, w.height());
+        EXPECT_EQ(16u,  w.chunk_size());
+
+        for (unsigned y = 0; y < w.height(); ++y) {
+            for (unsigned x = 0; x < w.width(); ++x) {
+                w.at(x, y).data = tag(x, y);
+            }
+        }
+
+        //memory stays bounded; the rest went to the file.
+        EXPECT_LE(w.resident_count(), 4u);
+        EXPECT_LT(0u, w.stats().evictions);
+        EXPECT_LT(0u, w.stats().write_backs);
+
+        w.flush();
+    }
+
+    {
+        tez::world_map const w(FILENAME, cache(4, true));
+
+        EXPECT_EQ(200u, w.width());
+        EXPECT_EQ(150u, w.height());
+
+        //by columns, against the order written.
+        bool same = true;
+        for (unsigned x = 0; x < w.width(); ++x) {
+            for (unsigned y = 0; y < w.height(); ++y) {
+                same &= w.at(x, y).data == tag(x, y);
+                same &= w.room_at(x, y) == tez::world_map::NO_ROOM;
+            }
+        }
+
+        EXPECT_TRUE(same);
+    }
+
+    std::remove(FILENAME);
+}
+
+TEST(WorldMap, Untouched) {
+    {
+        tez::world_map w(FILENAME, 100, 100, 8, cache(2, false));
+        w.at(99, 99).data = 1;
+    } //written back on destruction.
+
+    tez::world_map const w(FILENAME);
+
+    EXPECT_EQ(1u, w.at(99, 99).data);
+    EXPECT_EQ(tez::tile_category::empty, w.at(0, 0).type);
+    EXPECT_EQ(0u, w.at(50, 50).data);
+    EXPECT_EQ(tez::world_map::NO_ROOM, w.room_at(50, 50));
+
+    std::remove(FILENAME);
+}
+
+TEST(WorldMap, MatchesMap) {
+    bklib::random_engine random(1984);
+    auto gen = tez::simple_room_generator(random);
+
+    tez::room room_a = gen.generate();
+    tez::room room_b = gen.generate();
+    room_b.translate_to(room_a.width() + 1, 3);
+
+    tez::map m(40, 30);
+    EXPECT_EQ(1, m.add_room(room_a));
+    EXPECT_EQ(2, m.add_room(room_b, 2, 1));
+
+    {
+        tez::world_map w(FILENAME, 40, 30, 4, cache(3, true));
+        EXPECT_EQ(1, w.add_room(room_a));
+        EXPECT_EQ(2, w.add_room(room_b, 2, 1));
+        EXPECT_EQ(2u, w.room_count());
+
+        for (unsigned y = 0; y < m.height(); ++y) {
+            for (unsigned x = 0; x < m.width(); ++x) {
+                ASSERT_EQ(m.at(x, y).type, w.at(x, y).type);
+                ASSERT_EQ(m.room_at(x, y), w.room_at(x, y));
+            }
+        }
+
+        //blocks, edges and corners included.
+        auto const same = [](tez::tile_data const* a, tez::tile_data const* b) {
+            return a == nullptr
+                ? b == nullptr
+                : b != nullptr && a->type == b->type;
+        };
+
+        for (unsigned y = 0; y < m.height(); ++y) {
+            for (unsigned x = 0; x < m.width(); ++x) {
+                auto const a = m.block_at(x, y);
+                auto const b = w.block_at(x, y);
+
+                ASSERT_TRUE(same(a.here(),       b.here()));
+                ASSERT_TRUE(same(a.north(),      b.north()));
+                ASSERT_TRUE(same(a.south(),      b.south()));
+                ASSERT_TRUE(same(a.east(),       b.east()));
+                ASSERT_TRUE(same(a.west(),       b.west()));
+                ASSERT_TRUE(same(a.north_east(), b.north_east()));
+                ASSERT_TRUE(same(a.north_west(), b.north_west()));
+                ASSERT_TRUE(same(a.south_east(), b.south_east()));
+                ASSERT_TRUE(same(a.south_west(), b.south_west()));
+            }
+        }
+    }
+
+    //the room count is kept.
+    tez::world_map const w(FILENAME);
+    EXPECT_EQ(2u, w.room_count());
+
+    std::remove(FILENAME);
+}
+
+TEST(WorldMap, Corridors) {
+    bklib::random_engine random(1984);
+    auto gen = tez::simple_room_generator(random);
+
+    tez::room room_a = gen.generate();
+    tez::room room_b = gen.generate();
+    room_a.translate_to(4, 14);
+    room_b.translate_to(30, 12); //level with room_a, to its east.
+
+    tez::map m(60, 40);
+    m.add_room(room_a);
+    m.add_room(room_b);
+
+    {
+        //small chunks, so that the corridors cross several.
+        tez::world_map w(FILENAME, 60, 40, 8, cache(3, true));
+        w.add_room(room_a);
+        w.add_room(room_b);
+
+        auto const is_a = [&](tez::path_generator::point_t const p) {
+            return m.room_at(p) == 1;
+        };
+
+        tez::path_generator pm(bklib::random_engine(7));
+        tez::path_generator pw(bklib::random_engine(7));
+
+        //the random walks draw and read the same.
+        unsigned walks = 0;
+
+        for (unsigned i = 0; i < 40; ++i) {
+            auto const dir =
+                static_cast<tez::direction>(i % tez::NUM_CARDINAL_DIR);
+
+            auto const found = pm.generate(room_a, m, dir);
+            ASSERT_EQ(found, pw.generate(room_a, w, dir));
+            EXPECT_TRUE(pm.path() == pw.path());
+
+            if (found) {
+                pm.write_path(m);
+                pw.write_path(w);
+                walks++;
+            }
+        }
+
+        EXPECT_LT(0u, walks);
+
+        //and so do the searches.
+        ASSERT_TRUE(pm.route(room_b, m, is_a));
+        ASSERT_TRUE(pw.route(room_b, w, is_a));
+        EXPECT_TRUE(pm.path() == pw.path());
+
+        pm.write_path(m);
+        pw.write_path(w);
+
+        for (unsigned y = 0; y < m.height(); ++y) {
+            for (unsigned x = 0; x < m.width(); ++x) {
+                ASSERT_EQ(m.at(x, y).type, w.at(x, y).type);
+                ASSERT_EQ(m.at(x, y).data, w.at(x, y).data);
+            }
+        }
+
+        EXPECT_LT(0u, w.stats().evictions);
+    }
+
+    std::remove(FILENAME);
+}
+
+TEST(WorldMap, Prefetch) {
+    { tez::world_map w(FILENAME, 256, 64, 16); }
+
+    tez::world_map const plain(FILENAME, cache(4, false));
+    auto const a = scan_rows(plain);
+
+    tez::world_map const ahead(FILENAME, cache(4, true));
+    auto const b = scan_rows(ahead);
+
+    EXPECT_EQ(0u, a.prefetches);
+    EXPECT_EQ(a.lookups, b.lookups);
+
+    //reading ahead along the rows turns most misses into hits.
+    EXPECT_LT(0u, b.prefetch_hits);
+    EXPECT_LT(b.misses * 4, a.misses);
+
+    std::remove(FILENAME);
+}
+
+TEST(WorldMap, Rejects) {
+    EXPECT_THROW(
+        tez::world_map("no/such/world.tezworld"), tez::bad_world_file
+    );
+
+    EXPECT_THROW(
+        tez::world_map(FILENAME, 10, 10, 12), tez::bad_world_file
+    );
+
+    {
+        std::ofstream out(FILENAME, std::ios::binary | std::ios::trunc);
+        out << "not a world file, but long enough to hold a world header; "
+               "or so it would seem.";
+    }
+
+    EXPECT_THROW(tez::world_map w(FILENAME), tez::bad_world_file);
+
+    std::remove(FILENAME);
+}
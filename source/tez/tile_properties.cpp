@@ -0,0 +1,195 @@
+#include "pch.hpp"
+#include "tile_properties.hpp"
+
+#include <boost/preprocessor/repetition/enum.hpp>
+#include <boost/property_tree/ptree.hpp>
+#include <boost/property_tree/json_parser.hpp>
+
+#include <fstream>
+
+namespace {
+
+namespace pt   = boost::property_tree;
+namespace flag = tez::tile_flag;
+
+using tez::tile_category;
+using tez::tile_property;
+using tez::TILE_PROPERTY_COUNT;
+
+//==============================================================================
+//! The categories with their compiled in flags and atlas index.
+//==============================================================================
+#define TEZ_TILE_CATEGORIES(X) \
+    X(empty,    flag::pathable,                       0) \
+    X(wall,     flag::opaque,                         2) \
+    X(ceiling,  flag::opaque | flag::connectable,    24) \
+    X(floor,    flag::passable,                       1) \
+    X(pit,      0,                                    0) \
+    X(water,    flag::passable,                       0) \
+    X(door,     flag::passable | flag::opening,      32) \
+    X(corridor, flag::passable | flag::pathable,     20)
+
+//==============================================================================
+//! The compiled in properties of the tile_category with value C; nothing for
+//! values that are not a category.
+//==============================================================================
+template <unsigned C>
+struct default_property {
+    static uint8_t const flags = 0;
+    static uint8_t const atlas = 0;
+};
+
+#define TEZ_DEFAULT_PROPERTY(category, f, a)               \
+    template <>                                            \
+    struct default_property<                               \
+        static_cast<unsigned>(tile_category::category)     \
+    > {                                                    \
+        static uint8_t const flags = (f);                  \
+        static uint8_t const atlas = (a);                  \
+    };
+
+TEZ_TILE_CATEGORIES(TEZ_DEFAULT_PROPERTY)
+
+#undef TEZ_DEFAULT_PROPERTY
+
+//! The table is built by the compiler; there is no code to run at start up.
+#define TEZ_PROPERTY_ENTRY(z, n, unused) \
+    {default_property<n>::flags, default_property<n>::atlas}
+
+tile_property const default_properties[TILE_PROPERTY_COUNT] = {
+    BOOST_PP_ENUM(256, TEZ_PROPERTY_ENTRY, ~)
+};
+
+//==============================================================================
+//! The names used by tile_types.def.
+//==============================================================================
+struct category_name {
+    char const*   name;
+    tile_category type;
+};
+
+#define TEZ_CATEGORY_NAME(category, f, a) \
+    {#category, tile_category::category},
+
+category_name const category_names[] = {
+    TEZ_TILE_CATEGORIES(TEZ_CATEGORY_NAME)
+};
+
+#undef TEZ_CATEGORY_NAME
+
+struct flag_name {
+    char const* name;
+    uint8_t     bit;
+};
+
+flag_name const flag_names[] = {
+    {"passable",    flag::passable},
+    {"opaque",      flag::opaque},
+    {"pathable",    flag::pathable},
+    {"connectable", flag::connectable},
+    {"opening",     flag::opening},
+};
+
+void fail(std::string const& name) {
+    BOOST_THROW_EXCEPTION(
+        tez::bad_tile_types() << tez::tile_type_name_info(name)
+    );
+}
+
+tile_category find_category(std::string const& name) {
+    auto const beg = std::begin(category_names);
+    auto const end = std::end(category_names);
+
+    auto const it = std::find_if(beg, end, [&](category_name const& c) {
+        return name == c.name;
+    });
+
+    if (it == end) fail(name);
+    return it->type;
+}
+
+//==============================================================================
+//! Apply the entry for one category to @p out.
+//==============================================================================
+void read_entry(
+    pt::ptree const&   entry,
+    std::string const& name,
+    tile_property&     out
+) {
+    for (auto const& f : flag_names) {
+        auto const node = entry.get_child_optional(f.name);
+        if (!node) continue;
+
+        auto const value = node->get_value_optional<bool>();
+        if (!value) fail(name + "." + f.name);
+
+        out.flags = *value ? (out.flags | f.bit) : (out.flags & ~f.bit);
+    }
+
+    auto const atlas = entry.get_child_optional("atlas");
+    if (atlas) {
+        auto const value = atlas->get_value_optional<unsigned>();
+        if (!value || *value > 0xFF) fail(name + ".atlas");
+
+        out.atlas = static_cast<uint8_t>(*value);
+    }
+}
+
+} //namespace
+
+tez::tile_property tez::detail::tile_properties[TILE_PROPERTY_COUNT] = {
+    BOOST_PP_ENUM(256, TEZ_PROPERTY_ENTRY, ~)
+};
+
+#undef TEZ_PROPERTY_ENTRY
+#undef TEZ_TILE_CATEGORIES
+
+void tez::load_tile_types(std::istream& in) {
+    pt::ptree tree;
+
+    try {
+        pt::read_json(in, tree);
+    } catch (pt::json_parser_error const& e) {
+        BOOST_THROW_EXCEPTION(
+            bad_tile_types()
+                << tile_type_name_info(e.message())
+                << boost::errinfo_at_line(static_cast<int>(e.line()))
+        );
+    }
+
+    //all or nothing.
+    tile_property result[TILE_PROPERTY_COUNT];
+    std::copy_n(detail::tile_properties, TILE_PROPERTY_COUNT, result);
+
+    for (auto const& entry : tree) {
+        auto const type = find_category(entry.first);
+        auto&      out  = result[static_cast<uint8_t>(type)];
+
+        read_entry(entry.second, entry.first, out);
+    }
+
+    std::copy_n(result, TILE_PROPERTY_COUNT, detail::tile_properties);
+}
+
+void tez::load_tile_types(std::string const& filename) {
+    std::ifstream in(filename);
+
+    if (!in) {
+        BOOST_THROW_EXCEPTION(
+            bad_tile_types() << boost::errinfo_file_name(filename)
+        );
+    }
+
+    try {
+        load_tile_types(in);
+    } catch (bad_tile_types& e) {
+        e << boost::errinfo_file_name(filename);
+        throw;
+    }
+}
+
+void tez::reset_tile_properties() {
+    std::copy_n(
+        default_properties, TILE_PROPERTY_COUNT, detail::tile_properties
+    );
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include "bklib/util.hpp"
+
+#include "tile_category.hpp"
+
+#include <boost/exception/all.hpp>
+
+#include <string>
+#include <iosfwd>
+#include <cstdint>
+
+namespace tez {
+
+//==============================================================================
+//! Bits of tile_property::flags.
+//==============================================================================
+namespace tile_flag {
+    static uint8_t const passable    = 1 << 0; //!< Can be walked on.
+    static uint8_t const opaque      = 1 << 1; //!< Blocks sight.
+    static uint8_t const pathable    = 1 << 2; //!< A corridor may pass.
+    static uint8_t const connectable = 1 << 3; //!< A corridor may end here.
+    static uint8_t const opening     = 1 << 4; //!< A door; no corridor beside.
+}
+
+//==============================================================================
+//! What a tile_category is, as far as generation and rendering care.
+//==============================================================================
+struct tile_property {
+    uint8_t flags; //!< tile_flag bits.
+    uint8_t atlas; //!< Index of the tile's image in the render atlas.
+};
+
+static unsigned const TILE_PROPERTY_COUNT = 256;
+
+namespace detail {
+    //! By tile_category value; the compiled in defaults until overridden.
+    extern tile_property tile_properties[TILE_PROPERTY_COUNT];
+}
+
+inline tile_property const& tile_properties(tile_category const type) {
+    return detail::tile_properties[static_cast<uint8_t>(type)];
+}
+
+//==============================================================================
+//! Whether @p type has any of the tile_flag bits in @p flags.
+//==============================================================================
+inline bool has_tile_flag(tile_category const type, uint8_t const flags) {
+    return (tile_properties(type).flags & flags) != 0;
+}
+
+inline unsigned tile_atlas_index(tile_category const type) {
+    return tile_properties(type).atlas;
+}
+
+//==============================================================================
+//! Thrown when tile_types.def cannot be read or names an unknown category.
+//==============================================================================
+struct bad_tile_types : virtual boost::exception, virtual std::exception {};
+
+//! The name of the offending entry, e.g. "floor.atlas".
+typedef boost::error_info<struct tag_tile_type_name, std::string>
+    tile_type_name_info;
+
+//==============================================================================
+//! Override the properties of the categories in the JSON of tile_types.def;
+//! values it leaves out are unchanged. Nothing changes if it throws.
+//!
+//! @remark Not to be called while anything reads the properties.
+//! @throws bad_tile_types
+//==============================================================================
+void load_tile_types(std::istream& in);
+void load_tile_types(std::string const& filename);
+
+//==============================================================================
+//! Restore the compiled in properties.
+//==============================================================================
+void reset_tile_properties();
+
+} //namespace tez
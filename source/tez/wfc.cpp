@@ -0,0 +1,537 @@
+#include "pch.hpp"
+#include "wfc.hpp"
+
+#include <cmath>
+#include <string>
+#include <unordered_map>
+
+namespace {
+
+typedef tez::wfc_model::word_t word_t;
+
+//==============================================================================
+//! The index of the lowest set bit of @p x; de Bruijn multiplication.
+//! @pre x != 0.
+//==============================================================================
+inline unsigned lowest_bit(word_t const x) {
+    static word_t   const DEBRUIJN = 0x03F79D71B4CB0A89ull;
+    static unsigned const TABLE[64] = {
+         0,  1, 48,  2, 57, 49, 28,  3, 61, 58, 50, 42, 38, 29, 17,  4,
+        62, 55, 59, 36, 53, 51, 43, 22, 45, 39, 33, 30, 24, 18, 12,  5,
+        63, 47, 56, 27, 60, 41, 37, 16, 54, 35, 52, 21, 44, 32, 23, 11,
+        46, 26, 40, 15, 34, 20, 31, 10, 25, 14, 19,  9, 13,  8,  7,  6
+    };
+
+    return TABLE[((x & (0 - x)) * DEBRUIJN) >> 58];
+}
+
+//==============================================================================
+//! Call f(index) for every set bit of the @p words words at @p mask.
+//==============================================================================
+template <typename F>
+inline void for_each_bit(word_t const* mask, unsigned const words, F f) {
+    for (unsigned i = 0; i < words; ++i) {
+        for (auto bits = mask[i]; bits; bits &= bits - 1) {
+            f(i * tez::wfc_model::BITS + lowest_bit(bits));
+        }
+    }
+}
+
+} //namespace
+
+//==============================================================================
+tez::wfc_model::wfc_model(grid_t const& sample, unsigned const n)
+    : n_(n)
+    , words_(0)
+{
+    BK_ASSERT(n > 0);
+    BK_ASSERT(sample.width() >= n && sample.height() >= n);
+
+    //--------------------------------------------------------------------------
+    // Every n x n window of the sample, counted.
+    //--------------------------------------------------------------------------
+    std::unordered_map<std::string, unsigned> index;
+    std::string key(n*n, '\0');
+
+    for (unsigned y = 0; y + n <= sample.height(); ++y) {
+        for (unsigned x = 0; x + n <= sample.width(); ++x) {
+            for (unsigned j = 0; j < n; ++j) {
+                for (unsigned i = 0; i < n; ++i) {
+                    key[j*n + i] = static_cast<char>(sample.at(x + i, y + j));
+                }
+            }
+
+            auto const it = index.find(key);
+            if (it != index.end()) {
+                weights_[it->second]++;
+                continue;
+            }
+
+            index.emplace(key, static_cast<unsigned>(weights_.size()));
+            weights_.push_back(1);
+
+            for (auto const c : key) {
+                tiles_.push_back(static_cast<tile_category>(c));
+            }
+        }
+    }
+
+    //--------------------------------------------------------------------------
+    // q may sit one step from p toward side d if they agree where they overlap.
+    //--------------------------------------------------------------------------
+    BK_DECLARE_DIRECTION_ARRAYS(dx, dy);
+
+    auto const count = pattern_count();
+    words_ = (count + BITS - 1) / BITS;
+    compatible_.assign(count * NUM_CARDINAL_DIR * words_, 0);
+
+    auto const agree = [&](unsigned p, unsigned q, signed ox, signed oy) {
+        for (signed y = 0; y < static_cast<signed>(n); ++y) {
+            for (signed x = 0; x < static_cast<signed>(n); ++x) {
+                auto const qx = x - ox;
+                auto const qy = y - oy;
+
+                if (qx < 0 || qy < 0 || qx >= static_cast<signed>(n) ||
+                    qy >= static_cast<signed>(n)
+                ) {
+                    continue;
+                }
+
+                if (tile(p, x, y) != tile(q, qx, qy)) return false;
+            }
+        }
+
+        return true;
+    };
+
+    for (unsigned p = 0; p < count; ++p) {
+        for (unsigned d = 0; d < NUM_CARDINAL_DIR; ++d) {
+            auto* const mask = &compatible_[(p*NUM_CARDINAL_DIR + d) * words_];
+
+            for (unsigned q = 0; q < count; ++q) {
+                if (agree(p, q, dx[d], dy[d])) {
+                    mask[q / BITS] |= word_t(1) << (q % BITS);
+                }
+            }
+        }
+    }
+
+    //--------------------------------------------------------------------------
+    // Each subset's union is that of the subset less its lowest member, plus
+    // the lowest member's own sets.
+    //--------------------------------------------------------------------------
+    static unsigned const SUBSETS = 1u << GROUP_BITS;
+
+    auto const groups = words_ * (BITS / GROUP_BITS);
+    auto const stride = side_words_();
+
+    unions_.assign(groups * SUBSETS * stride, 0);
+
+    for (unsigned g = 0; g < groups; ++g) {
+        for (unsigned subset = 1; subset < SUBSETS; ++subset) {
+            auto const p = g*GROUP_BITS + lowest_bit(subset);
+
+            auto* const       out  = &unions_[(g*SUBSETS + subset) * stride];
+            auto const* const rest =
+                &unions_[(g*SUBSETS + (subset & (subset - 1))) * stride];
+
+            std::copy(rest, rest + stride, out);
+            if (p >= count) continue;
+
+            auto const* const own = &compatible_[p * stride];
+            for (unsigned i = 0; i < stride; ++i) {
+                out[i] |= own[i];
+            }
+        }
+    }
+}
+
+//==============================================================================
+tez::wfc_solver::wfc_solver(
+    wfc_model const& model,
+    unsigned  const  width,
+    unsigned  const  height
+)
+    : model_(model)
+    , width_(width)
+    , height_(height)
+    , cols_(width - model.size() + 1)
+    , rows_(height - model.size() + 1)
+    , words_(model.words())
+{
+    BK_ASSERT(width  >= model.size());
+    BK_ASSERT(height >= model.size());
+    BK_ASSERT(model.pattern_count() > 0);
+
+    auto const cells = cols_ * rows_;
+    auto const count = model.pattern_count();
+
+    std::vector<word_t> all(words_, 0);
+    for (unsigned p = 0; p < count; ++p) {
+        all[p / wfc_model::BITS] |= word_t(1) << (p % wfc_model::BITS);
+    }
+
+    cells_.reserve(cells * words_);
+    for (unsigned i = 0; i < cells; ++i) {
+        cells_.insert(cells_.end(), all.begin(), all.end());
+    }
+
+    cell_info full = {count, 0.0, 0.0};
+
+    weight_log_weight_.reserve(count);
+    for (unsigned p = 0; p < count; ++p) {
+        auto const w = static_cast<double>(model.weight(p));
+        weight_log_weight_.push_back(w * std::log(w));
+
+        full.weight            += w;
+        full.weight_log_weight += weight_log_weight_.back();
+    }
+
+    info_.assign(cells, full);
+    versions_.assign(cells, 0);
+    noise_.assign(cells, 0.0);
+    allowed_.assign(NUM_CARDINAL_DIR * words_, 0);
+}
+
+double tez::wfc_solver::entropy_(uint32_t const cell) const {
+    auto const& info = info_[cell];
+
+    return std::log(info.weight) - info.weight_log_weight / info.weight +
+           noise_[cell];
+}
+
+//==============================================================================
+void tez::wfc_solver::save_(uint32_t const cell) {
+    auto const mask = cell_(cell);
+
+    trail_cells_.push_back(cell);
+    trail_words_.insert(trail_words_.end(), mask, mask + words_);
+    trail_info_.push_back(info_[cell]);
+}
+
+void tez::wfc_solver::changed_(uint32_t const cell) {
+    static size_t const MAX_STALE = 4;
+
+    versions_[cell]++;
+    pending_.push_back(cell);
+
+    if (count_(cell) < 2) return;
+
+    heap_entry const entry = {entropy_(cell), cell, versions_[cell]};
+    heap_.push_back(entry);
+    std::push_heap(heap_.begin(), heap_.end());
+
+    //most entries are stale by now.
+    if (heap_.size() > MAX_STALE * versions_.size()) {
+        rebuild_heap_();
+    }
+}
+
+void tez::wfc_solver::rebuild_heap_() {
+    heap_.clear();
+
+    for (uint32_t cell = 0; cell < versions_.size(); ++cell) {
+        if (count_(cell) < 2) continue;
+
+        heap_entry const entry = {entropy_(cell), cell, versions_[cell]};
+        heap_.push_back(entry);
+    }
+
+    std::make_heap(heap_.begin(), heap_.end());
+}
+
+void tez::wfc_solver::forget_(unsigned const budget) {
+    //no more than budget choices can be undone; keep one more to be safe.
+    auto const keep = static_cast<size_t>(budget) + 1;
+
+    //in batches, so the cost is spread out.
+    if (decisions_.size() < 2 * keep) return;
+
+    auto const drop = decisions_.size() - keep;
+    auto const mark = decisions_[drop].trail_mark;
+
+    trail_cells_.erase(trail_cells_.begin(), trail_cells_.begin() + mark);
+    trail_info_.erase(trail_info_.begin(), trail_info_.begin() + mark);
+    trail_words_.erase(
+        trail_words_.begin(), trail_words_.begin() + mark * words_
+    );
+
+    decisions_.erase(decisions_.begin(), decisions_.begin() + drop);
+    for (auto& d : decisions_) {
+        d.trail_mark -= mark;
+    }
+}
+
+void tez::wfc_solver::restore_base_() {
+    cells_ = base_cells_;
+    info_  = base_info_;
+
+    trail_cells_.clear();
+    trail_words_.clear();
+    trail_info_.clear();
+    decisions_.clear();
+    pending_.clear();
+
+    for (auto& v : versions_) {
+        ++v;
+    }
+
+    rebuild_heap_();
+}
+
+void tez::wfc_solver::undo_(size_t const mark) {
+    while (trail_cells_.size() > mark) {
+        auto const cell = trail_cells_.back();
+        auto const last = trail_words_.end();
+
+        std::copy(last - words_, last, cell_(cell));
+        info_[cell] = trail_info_.back();
+
+        trail_cells_.pop_back();
+        trail_words_.resize(trail_words_.size() - words_);
+        trail_info_.pop_back();
+
+        changed_(cell);
+    }
+
+    pending_.clear();
+}
+
+//==============================================================================
+void tez::wfc_solver::remove_(
+    uint32_t const cell,
+    unsigned const word,
+    word_t   const bits
+) {
+    auto& info = info_[cell];
+
+    for (auto b = bits; b; b &= b - 1) {
+        auto const p = word * wfc_model::BITS + lowest_bit(b);
+
+        info.count--;
+        info.weight            -= model_.weight(p);
+        info.weight_log_weight -= weight_log_weight_[p];
+    }
+
+    cell_(cell)[word] &= ~bits;
+}
+
+void tez::wfc_solver::ban_(uint32_t const cell, unsigned const pattern) {
+    if (!has_(cell_(cell), pattern)) return;
+
+    save_(cell);
+    remove_(cell, pattern / wfc_model::BITS,
+        word_t(1) << (pattern % wfc_model::BITS)
+    );
+    changed_(cell);
+}
+
+void tez::wfc_solver::collapse_(uint32_t const cell, unsigned const pattern) {
+    auto const mask = cell_(cell);
+
+    save_(cell);
+
+    std::fill_n(mask, words_, 0);
+    mask[pattern / wfc_model::BITS] = word_t(1) << (pattern % wfc_model::BITS);
+
+    cell_info const info = {
+        1,
+        static_cast<double>(model_.weight(pattern)),
+        weight_log_weight_[pattern]
+    };
+    info_[cell] = info;
+
+    changed_(cell);
+}
+
+bool tez::wfc_solver::propagate_() {
+    BK_DECLARE_DIRECTION_ARRAYS(dx, dy);
+
+    while (!pending_.empty()) {
+        auto const cell = pending_.back();
+        pending_.pop_back();
+
+        auto const mask = cell_(cell);
+        if (count_(cell) == 0) {
+            stats_.contradictions++;
+            pending_.clear();
+            return false;
+        }
+
+        auto const x = cell % cols_;
+        auto const y = cell / cols_;
+
+        //the union of what each remaining pattern allows on each side, eight
+        //patterns at a time.
+        static unsigned const GROUP_BITS = wfc_model::GROUP_BITS;
+        static unsigned const GROUPS     = wfc_model::BITS / GROUP_BITS;
+        static word_t   const GROUP_MASK = (1u << GROUP_BITS) - 1;
+
+        std::fill(allowed_.begin(), allowed_.end(), 0);
+        for (unsigned w = 0; w < words_; ++w) {
+            for (unsigned g = 0; g < GROUPS; ++g) {
+                auto const subset = static_cast<unsigned>(
+                    (mask[w] >> (g * GROUP_BITS)) & GROUP_MASK
+                );
+                if (!subset) continue;
+
+                auto const* const u =
+                    model_.compatible_union(w*GROUPS + g, subset);
+
+                for (size_t i = 0; i < allowed_.size(); ++i) {
+                    allowed_[i] |= u[i];
+                }
+            }
+        }
+
+        for (unsigned d = 0; d < NUM_CARDINAL_DIR; ++d) {
+            auto const nx = x + dx[d];
+            auto const ny = y + dy[d];
+            if (nx >= cols_ || ny >= rows_) continue; //also wraps below 0.
+
+            auto const  neighbour = ny*cols_ + nx;
+            auto const  target    = cell_(neighbour);
+            auto const* allowed   = &allowed_[d * words_];
+
+            bool changed = false;
+            for (unsigned i = 0; i < words_; ++i) {
+                changed |= (target[i] & ~allowed[i]) != 0;
+            }
+
+            if (!changed) continue;
+
+            save_(neighbour);
+            for (unsigned i = 0; i < words_; ++i) {
+                remove_(neighbour, i, target[i] & ~allowed[i]);
+            }
+
+            stats_.propagations++;
+            changed_(neighbour);
+        }
+    }
+
+    return true;
+}
+
+//==============================================================================
+bool tez::wfc_solver::backtrack_(unsigned& budget) {
+    while (!decisions_.empty() && budget > 0) {
+        budget--;
+        stats_.backtracks++;
+
+        auto const last = decisions_.back();
+        decisions_.pop_back();
+
+        //the ban belongs to the choice before, and is undone along with it.
+        undo_(last.trail_mark);
+        ban_(last.cell, last.pattern);
+
+        if (propagate_()) return true;
+    }
+
+    return false;
+}
+
+bool tez::wfc_solver::next_cell_(uint32_t& cell) {
+    while (!heap_.empty()) {
+        std::pop_heap(heap_.begin(), heap_.end());
+        auto const top = heap_.back();
+        heap_.pop_back();
+
+        if (top.version != versions_[top.cell]) continue;
+        if (count_(top.cell) < 2) continue;
+
+        cell = top.cell;
+        return true;
+    }
+
+    return false;
+}
+
+unsigned tez::wfc_solver::choose_(uint32_t const cell, random_t& random) const {
+    auto const mask = cell_(cell);
+
+    uint32_t total = 0;
+    for_each_bit(mask, words_, [&](unsigned const p) {
+        total += model_.weight(p);
+    });
+
+    auto roll   = bklib::random_bounded(random, total);
+    auto result = 0u;
+
+    for (unsigned p = 0; p < model_.pattern_count(); ++p) {
+        if (!has_(mask, p)) continue;
+
+        result = p;
+        if (roll < model_.weight(p)) break;
+        roll -= model_.weight(p);
+    }
+
+    return result;
+}
+
+bool tez::wfc_solver::run(
+    random_t&      random,
+    unsigned const max_backtracks,
+    unsigned const max_restarts
+) {
+    auto const cells = cols_ * rows_;
+
+    for (uint32_t cell = 0; cell < cells; ++cell) {
+        if (count_(cell) == 0) return false;
+        noise_[cell] = bklib::random_u32(random) * (1.0e-6 / 4294967296.0);
+    }
+
+    //the state before now is the base restarts return to.
+    base_cells_ = cells_;
+    base_info_  = info_;
+    restore_base_();
+
+    auto budget = max_backtracks;
+
+    for (uint32_t cell = 0; next_cell_(cell);) {
+        auto const pattern = choose_(cell, random);
+
+        decision const choice = {trail_cells_.size(), cell, pattern};
+        decisions_.push_back(choice);
+        forget_(budget);
+
+        stats_.observations++;
+        collapse_(cell, pattern);
+
+        if (propagate_() || backtrack_(budget)) continue;
+
+        if (stats_.restarts >= max_restarts) return false;
+        stats_.restarts++;
+
+        restore_base_();
+        budget = max_backtracks;
+    }
+
+    return true;
+}
+
+tez::wfc_solver::grid_t tez::wfc_solver::result() const {
+    grid_t out(width_, height_);
+
+    std::vector<unsigned> patterns(cols_ * rows_, 0);
+    for (uint32_t cell = 0; cell < patterns.size(); ++cell) {
+        BK_ASSERT(count_(cell) == 1);
+        for_each_bit(cell_(cell), words_, [&](unsigned const p) {
+            patterns[cell] = p;
+        });
+    }
+
+    for (unsigned y = 0; y < height_; ++y) {
+        auto const cy = bklib::min(y, rows_ - 1);
+
+        for (unsigned x = 0; x < width_; ++x) {
+            auto const cx = bklib::min(x, cols_ - 1);
+            auto const p  = patterns[cy*cols_ + cx];
+
+            out.at(x, y) = model_.tile(p, x - cx, y - cy);
+        }
+    }
+
+    return out;
+}
@@ -0,0 +1,256 @@
+#pragma once
+
+#include "bklib/util.hpp"
+#include "bklib/random.hpp"
+
+#include "grid2d.hpp"
+#include "tile_category.hpp"
+#include "direction.hpp"
+
+#include <vector>
+#include <cstdint>
+
+namespace tez {
+
+//==============================================================================
+//! The n x n patterns of a sample grid and which of them may be placed next to
+//! which (overlapping model).
+//!
+//! Pattern p may have pattern q at an offset of one step toward side d when
+//! the two agree on every tile they overlap; this is precomputed as one bitset
+//! over the patterns for each (p, d), and as the union of those bitsets for
+//! every subset of each group of eight patterns.
+//==============================================================================
+class wfc_model {
+public:
+    typedef grid2d<tile_category> grid_t;
+    typedef uint64_t              word_t;
+
+    static unsigned const BITS       = 64;
+    static unsigned const GROUP_BITS = 8;
+
+    //--------------------------------------------------------------------------
+    //! @param n the pattern size; the sample must be at least n x n.
+    //--------------------------------------------------------------------------
+    explicit wfc_model(grid_t const& sample, unsigned n = 3);
+
+    unsigned size()  const { return n_; }
+    unsigned words() const { return words_; }
+
+    unsigned pattern_count() const {
+        return static_cast<unsigned>(weights_.size());
+    }
+
+    //! The number of times pattern @p p occurs in the sample.
+    unsigned weight(unsigned const p) const {
+        return weights_[p];
+    }
+
+    tile_category tile(unsigned const p, unsigned x, unsigned y) const {
+        BK_ASSERT(x < n_ && y < n_);
+        return tiles_[(p*n_ + y)*n_ + x];
+    }
+
+    //--------------------------------------------------------------------------
+    //! The set of patterns allowed one step from @p p toward @p side; words()
+    //! words.
+    //--------------------------------------------------------------------------
+    word_t const* compatible(unsigned const p, direction const side) const {
+        auto const d = static_cast<unsigned>(side);
+        BK_ASSERT(d < NUM_CARDINAL_DIR);
+
+        return &compatible_[(p*NUM_CARDINAL_DIR + d) * words_];
+    }
+
+    //--------------------------------------------------------------------------
+    //! The union of compatible() over patterns 8*group + i for each bit i set
+    //! in @p subset; words() words for each of the cardinal sides in turn.
+    //--------------------------------------------------------------------------
+    word_t const* compatible_union(
+        unsigned const group,
+        unsigned const subset
+    ) const {
+        BK_ASSERT(subset < (1u << GROUP_BITS));
+        return &unions_[((group << GROUP_BITS) + subset) * side_words_()];
+    }
+private:
+    unsigned side_words_() const { return NUM_CARDINAL_DIR * words_; }
+
+    unsigned n_;
+    unsigned words_;
+
+    std::vector<tile_category> tiles_;      //!< n*n per pattern.
+    std::vector<unsigned>      weights_;
+    std::vector<word_t>        compatible_; //!< words_ per (pattern, side).
+    std::vector<word_t>        unions_;     //!< By (group, subset).
+};
+
+//==============================================================================
+//! Counters for a wfc_solver run.
+//==============================================================================
+struct wfc_stats {
+    wfc_stats()
+        : observations(0)
+        , propagations(0)
+        , contradictions(0)
+        , backtracks(0)
+        , restarts(0)
+    {
+    }
+
+    unsigned observations;   //!< Cells collapsed by choice.
+    unsigned propagations;   //!< Neighbour updates that removed patterns.
+    unsigned contradictions; //!< Cells left with no pattern.
+    unsigned backtracks;     //!< Choices undone.
+    unsigned restarts;       //!< Times the backtracking limit was reached.
+};
+
+//==============================================================================
+//! Wave function collapse over a wfc_model.
+//!
+//! Every cell holds the set of patterns still possible there as a bitset. The
+//! cell of lowest entropy is collapsed to a pattern chosen by weight and the
+//! change propagated to the neighbours. A contradiction undoes the last
+//! choice, bans it, and carries on; past the backtracking limit the solver
+//! starts over. Changes are only kept for as many choices as may still be
+//! undone.
+//!
+//! The pattern at cell (x, y) covers the output tiles (x, y) to
+//! (x + n - 1, y + n - 1).
+//==============================================================================
+class wfc_solver {
+public:
+    typedef wfc_model::grid_t     grid_t;
+    typedef wfc_model::word_t     word_t;
+    typedef bklib::random_engine  random_t;
+
+    static unsigned const DEFAULT_MAX_BACKTRACKS = 64;
+    static unsigned const DEFAULT_MAX_RESTARTS   = 8;
+
+    //--------------------------------------------------------------------------
+    //! @param width, height of the output; at least model.size().
+    //--------------------------------------------------------------------------
+    wfc_solver(wfc_model const& model, unsigned width, unsigned height);
+
+    unsigned width()  const { return width_; }
+    unsigned height() const { return height_; }
+
+    unsigned cell_width()  const { return cols_; }
+    unsigned cell_height() const { return rows_; }
+
+    //--------------------------------------------------------------------------
+    //! Remove the patterns for which keep(pattern) is false from cell
+    //! (@p x, @p y), before run(); kept across restarts.
+    //! @returns false if that leaves the cells without a solution.
+    //--------------------------------------------------------------------------
+    template <typename F>
+    bool constrain(unsigned const x, unsigned const y, F keep) {
+        auto const cell = y*cols_ + x;
+        auto const mask = cell_(cell);
+
+        for (unsigned p = 0; p < model_.pattern_count(); ++p) {
+            if (has_(mask, p) && !keep(p)) ban_(cell, p);
+        }
+
+        return propagate_();
+    }
+
+    //--------------------------------------------------------------------------
+    //! Collapse every cell.
+    //! @returns false if no solution was found within the limits.
+    //--------------------------------------------------------------------------
+    bool run(
+        random_t& random,
+        unsigned  max_backtracks = DEFAULT_MAX_BACKTRACKS,
+        unsigned  max_restarts   = DEFAULT_MAX_RESTARTS
+    );
+
+    //--------------------------------------------------------------------------
+    //! The output tiles. @pre run() returned true.
+    //--------------------------------------------------------------------------
+    grid_t result() const;
+
+    wfc_stats const& stats() const { return stats_; }
+private:
+    struct heap_entry {
+        double   entropy;
+        uint32_t cell;
+        uint32_t version;
+
+        bool operator<(heap_entry const& rhs) const {
+            return entropy > rhs.entropy; //lowest on top.
+        }
+    };
+
+    //--------------------------------------------------------------------------
+    //! Kept up to date as patterns are removed, for the entropy.
+    //--------------------------------------------------------------------------
+    struct cell_info {
+        unsigned count;
+        double   weight;
+        double   weight_log_weight;
+    };
+
+    struct decision {
+        size_t   trail_mark;
+        uint32_t cell;
+        uint32_t pattern;
+    };
+
+    word_t*       cell_(uint32_t cell)       { return &cells_[cell * words_]; }
+    word_t const* cell_(uint32_t cell) const { return &cells_[cell * words_]; }
+
+    static bool has_(word_t const* mask, unsigned p) {
+        return (mask[p / wfc_model::BITS] >> (p % wfc_model::BITS)) & 1;
+    }
+
+    unsigned count_(uint32_t cell) const { return info_[cell].count; }
+    double   entropy_(uint32_t cell) const;
+
+    void save_(uint32_t cell);
+    void changed_(uint32_t cell);
+    void undo_(size_t mark);
+
+    void rebuild_heap_();
+    void forget_(unsigned budget);
+    void restore_base_();
+
+    void remove_(uint32_t cell, unsigned word, word_t bits);
+    void ban_(uint32_t cell, unsigned pattern);
+    void collapse_(uint32_t cell, unsigned pattern);
+    bool propagate_();
+
+    bool     backtrack_(unsigned& budget);
+    bool     next_cell_(uint32_t& cell);
+    unsigned choose_(uint32_t cell, random_t& random) const;
+
+    wfc_model const& model_;
+
+    unsigned width_;
+    unsigned height_;
+    unsigned cols_;
+    unsigned rows_;
+    unsigned words_;
+
+    std::vector<word_t>     cells_;    //!< words_ per cell.
+    std::vector<cell_info>  info_;
+    std::vector<uint32_t>   versions_; //!< Bumped on every change.
+    std::vector<double>     noise_;    //!< Breaks entropy ties.
+    std::vector<heap_entry> heap_;
+    std::vector<uint32_t>   pending_;  //!< Cells to propagate from.
+
+    std::vector<uint32_t>  trail_cells_; //!< Changed cells, oldest first.
+    std::vector<word_t>    trail_words_; //!< Their sets before the change.
+    std::vector<cell_info> trail_info_;
+    std::vector<decision>  decisions_;
+
+    std::vector<word_t>    base_cells_; //!< As run() found them.
+    std::vector<cell_info> base_info_;
+
+    std::vector<double> weight_log_weight_;
+    std::vector<word_t> allowed_; //!< Per side; scratch for propagate_.
+
+    wfc_stats stats_;
+};
+
+} //namespace tez
@@ -0,0 +1,376 @@
+#include "pch.hpp"
+#include "world_map.hpp"
+#include "map_file.hpp"
+
+#include <cstring>
+
+using tez::world_map;
+using tez::world_file_header;
+using tez::world_chunk_header;
+using tez::WORLD_FILE_ALIGN;
+
+namespace {
+
+char const MAGIC[8] = {'T', 'E', 'Z', 'W', 'O', 'R', 'L', 'D'};
+
+static_assert(sizeof(world_file_header) == 64, "header layout changed");
+static_assert(sizeof(world_chunk_header) == 8, "chunk layout changed");
+
+tez::tile_data const default_tile = {
+    tez::tile_category::empty,
+    {0},
+    0, 0, 0,
+    0
+};
+
+unsigned const NO_CHUNK = static_cast<unsigned>(-1);
+
+void fail(char const* const field, std::string const& filename) {
+    BOOST_THROW_EXCEPTION(
+        tez::bad_world_file()
+            << tez::world_file_field_info(field)
+            << boost::errinfo_file_name(filename)
+    );
+}
+
+uint64_t align(uint64_t const offset) {
+    auto const a = WORLD_FILE_ALIGN;
+    return (offset + a - 1) / a * a;
+}
+
+bool is_power_of_two(unsigned const n) {
+    return n != 0 && (n & (n - 1)) == 0;
+}
+
+//! -1, 0 or 1 as @p b is before, at or after @p a, for b within one of a.
+signed step(unsigned const a, unsigned const b) {
+    return b == a + 1 ? 1 : b + 1 == a ? -1 : 0;
+}
+
+} //namespace
+
+world_map::room_id const world_map::NO_ROOM;
+
+world_map::world_map(
+    std::string const& filename,
+    unsigned const     width,
+    unsigned const     height,
+    unsigned const     chunk_size,
+    world_cache_params cache
+)
+    : filename_(filename)
+{
+    if (width == 0 || height == 0)  fail("size", filename_);
+    if (!is_power_of_two(chunk_size)) fail("chunk_size", filename_);
+
+    std::memset(&header_, 0, sizeof(header_));
+    std::memcpy(header_.magic, MAGIC, sizeof(MAGIC));
+
+    header_.version     = WORLD_FILE_VERSION;
+    header_.byte_order  = MAP_FILE_BYTE_ORDER;
+    header_.header_size = sizeof(world_file_header);
+    header_.tile_size   = sizeof(tile_data);
+    header_.width       = width;
+    header_.height      = height;
+    header_.chunk_size  = chunk_size;
+    header_.room_count  = 0;
+
+    file_.open(
+        filename,
+        std::ios::in | std::ios::out | std::ios::binary | std::ios::trunc
+    );
+    if (!file_) fail("open", filename_);
+
+    init_(cache);
+    write_header_();
+}
+
+world_map::world_map(std::string const& filename, world_cache_params cache)
+    : filename_(filename)
+{
+    file_.open(filename, std::ios::in | std::ios::out | std::ios::binary);
+    if (!file_) fail("open", filename_);
+
+    file_.read(reinterpret_cast<char*>(&header_), sizeof(header_));
+    if (!file_) fail("size", filename_);
+
+    auto const check = [&](bool const ok, char const* const field) {
+        if (!ok) fail(field, filename_);
+    };
+
+    check(std::memcmp(header_.magic, MAGIC, sizeof(MAGIC)) == 0, "magic");
+    check(header_.version     == WORLD_FILE_VERSION,        "version");
+    check(header_.byte_order  == MAP_FILE_BYTE_ORDER,       "byte_order");
+    check(header_.header_size == sizeof(world_file_header), "header_size");
+    check(header_.tile_size   == sizeof(tile_data),         "tile_size");
+    check(header_.width > 0 && header_.height > 0,          "size");
+    check(is_power_of_two(header_.chunk_size),              "chunk_size");
+
+    check(header_.room_count <= std::numeric_limits<room_id>::max(), "rooms");
+
+    init_(cache);
+}
+
+world_map::~world_map() {
+    try {
+        flush();
+    } catch (...) {
+    }
+}
+
+void world_map::init_(world_cache_params const& cache) {
+    auto const size = header_.chunk_size;
+
+    shift_ = 0;
+    while ((1u << shift_) < size) ++shift_;
+
+    chunks_x_ = static_cast<unsigned>(
+        (static_cast<uint64_t>(header_.width) + size - 1) >> shift_
+    );
+    chunks_y_ = static_cast<unsigned>(
+        (static_cast<uint64_t>(header_.height) + size - 1) >> shift_
+    );
+
+    auto const chunks = static_cast<uint64_t>(chunks_x_) * chunks_y_;
+    if (chunks > std::numeric_limits<uint32_t>::max()) fail("size", filename_);
+
+    capacity_         = std::max(cache.resident, 2u);
+    prefetch_enabled_ = cache.prefetch;
+
+    last_   = nullptr;
+    last_x_ = NO_CHUNK;
+    last_y_ = NO_CHUNK;
+}
+
+tez::world_block world_map::block_at(
+    unsigned const x,
+    unsigned const y
+) const {
+    BK_ASSERT(is_valid_position(x, y));
+
+    world_block result;
+    result.x = x;
+    result.y = y;
+
+    for (signed dy = -1; dy <= 1; ++dy) {
+        for (signed dx = -1; dx <= 1; ++dx) {
+            auto const ix = x + dx; // allow overflow
+            auto const iy = y + dy; // allow overflow
+            if (!is_valid_position(ix, iy)) continue;
+
+            auto const i = (dy + 1) * 3 + (dx + 1);
+            result.tiles_[i] = at(ix, iy);
+            result.valid_[i] = true;
+        }
+    }
+
+    return result;
+}
+
+world_map::room_id world_map::add_room(room const& r, signed dx, signed dy) {
+    BK_ASSERT(header_.room_count < std::numeric_limits<room_id>::max());
+
+    BK_ASSERT(r.left() + dx >= 0 && r.top() + dy >= 0);
+
+    auto const left = static_cast<unsigned>(r.left() + dx);
+    auto const top  = static_cast<unsigned>(r.top()  + dy);
+
+    BK_ASSERT(left + r.width()  <= width());
+    BK_ASSERT(top  + r.height() <= height());
+
+    auto const id = static_cast<room_id>(++header_.room_count);
+
+    for (unsigned y = 0; y < r.height(); ++y) {
+        for (unsigned x = 0; x < r.width(); ++x) {
+            auto const px  = left + x;
+            auto const py  = top  + y;
+            auto const cat = r.at(x, y);
+
+            auto& c = chunk_at_(px, py);
+            auto const i = offset_(px, py);
+
+            c.dirty = true;
+            c.tiles[i].type = cat;
+            if (cat != tile_category::empty) c.room_ids[i] = id;
+        }
+    }
+
+    return id;
+}
+
+void world_map::flush() {
+    for (auto& c : resident_) {
+        if (c.dirty) write_chunk_(c);
+    }
+
+    write_header_();
+
+    file_.flush();
+    if (!file_) fail("write", filename_);
+}
+
+world_map::chunk& world_map::lookup_(
+    unsigned const cx,
+    unsigned const cy
+) const {
+    auto const index = static_cast<uint32_t>(cy * chunks_x_ + cx);
+    stats_.lookups++;
+
+    //forget the last chunk first; paging in may drop it.
+    auto const had_last = last_ != nullptr;
+    auto const last_x   = last_x_;
+    auto const last_y   = last_y_;
+
+    last_   = nullptr;
+    last_x_ = NO_CHUNK;
+    last_y_ = NO_CHUNK;
+
+    chunk* result = nullptr;
+
+    auto const it = where_.find(index);
+    if (it != where_.end()) {
+        resident_.splice(resident_.begin(), resident_, it->second);
+        result = &*it->second;
+
+        if (result->prefetched) {
+            result->prefetched = false;
+            stats_.prefetch_hits++;
+        }
+    } else {
+        stats_.misses++;
+        result = &page_in_(index);
+    }
+
+    //read ahead only for a step to a neighbouring chunk, not a jump.
+    auto const sx = step(last_x, cx);
+    auto const sy = step(last_y, cy);
+    auto const adjacent = (sx || cx == last_x) && (sy || cy == last_y);
+
+    if (prefetch_enabled_ && had_last && adjacent) {
+        prefetch_(cx + sx, cy + sy); // allow overflow
+
+        //keep the chunk in use ahead of the one read for later.
+        resident_.splice(resident_.begin(), resident_, where_[index]);
+    }
+
+    last_   = result;
+    last_x_ = cx;
+    last_y_ = cy;
+
+    return *result;
+}
+
+world_map::chunk& world_map::page_in_(uint32_t const index) const {
+    if (resident_.size() < capacity_) {
+        auto const n = size_t(1) << (shift_ * 2);
+
+        resident_.push_front(chunk());
+        resident_.front().tiles.resize(n);
+        resident_.front().room_ids.resize(n);
+    } else {
+        //reuse the buffers of the least recently used chunk.
+        auto const victim = std::prev(resident_.end());
+        if (victim->dirty) write_chunk_(*victim);
+
+        where_.erase(victim->index);
+        resident_.splice(resident_.begin(), resident_, victim);
+        stats_.evictions++;
+    }
+
+    auto& c = resident_.front();
+    c.index      = index;
+    c.dirty      = false;
+    c.prefetched = false;
+
+    try {
+        read_chunk_(c);
+    } catch (...) {
+        resident_.pop_front();
+        throw;
+    }
+
+    where_[index] = resident_.begin();
+
+    return c;
+}
+
+void world_map::prefetch_(unsigned const cx, unsigned const cy) const {
+    if (cx >= chunks_x_ || cy >= chunks_y_) return;
+
+    auto const index = static_cast<uint32_t>(cy * chunks_x_ + cx);
+    if (where_.count(index)) return;
+
+    page_in_(index).prefetched = true;
+    stats_.prefetches++;
+}
+
+void world_map::read_chunk_(chunk& c) const {
+    file_.clear();
+    file_.seekg(static_cast<std::streamoff>(chunk_offset_(c.index)));
+
+    world_chunk_header header = {0, 0};
+    file_.read(reinterpret_cast<char*>(&header), sizeof(header));
+
+    //past the end of the file, or a hole: never written.
+    if (!file_ || header.tag == 0) {
+        file_.clear();
+        std::fill(c.tiles.begin(), c.tiles.end(), default_tile);
+        std::fill(c.room_ids.begin(), c.room_ids.end(), NO_ROOM);
+        return;
+    }
+
+    if (header.tag != WORLD_CHUNK_TAG || header.index != c.index) {
+        fail("chunk", filename_);
+    }
+
+    file_.read(
+        reinterpret_cast<char*>(c.tiles.data()),
+        static_cast<std::streamsize>(c.tiles.size() * sizeof(tile_data))
+    );
+    file_.read(
+        reinterpret_cast<char*>(c.room_ids.data()),
+        static_cast<std::streamsize>(c.room_ids.size() * sizeof(room_id))
+    );
+
+    if (!file_) fail("read", filename_);
+}
+
+void world_map::write_chunk_(chunk& c) const {
+    file_.clear();
+    file_.seekp(static_cast<std::streamoff>(chunk_offset_(c.index)));
+
+    world_chunk_header const header = {WORLD_CHUNK_TAG, c.index};
+    file_.write(reinterpret_cast<char const*>(&header), sizeof(header));
+
+    file_.write(
+        reinterpret_cast<char const*>(c.tiles.data()),
+        static_cast<std::streamsize>(c.tiles.size() * sizeof(tile_data))
+    );
+    file_.write(
+        reinterpret_cast<char const*>(c.room_ids.data()),
+        static_cast<std::streamsize>(c.room_ids.size() * sizeof(room_id))
+    );
+
+    if (!file_) fail("write", filename_);
+
+    c.dirty = false;
+    stats_.write_backs++;
+}
+
+void world_map::write_header_() {
+    file_.clear();
+    file_.seekp(0);
+    file_.write(reinterpret_cast<char const*>(&header_), sizeof(header_));
+
+    if (!file_) fail("write", filename_);
+}
+
+uint64_t world_map::chunk_offset_(uint32_t const index) const {
+    auto const n = uint64_t(1) << (shift_ * 2);
+
+    auto const record = align(
+        sizeof(world_chunk_header) + n * (sizeof(tile_data) + sizeof(room_id))
+    );
+
+    return align(sizeof(world_file_header)) + index * record;
+}
@@ -0,0 +1,304 @@
+#pragma once
+
+#include "map.hpp"
+
+#include <boost/exception/all.hpp>
+
+#include <unordered_map>
+#include <algorithm>
+#include <iterator>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <list>
+#include <cstdint>
+
+namespace tez {
+
+//==============================================================================
+//! The world file format: a world_file_header, then a chunk record for each
+//! chunk ever written, at a fixed offset by its index; chunks are indexed a
+//! row of chunks at a time.
+//!
+//! A record is a world_chunk_header, the chunk_size * chunk_size tiles, then
+//! as many room ids, padded to a multiple of WORLD_FILE_ALIGN. Records never
+//! written read back as zeros, or past the end of the file, and stand for
+//! chunks of empty tiles owned by no room.
+//!
+//! Like the map file, everything is in the byte order of the writer.
+//==============================================================================
+static uint32_t const WORLD_FILE_VERSION = 1;
+static uint32_t const WORLD_FILE_ALIGN   = 64;
+static uint32_t const WORLD_CHUNK_TAG    = 0x4B4E4843; //"CHNK"
+
+struct world_file_header {
+    char     magic[8];    //!< "TEZWORLD"
+    uint32_t version;     //!< WORLD_FILE_VERSION
+    uint32_t byte_order;  //!< MAP_FILE_BYTE_ORDER as written.
+    uint32_t header_size; //!< sizeof(world_file_header)
+    uint32_t tile_size;   //!< sizeof(tile_data)
+    uint32_t width;
+    uint32_t height;
+    uint32_t chunk_size;  //!< A power of two.
+    uint32_t room_count;
+    uint32_t reserved[6];
+};
+
+struct world_chunk_header {
+    uint32_t tag;   //!< WORLD_CHUNK_TAG; 0 for a chunk never written.
+    uint32_t index;
+};
+
+//==============================================================================
+//! Thrown for a world file that cannot be created, read or written.
+//==============================================================================
+struct bad_world_file : virtual boost::exception, virtual std::exception {};
+
+//! What is wrong, e.g. "chunk_size".
+typedef boost::error_info<struct tag_world_file_field, std::string>
+    world_file_field_info;
+
+//==============================================================================
+//! How many chunks a world_map keeps in memory, and whether it reads ahead.
+//==============================================================================
+struct world_cache_params {
+    world_cache_params()
+        : resident(64)
+        , prefetch(true)
+    {
+    }
+
+    unsigned resident; //!< At least 2.
+    bool     prefetch; //!< Read ahead in the direction of access.
+};
+
+//==============================================================================
+//! Counts of what the chunk cache of a world_map did.
+//==============================================================================
+struct world_cache_stats {
+    world_cache_stats()
+        : lookups(0), misses(0), evictions(0)
+        , write_backs(0), prefetches(0), prefetch_hits(0)
+    {
+    }
+
+    uint64_t lookups;       //!< Accesses to a chunk other than the last one.
+    uint64_t misses;        //!< Lookups of a chunk not in memory.
+    uint64_t evictions;     //!< Chunks dropped to make room.
+    uint64_t write_backs;   //!< Changed chunks written to the file.
+    uint64_t prefetches;    //!< Chunks read ahead of use.
+    uint64_t prefetch_hits; //!< Lookups served by a chunk read ahead.
+};
+
+//==============================================================================
+//! A copy of a tile and its eight neighbours in a world_map.
+//!
+//! The direction accessors return nullptr when their position would lie
+//! outside the world.
+//==============================================================================
+class world_block {
+    friend class world_map;
+public:
+    world_block()
+        : x(0)
+        , y(0)
+    {
+        std::fill(std::begin(valid_), std::end(valid_), false);
+    }
+
+    tile_data const* here()       const { return get_( 0,  0); }
+    tile_data const* north()      const { return get_( 0, -1); }
+    tile_data const* south()      const { return get_( 0,  1); }
+    tile_data const* east()       const { return get_( 1,  0); }
+    tile_data const* west()       const { return get_(-1,  0); }
+    tile_data const* north_east() const { return get_( 1, -1); }
+    tile_data const* north_west() const { return get_(-1, -1); }
+    tile_data const* south_east() const { return get_( 1,  1); }
+    tile_data const* south_west() const { return get_(-1,  1); }
+
+    unsigned x, y;
+private:
+    tile_data const* get_(signed dx, signed dy) const {
+        auto const i = (dy + 1) * 3 + (dx + 1);
+        return valid_[i] ? &tiles_[i] : nullptr;
+    }
+
+    tile_data tiles_[9];
+    bool      valid_[9];
+};
+
+//==============================================================================
+//! A map too large to keep in memory: the tiles and room ids live in a world
+//! file, a square chunk at a time, and at most a fixed number of chunks are
+//! in memory at once.
+//!
+//! Accesses page in the chunk they touch, dropping the least recently used
+//! one when full; changed chunks are written back when dropped, on flush and
+//! on destruction. Moving from one chunk to the next also reads ahead the
+//! chunk after it in the same direction, so scans in rows, columns or along
+//! a path mostly find their chunk already in memory.
+//!
+//! The tile access mirrors map, so code written against either reads the
+//! same; path_generator takes either. Unlike map, a reference returned by
+//! at() is only good until the next access to another chunk.
+//!
+//! @remark Not thread safe, even for const access: reads move chunks.
+//==============================================================================
+class world_map {
+public:
+    typedef map::room_id  room_id;
+    typedef map::position position;
+
+    static room_id const NO_ROOM = map::NO_ROOM;
+
+    //--------------------------------------------------------------------------
+    //! Create @p filename, replacing any file there, for a world of
+    //! @p width by @p height empty tiles.
+    //!
+    //! @param chunk_size a power of two.
+    //! @throws bad_world_file
+    //--------------------------------------------------------------------------
+    world_map(
+        std::string const& filename,
+        unsigned           width,
+        unsigned           height,
+        unsigned           chunk_size = 64,
+        world_cache_params cache      = world_cache_params()
+    );
+
+    //--------------------------------------------------------------------------
+    //! Open the world in @p filename.
+    //!
+    //! @throws bad_world_file
+    //--------------------------------------------------------------------------
+    explicit world_map(
+        std::string const& filename,
+        world_cache_params cache = world_cache_params()
+    );
+
+    //! Writes back changed chunks; errors are lost, so call flush first.
+    ~world_map();
+    //--------------------------------------------------------------------------
+    unsigned width()      const { return header_.width;      }
+    unsigned height()     const { return header_.height;     }
+    unsigned chunk_size() const { return header_.chunk_size; }
+
+    bool is_valid_position(unsigned x, unsigned y) const {
+        return x < width() && y < height();
+    }
+
+    bool is_valid_position(position p) const {
+        return is_valid_position(p.x, p.y);
+    }
+    //--------------------------------------------------------------------------
+    tile_data const& at(unsigned x, unsigned y) const {
+        auto& c = chunk_at_(x, y);
+        return c.tiles[offset_(x, y)];
+    }
+
+    //! Marks the chunk as changed.
+    tile_data& at(unsigned x, unsigned y) {
+        auto& c = chunk_at_(x, y);
+        c.dirty = true;
+        return c.tiles[offset_(x, y)];
+    }
+
+    tile_data const& at(position p) const { return at(p.x, p.y); }
+    tile_data&       at(position p)       { return at(p.x, p.y); }
+
+    world_block block_at(unsigned x, unsigned y) const;
+
+    world_block block_at(position p) const {
+        return block_at(p.x, p.y);
+    }
+    //--------------------------------------------------------------------------
+    //! As map::add_room.
+    //--------------------------------------------------------------------------
+    room_id add_room(room const& r, signed dx = 0, signed dy = 0);
+
+    room_id room_at(unsigned x, unsigned y) const {
+        auto& c = chunk_at_(x, y);
+        return c.room_ids[offset_(x, y)];
+    }
+
+    room_id room_at(position p) const {
+        return room_at(p.x, p.y);
+    }
+
+    unsigned room_count() const {
+        return header_.room_count;
+    }
+    //--------------------------------------------------------------------------
+    //! Write back every changed chunk and the header.
+    //! @throws bad_world_file
+    //--------------------------------------------------------------------------
+    void flush();
+
+    world_cache_stats const& stats() const { return stats_; }
+    unsigned resident_count() const {
+        return static_cast<unsigned>(resident_.size());
+    }
+private:
+    world_map(world_map const&)            BK_DELETE;
+    world_map& operator=(world_map const&) BK_DELETE;
+
+    struct chunk {
+        uint32_t               index;
+        bool                   dirty;
+        bool                   prefetched; //!< And not looked up since.
+        std::vector<tile_data> tiles;
+        std::vector<room_id>   room_ids;
+    };
+
+    typedef std::list<chunk> chunk_list; //!< Most recently used first.
+
+    chunk& chunk_at_(unsigned const x, unsigned const y) const {
+        BK_ASSERT(is_valid_position(x, y));
+
+        auto const cx = x >> shift_;
+        auto const cy = y >> shift_;
+
+        return (cx == last_x_ && cy == last_y_)
+            ? *last_
+            : lookup_(cx, cy);
+    }
+
+    size_t offset_(unsigned const x, unsigned const y) const {
+        auto const mask = header_.chunk_size - 1;
+        return ((y & mask) << shift_) + (x & mask);
+    }
+
+    void init_(world_cache_params const& cache);
+
+    chunk& lookup_(unsigned cx, unsigned cy) const;
+    chunk& page_in_(uint32_t index) const;
+    void   prefetch_(unsigned cx, unsigned cy) const;
+
+    void read_chunk_(chunk& c) const;
+    void write_chunk_(chunk& c) const;
+    void write_header_();
+
+    uint64_t chunk_offset_(uint32_t index) const;
+
+    std::string       filename_;
+    world_file_header header_;
+    unsigned          shift_;    //!< log2 of chunk_size.
+    unsigned          chunks_x_; //!< Chunks in a row of chunks.
+    unsigned          chunks_y_;
+    unsigned          capacity_; //!< Chunks resident at most.
+    bool              prefetch_enabled_;
+
+    //the cache changes on const access.
+    typedef std::unordered_map<uint32_t, chunk_list::iterator> index_map;
+
+    mutable std::fstream      file_;
+    mutable chunk_list        resident_;
+    mutable index_map         where_;
+    mutable world_cache_stats stats_;
+
+    mutable chunk*   last_;   //!< The chunk last looked up, at (last_x_,
+    mutable unsigned last_x_; //!< last_y_) in chunks; last_x_ is -1 for
+    mutable unsigned last_y_; //!< none.
+};
+
+} //namespace tez
@@ -0,0 +1,515 @@
+//==============================================================================
+//! tezgen: headless map generation for offline jobs and benchmarking.
+//!
+//! Only the tez and bklib sources are needed to build it; nothing from
+//! platform/ or main.cpp.
+//==============================================================================
+#include "pch.hpp"
+
+#include "tez/map_batch.hpp"
+#include "tez/map_pipeline.hpp"
+#include "tez/map_file.hpp"
+#include "tez/generation_params.hpp"
+#include "tez/tile_properties.hpp"
+#include "bklib/thread_pool.hpp"
+#include "bklib/targa.hpp"
+
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <chrono>
+#include <cstdlib>
+
+namespace {
+
+typedef std::chrono::steady_clock steady_clock;
+typedef steady_clock::duration    duration_t;
+
+//==============================================================================
+//! Thrown for a bad command line.
+//==============================================================================
+struct bad_arguments : virtual boost::exception, virtual std::exception {};
+
+typedef boost::error_info<struct tag_argument, std::string> argument_info;
+
+void fail(std::string const& argument) {
+    BOOST_THROW_EXCEPTION(bad_arguments() << argument_info(argument));
+}
+
+//==============================================================================
+//! How the maps are spread over the threads.
+//==============================================================================
+enum class run_mode {
+    serial,   //!< One map at a time on the main thread.
+    batch,    //!< One map per job, a block of maps at a time.
+    pipeline, //!< map_pipeline::run_overlapped.
+};
+
+enum class output_format {
+    none,
+    text,   //!< operator<< of map.
+    tga,    //!< One pixel per tile.
+    binary, //!< tez::write_map_file.
+};
+
+struct options {
+    options()
+        : seed(1)
+        , count(16)
+        , threads(0)
+        , block(64)
+        , mode(run_mode::batch)
+        , format(output_format::none)
+        , out_dir(".")
+    {
+    }
+
+    uint64_t        seed;    //!< Of the batch; see tez::map_seed.
+    unsigned        count;
+    unsigned        threads; //!< 0 for one per hardware thread.
+    unsigned        block;   //!< Maps held at once in batch mode.
+    run_mode        mode;
+    output_format   format;
+    std::string     out_dir;
+    std::string     params_file; //!< generation.def; empty for built in.
+    std::string     tiles_file;  //!< tile_types.def; empty for built in.
+    tez::map_params params;
+};
+
+char const USAGE[] =
+    "usage: tezgen [options]\n"
+    "  --seed N        batch seed (1)\n"
+    "  --count N       maps to generate (16)\n"
+    "  --mode M        serial, batch or pipeline (batch)\n"
+    "  --threads N     worker threads; 0 for one per hardware thread (0)\n"
+    "  --block N       maps held at once in batch mode (64)\n"
+    "  --rooms N       rooms per map (20)\n"
+    "  --compound N    every nth room is compound; 0 for none (4)\n"
+    "  --caves N       every nth other room is a cave; 0 for none (0)\n"
+    "  --format F      none, text, tga or binary (none)\n"
+    "  --out DIR       directory for the maps (.)\n"
+    "  --params FILE   generation.def to generate with (built in values)\n"
+    "  --tiles FILE    tile_types.def to generate with (built in values)\n"
+    "\n"
+    "Map i has seed map_seed(seed, i) and is written as map_<i>.<format>.\n";
+
+uint64_t parse_number(std::string const& name, char const* const value) {
+    char* end = nullptr;
+    auto const result = std::strtoull(value, &end, 10);
+
+    if (*value == '\0' || *end != '\0' || *value == '-') {
+        fail(name + " " + value);
+    }
+
+    return result;
+}
+
+unsigned parse_unsigned(std::string const& name, char const* const value) {
+    auto const result = parse_number(name, value);
+
+    if (result > 0xFFFFFFFF) {
+        fail(name + " " + value);
+    }
+
+    return static_cast<unsigned>(result);
+}
+
+//==============================================================================
+//! @returns false if only the usage was asked for.
+//! @throws bad_arguments
+//==============================================================================
+bool parse_options(
+    int         const        argc,
+    char const* const* const argv,
+    options&                 out
+) {
+    for (int i = 1; i < argc; ++i) {
+        std::string const name = argv[i];
+
+        if (name == "--help" || name == "-h") {
+            return false;
+        }
+
+        if (i + 1 == argc) {
+            fail(name);
+        }
+
+        char const* const value = argv[++i];
+
+        if (name == "--seed") {
+            out.seed = parse_number(name, value);
+        } else if (name == "--count") {
+            out.count = parse_unsigned(name, value);
+        } else if (name == "--threads") {
+            out.threads = parse_unsigned(name, value);
+        } else if (name == "--block") {
+            out.block = parse_unsigned(name, value);
+            if (out.block == 0) fail(name + " " + value);
+        } else if (name == "--rooms") {
+            out.params.room_count = parse_unsigned(name, value);
+            if (out.params.room_count == 0) fail(name + " " + value);
+        } else if (name == "--compound") {
+            out.params.compound_interval = parse_unsigned(name, value);
+        } else if (name == "--caves") {
+            out.params.cave_interval = parse_unsigned(name, value);
+        } else if (name == "--mode") {
+            std::string const mode = value;
+
+            if      (mode == "serial")   out.mode = run_mode::serial;
+            else if (mode == "batch")    out.mode = run_mode::batch;
+            else if (mode == "pipeline") out.mode = run_mode::pipeline;
+            else fail(name + " " + value);
+        } else if (name == "--format") {
+            std::string const format = value;
+
+            if      (format == "none")   out.format = output_format::none;
+            else if (format == "text")   out.format = output_format::text;
+            else if (format == "tga")    out.format = output_format::tga;
+            else if (format == "binary") out.format = output_format::binary;
+            else fail(name + " " + value);
+        } else if (name == "--out") {
+            out.out_dir = value;
+        } else if (name == "--params") {
+            out.params_file = value;
+        } else if (name == "--tiles") {
+            out.tiles_file = value;
+        } else {
+            fail(name);
+        }
+    }
+
+    return true;
+}
+
+//==============================================================================
+// Output.
+//==============================================================================
+struct rgb {
+    uint8_t r, g, b;
+};
+
+rgb tile_color(tez::tile_category const type) {
+    using tez::tile_category;
+
+    rgb const black = {0, 0, 0};
+
+    rgb const colors[] = {
+        {110, 110, 110}, //wall
+        { 40,  40,  40}, //ceiling
+        {200, 190, 170}, //floor
+        { 30,  20,  50}, //pit
+        { 40,  80, 200}, //water
+        {160, 100,  40}, //door
+        {150, 150, 120}, //corridor
+    };
+
+    switch (type) {
+    case tile_category::wall     : return colors[0];
+    case tile_category::ceiling  : return colors[1];
+    case tile_category::floor    : return colors[2];
+    case tile_category::pit      : return colors[3];
+    case tile_category::water    : return colors[4];
+    case tile_category::door     : return colors[5];
+    case tile_category::corridor : return colors[6];
+    default                      : return black;
+    }
+}
+
+void write_tga(tez::map const& m, std::string const& filename) {
+    if (m.width() > 0xFFFF || m.height() > 0xFFFF) {
+        BOOST_THROW_EXCEPTION(
+            bad_arguments()
+                << argument_info("map too large for tga")
+                << boost::errinfo_file_name(filename)
+        );
+    }
+
+    bklib::image_targa image(
+        static_cast<uint16_t>(m.width()),
+        static_cast<uint16_t>(m.height()),
+        bklib::image_targa::image_type::rgb24
+    );
+
+    for (unsigned y = 0; y < m.height(); ++y) {
+        for (unsigned x = 0; x < m.width(); ++x) {
+            auto const c = tile_color(m.at(x, y).type);
+            image.set(
+                static_cast<uint16_t>(x), static_cast<uint16_t>(y),
+                c.r, c.g, c.b, 0xFF
+            );
+        }
+    }
+
+    image.save(filename);
+}
+
+void write_text(tez::map const& m, std::string const& filename) {
+    std::ofstream out(filename, std::ios::trunc);
+    out << m;
+}
+
+void write_map(
+    options  const& opt,
+    unsigned const  index,
+    tez::map const& m
+) {
+    static char const* const extensions[] = {"", "txt", "tga", "tezmap"};
+
+    if (opt.format == output_format::none) {
+        return;
+    }
+
+    std::ostringstream name;
+    name << opt.out_dir << "/map_" << std::setw(6) << std::setfill('0')
+         << index << "." << extensions[static_cast<unsigned>(opt.format)];
+
+    switch (opt.format) {
+    case output_format::text :
+        write_text(m, name.str());
+        break;
+    case output_format::tga :
+        write_tga(m, name.str());
+        break;
+    case output_format::binary :
+        tez::write_map_file(name.str(), m);
+        break;
+    default :
+        break;
+    }
+}
+
+//==============================================================================
+// Runs.
+//==============================================================================
+struct run_result {
+    run_result(unsigned const count)
+        : latency(count)
+        , generation(0)
+        , output(0)
+        , disconnected(0)
+        , threads(1)
+    {
+    }
+
+    std::vector<duration_t> latency;      //!< Of each map.
+    duration_t              generation;   //!< Wall time, output excluded.
+    duration_t              output;       //!< Wall time writing maps.
+    unsigned                disconnected; //!< Maps left disconnected.
+    unsigned                threads;
+};
+
+//==============================================================================
+//! Writes each map and keeps the totals.
+//==============================================================================
+struct map_writer {
+    map_writer(options const& opt, run_result& result)
+        : opt(opt)
+        , result(result)
+    {
+    }
+
+    void operator()(unsigned const index, tez::generated_map const& m) {
+        auto const start = steady_clock::now();
+
+        write_map(opt, index, m.result);
+        if (m.status.disconnected) result.disconnected++;
+
+        result.output += steady_clock::now() - start;
+    }
+
+    options    const& opt;
+    run_result&       result;
+};
+
+void run_serial(options const& opt, run_result& result) {
+    map_writer write(opt, result);
+
+    for (unsigned i = 0; i < opt.count; ++i) {
+        auto const start = steady_clock::now();
+        auto const m     = tez::generate_map(
+            tez::map_seed(opt.seed, i), opt.params
+        );
+        auto const time  = steady_clock::now() - start;
+
+        result.latency[i]  = time;
+        result.generation += time;
+
+        write(i, m);
+    }
+}
+
+void run_batch(options const& opt, run_result& result) {
+    bklib::thread_pool pool(opt.threads);
+    result.threads = pool.size();
+
+    map_writer write(opt, result);
+
+    std::vector<std::unique_ptr<tez::generated_map>> slots(opt.block);
+
+    for (unsigned first = 0; first < opt.count; first += opt.block) {
+        auto const n = std::min(opt.block, opt.count - first);
+
+        auto const start = steady_clock::now();
+
+        pool.parallel_for(n, [&](size_t const j) {
+            auto const i          = first + static_cast<unsigned>(j);
+            auto const map_start  = steady_clock::now();
+
+            slots[j].reset(new tez::generated_map(
+                tez::generate_map(tez::map_seed(opt.seed, i), opt.params)
+            ));
+
+            result.latency[i] = steady_clock::now() - map_start;
+        });
+
+        result.generation += steady_clock::now() - start;
+
+        for (unsigned j = 0; j < n; ++j) {
+            write(first + j, *slots[j]);
+            slots[j].reset();
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+//! Latency here is the time between maps coming out of the pipeline.
+//------------------------------------------------------------------------------
+void run_pipeline(
+    options const&     opt,
+    run_result&        result,
+    tez::map_pipeline& pipeline
+) {
+    bklib::thread_pool pool(opt.threads);
+    result.threads = pool.size();
+
+    map_writer write(opt, result);
+
+    unsigned   index = 0;
+    auto const start = steady_clock::now();
+    auto       last  = start;
+
+    pipeline.run_overlapped(opt.seed, opt.count, pool,
+        [&](tez::generated_map m) {
+            result.latency[index] = steady_clock::now() - last;
+
+            write(index++, m);
+            last = steady_clock::now();
+        }
+    );
+
+    result.generation = (steady_clock::now() - start) - result.output;
+}
+
+//==============================================================================
+// Report.
+//==============================================================================
+double to_ms(duration_t const d) {
+    return std::chrono::duration<double, std::milli>(d).count();
+}
+
+//! Nearest rank percentile @p p of @p sorted.
+duration_t percentile(std::vector<duration_t> const& sorted, unsigned const p) {
+    BK_ASSERT(!sorted.empty());
+
+    auto const n    = sorted.size();
+    auto const rank = (p * n + 99) / 100;
+
+    return sorted[rank ? rank - 1 : 0];
+}
+
+void report(
+    options           const& opt,
+    run_result        const& result,
+    tez::map_pipeline const* pipeline
+) {
+    static char const* const modes[] = {"serial", "batch", "pipeline"};
+
+    auto sorted = result.latency;
+    std::sort(std::begin(sorted), std::end(sorted));
+
+    auto const seconds = to_ms(result.generation) / 1000.0;
+
+    std::cout << std::fixed << std::setprecision(3)
+        << "mode          " << modes[static_cast<unsigned>(opt.mode)] << "\n"
+        << "threads       " << result.threads << "\n"
+        << "maps          " << opt.count << "\n"
+        << "disconnected  " << result.disconnected << "\n"
+        << "time          " << seconds << " s\n"
+        << "maps/s        " << (seconds > 0 ? opt.count / seconds : 0) << "\n"
+        << "latency ms    "
+        << "p50 "   << to_ms(percentile(sorted, 50))
+        << ", p90 " << to_ms(percentile(sorted, 90))
+        << ", p99 " << to_ms(percentile(sorted, 99))
+        << ", max " << to_ms(sorted.back()) << "\n"
+        << "output        " << to_ms(result.output) / 1000.0 << " s\n";
+
+    if (!pipeline) {
+        return;
+    }
+
+    for (unsigned i = 0; i < tez::PIPELINE_STAGE_COUNT; ++i) {
+        auto const  stage = static_cast<tez::pipeline_stage>(i);
+        auto const& stats = pipeline->stats(stage);
+
+        std::cout
+            << "  " << std::left << std::setw(14) << tez::stage_name(stage)
+            << std::right << std::setw(10) << to_ms(stats.time) << " ms"
+            << std::setw(10) << stats.items << " items\n";
+    }
+}
+
+} //namespace
+
+int main(int const argc, char const* const* const argv) {
+    options opt;
+
+    try {
+        if (!parse_options(argc, argv, opt)) {
+            std::cout << USAGE;
+            return 0;
+        }
+    } catch (bad_arguments const& e) {
+        auto const arg = boost::get_error_info<argument_info>(e);
+        std::cerr << "tezgen: bad argument: " << (arg ? *arg : "") << "\n\n"
+                  << USAGE;
+        return 1;
+    }
+
+    if (opt.count == 0) {
+        return 0;
+    }
+
+    try {
+        if (!opt.params_file.empty()) {
+            tez::reload_generation_params(opt.params_file);
+        }
+
+        if (!opt.tiles_file.empty()) {
+            tez::load_tile_types(opt.tiles_file);
+        }
+
+        run_result result(opt.count);
+
+        switch (opt.mode) {
+        case run_mode::serial :
+            run_serial(opt, result);
+            report(opt, result, nullptr);
+            break;
+        case run_mode::batch :
+            run_batch(opt, result);
+            report(opt, result, nullptr);
+            break;
+        case run_mode::pipeline : {
+                tez::map_pipeline pipeline(opt.params);
+                run_pipeline(opt, result, pipeline);
+                report(opt, result, &pipeline);
+            }
+            break;
+        }
+    } catch (std::exception const& e) {
+        std::cerr << "tezgen: " << boost::diagnostic_information(e) << "\n";
+        return 1;
+    }
+
+    return 0;
+}